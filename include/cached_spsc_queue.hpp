@@ -0,0 +1,139 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*! @file cached_spsc_queue.hpp
+    @brief A single-producer, single-consumer ring which keeps a local copy of the other side's index.
+*/
+
+// The producer only reloads the read index when its cached copy says the ring is full, and the
+// consumer only reloads the write index when its cached copy says the ring is empty, so in steady
+// state each side touches the other side's cache line once per lap instead of once per operation.
+// Indexes increase without wrapping and are reduced with a power-of-two mask.
+template <typename T> class cached_spsc_queue {
+  public:
+    // as for the other queue backends, the number of usable slots is (size - 1)
+    explicit cached_spsc_queue(const size_t size)
+        : capacity(std::max<size_t>(size, 2) - 1),
+          mask(std::bit_ceil(std::max<size_t>(size, 2)) - 1),
+          records(static_cast<T*>(::operator new(sizeof(T) * (mask + 1), std::align_val_t{alignof(T)}))) {}
+
+    ~cached_spsc_queue() noexcept {
+        destroy_n_records();
+        ::operator delete(records, std::align_val_t{alignof(T)});
+    }
+
+    cached_spsc_queue(const cached_spsc_queue&)            = delete;
+    cached_spsc_queue& operator=(const cached_spsc_queue&) = delete;
+    cached_spsc_queue(cached_spsc_queue&&)                 = delete;
+    cached_spsc_queue& operator=(cached_spsc_queue&&)      = delete;
+
+    // producer side
+    template <class... Args> bool write(Args&&... record_args) {
+        const size_t w = write_index.load(std::memory_order_relaxed);
+        if (w - cached_read_index >= capacity) {
+            cached_read_index = read_index.load(std::memory_order_acquire);
+            if (w - cached_read_index >= capacity) {
+                return false;
+            }
+        }
+        new (&records[w & mask]) T(std::forward<Args>(record_args)...);
+        write_index.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t write_bulk(const T* p, size_t n) {
+        const size_t w = write_index.load(std::memory_order_relaxed);
+        if (capacity - (w - cached_read_index) < n) {
+            cached_read_index = read_index.load(std::memory_order_acquire);
+            n = std::min(n, capacity - (w - cached_read_index));
+        }
+        if (n == 0) {
+            return 0;
+        }
+        const size_t start = w & mask;
+        const size_t first = std::min(n, mask + 1 - start);
+        std::uninitialized_copy_n(p, first, &records[start]);
+        std::uninitialized_copy_n(p + first, n - first, records);
+        write_index.store(w + n, std::memory_order_release);
+        return n;
+    }
+
+    // consumer side
+    bool read(T& record) {
+        const size_t r = read_index.load(std::memory_order_relaxed);
+        if (r == cached_write_index) {
+            cached_write_index = write_index.load(std::memory_order_acquire);
+            if (r == cached_write_index) {
+                return false;
+            }
+        }
+        T* slot = &records[r & mask];
+        record  = std::move(*slot);
+        std::destroy_at(slot);
+        read_index.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t read_bulk(T* p, size_t n) {
+        const size_t r = read_index.load(std::memory_order_relaxed);
+        if (cached_write_index - r < n) {
+            cached_write_index = write_index.load(std::memory_order_acquire);
+            n = std::min(n, cached_write_index - r);
+        }
+        if (n == 0) {
+            return 0;
+        }
+        const size_t start = r & mask;
+        const size_t first = std::min(n, mask + 1 - start);
+        std::move(&records[start], &records[start + first], p);
+        std::destroy_n(&records[start], first);
+        std::move(records, records + (n - first), p + first);
+        std::destroy_n(records, n - first);
+        read_index.store(r + n, std::memory_order_release);
+        return n;
+    }
+
+    // exact when called with the other side idle; otherwise a snapshot
+    [[nodiscard]] size_t size_guess() const {
+        return write_index.load(std::memory_order_acquire) - read_index.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] size_t max_size() const { return capacity; }
+
+  private:
+    void destroy_n_records() {
+        if constexpr (not std::is_trivially_destructible_v<T>) {
+            for (size_t i = read_index.load(); i != write_index.load(); i++) {
+                std::destroy_at(&records[i & mask]);
+            }
+        }
+    }
+
+    static constexpr size_t cache_line_bytes = 64;
+
+    // written by the producer, read by the consumer
+    alignas(cache_line_bytes) std::atomic<size_t> write_index = 0;
+    // producer only
+    alignas(cache_line_bytes) size_t cached_read_index        = 0;
+    // written by the consumer, read by the producer
+    alignas(cache_line_bytes) std::atomic<size_t> read_index  = 0;
+    // consumer only
+    alignas(cache_line_bytes) size_t cached_write_index       = 0;
+    // read-only after construction
+    alignas(cache_line_bytes) const size_t capacity;
+    const size_t mask;
+    T* const records;
+    char pad[cache_line_bytes - 2 * sizeof(size_t) - sizeof(T*)] = {};
+};
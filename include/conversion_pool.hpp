@@ -0,0 +1,54 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "vxsdr_threads.hpp"
+
+/*! @file conversion_pool.hpp
+    @brief A small pool of worker threads used to convert samples for large data requests in parallel.
+*/
+
+class conversion_pool {
+  public:
+    // a negative affinity offset leaves the workers unpinned; otherwise worker i is pinned to cpu (offset + i)
+    conversion_pool(const unsigned n_threads, const int64_t thread_affinity_offset);
+    ~conversion_pool() noexcept;
+    conversion_pool(const conversion_pool&)            = delete;
+    conversion_pool& operator=(const conversion_pool&) = delete;
+    conversion_pool(conversion_pool&&)                 = delete;
+    conversion_pool& operator=(conversion_pool&&)      = delete;
+
+    // calls task(i) for each i in [0, n_tasks) and returns when all calls are complete;
+    // the calling thread also runs tasks, and tasks must write only to disjoint outputs;
+    // if another thread's call is using the workers, the tasks are all run on the calling thread
+    void run(const size_t n_tasks, const std::function<void(size_t)>& task);
+    [[nodiscard]] size_t size() const { return workers.size(); }
+
+  private:
+    void worker();
+    void run_tasks(const std::function<void(size_t)>& task, const size_t n_tasks);
+
+    // held by the call to run() that is using the workers
+    std::mutex run_mutex;
+    std::mutex pool_mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    // the items below are protected by pool_mutex
+    uint64_t generation                       = 0;
+    bool stop_flag                            = false;
+    const std::function<void(size_t)>* current_task = nullptr;
+    size_t current_n_tasks                    = 0;
+    unsigned n_active_workers                 = 0;
+    // index of the next unclaimed task
+    std::atomic<size_t> next_task             = 0;
+    std::vector<vxsdr_thread> workers;
+};
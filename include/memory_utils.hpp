@@ -0,0 +1,50 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*! @file memory_utils.hpp
+    @brief Allocation of large queue buffers with optional huge pages, NUMA placement, pre-faulting and locking.
+*/
+
+struct queue_memory_options {
+    // use 1 GB or 2 MB huge pages if available, otherwise ask for transparent huge pages
+    bool huge_pages = false;
+    // place the memory on the NUMA node of this cpu (negative for no preference)
+    int64_t numa_cpu = -1;
+    // touch every page at allocation, so no page faults occur when the queue is first used
+    bool prefault = false;
+    // lock the pages in memory (also pre-faults them)
+    bool lock = false;
+};
+
+// Owns a buffer of at least the requested size, aligned to at least 64 bytes. Each option is
+// applied if the platform and system limits allow it; if not, a warning is logged and the
+// buffer is still usable, so a failed option never prevents construction.
+//
+// On Linux the buffer is reserved without committing memory, so pages not pre-faulted or locked
+// cost nothing until they are first touched.
+class queue_memory {
+  public:
+    queue_memory(const size_t n_bytes, const queue_memory_options& options = {});
+    ~queue_memory() noexcept;
+
+    queue_memory(const queue_memory&)            = delete;
+    queue_memory& operator=(const queue_memory&) = delete;
+    queue_memory(queue_memory&&)                 = delete;
+    queue_memory& operator=(queue_memory&&)      = delete;
+
+    [[nodiscard]] uint8_t* data() const noexcept { return buffer; }
+    [[nodiscard]] size_t size() const noexcept { return requested_bytes; }
+
+  private:
+    static constexpr size_t minimum_alignment = 64;
+
+    uint8_t* buffer        = nullptr;
+    size_t requested_bytes = 0;
+    // bytes mapped, rounded up to the page size (Linux only)
+    size_t mapped_bytes    = 0;
+};
@@ -0,0 +1,307 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "memory_utils.hpp"
+#include "queue_statistics.hpp"
+#include "vxsdr_packets.hpp"
+
+/*! @file packet_ring.hpp
+    @brief A single-producer, single-consumer ring of variable-length packets.
+*/
+
+// Packets are stored at their actual size rather than in fixed data_queue_element slots, so the
+// memory needed depends on the bytes buffered and not on the largest possible packet. Each record
+// starts on a cache line with a short prefix giving the record and packet lengths; a record with
+// a packet length of zero marks unused space at the end of the ring, and the reader continues
+// from the start. The reader only follows records, so it never needs to know where the end is.
+//
+// That lets the writer grow the ring: an elastic ring uses only the first part of its buffer, and
+// when the writer reaches the end of that part with the ring more than half full, it extends the
+// part in place instead of going back to the start. Pages past the part in use are never touched,
+// unless the memory options pre-fault or lock them, which is done for the whole reservation when
+// the ring is constructed so that growing never faults pages on the writer's thread.
+//
+// Positions are byte counts which increase without wrapping and give the bytes in use; as in
+// cached_spsc_queue, each side keeps a local copy of the other side's position and only reloads
+// it when the ring looks full or empty.
+//
+// With statistics enabled, occupancy is measured in bytes, and each record's prefix carries the
+// time it was pushed so residency can be measured when it is popped.
+//
+// A packet may also be pushed with the time it reached the host, if the transport measures it;
+// the consumer keeps the arrival time of the last such packet it popped, and how long after
+// arrival it was popped, for latency measurements.
+class packet_ring {
+  public:
+    static constexpr size_t record_alignment = VXSDR_DATA_BUFFER_ALIGNMENT;
+
+    // bytes of ring used to store a packet of packet_bytes
+    static constexpr size_t record_bytes(const size_t packet_bytes) { return round_up(sizeof(record_prefix) + packet_bytes); }
+
+    // smallest ring which can always accept a packet of the maximum size when empty
+    static constexpr size_t minimum_size_bytes() { return 2 * record_bytes(MAX_DATA_PACKET_BYTES) + record_alignment; }
+
+    // the ring starts using initial_bytes (or all of size_bytes if initial_bytes is zero), and grows by
+    // initial_bytes at a time up to size_bytes
+    explicit packet_ring(const size_t size_bytes, const queue_memory_options& memory_options = {}, const size_t initial_bytes = 0)
+        : ring_bytes(round_up(std::max(size_bytes, minimum_size_bytes()))),
+          grow_bytes(initial_bytes == 0 ? ring_bytes : std::min(ring_bytes, round_up(std::max(initial_bytes, minimum_size_bytes())))),
+          storage(ring_bytes, memory_options),
+          buffer(storage.data()),
+          active_bytes(grow_bytes) {}
+
+    ~packet_ring() noexcept = default;
+
+    packet_ring(const packet_ring&)            = delete;
+    packet_ring& operator=(const packet_ring&) = delete;
+    packet_ring(packet_ring&&)                 = delete;
+    packet_ring& operator=(packet_ring&&)      = delete;
+
+    // must be called before the ring is used
+    void enable_statistics() { stats = std::make_unique<queue_statistics>(ring_bytes); }
+    [[nodiscard]] const queue_statistics* statistics() const { return stats.get(); }
+
+    // time on the host's real-time clock in nanoseconds since the epoch, as used for arrival times
+    static uint64_t host_time() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // producer side: copies hdr.packet_size bytes of p into the ring, with the time (from host_time(),
+    // or 0 if unknown) the packet reached the host
+    bool push(const packet& p, const uint64_t arrival_time = 0) {
+        size_t w = write_position.load(std::memory_order_relaxed);
+        const uint64_t now = stats ? queue_statistics::timestamp() : 0;
+        if (not write_record(p, w, now, arrival_time)) {
+            if (stats) {
+                stats->record_push(0, 1, 0);
+            }
+            return false;
+        }
+        publish_write(w, 1, 1);
+        return true;
+    }
+
+    // copies up to n_max packets from p, publishing the new write position once
+    size_t push(const data_queue_element* p, const size_t n_max) {
+        size_t w = write_position.load(std::memory_order_relaxed);
+        const uint64_t now = stats ? queue_statistics::timestamp() : 0;
+        size_t n = 0;
+        while (n < n_max and write_record(p[n], w, now, 0)) {
+            n++;
+        }
+        publish_write(w, n, n_max);
+        return n;
+    }
+
+    // consumer side: copies the next packet into e; bytes of e past hdr.packet_size are not written
+    bool pop(data_queue_element& e) { return pop(&e, 1) == 1; }
+
+    // copies up to n_max packets into p, publishing the new read position once
+    size_t pop(data_queue_element* p, const size_t n_max) {
+        size_t r = read_position.load(std::memory_order_relaxed);
+        size_t n = 0;
+        const uint64_t now = stats ? queue_statistics::timestamp() : 0;
+        // the real-time clock is only read if a packet has an arrival time
+        uint64_t host_now     = 0;
+        uint64_t last_arrival = 0;
+        while (n < n_max) {
+            if (r == cached_write_position) {
+                cached_write_position = write_position.load(std::memory_order_acquire);
+                if (r == cached_write_position) {
+                    break;
+                }
+            }
+            const record_prefix prefix = next_record();
+            if (prefix.packet_bytes > 0) {
+                std::memcpy((void*)&p[n++], &buffer[read_offset + sizeof(record_prefix)], prefix.packet_bytes);
+                if (stats) {
+                    stats->record_residency(prefix.enqueue_time, now);
+                }
+                if (prefix.arrival_time != 0) {
+                    host_now     = (host_now == 0) ? host_time() : host_now;
+                    last_arrival = prefix.arrival_time;
+                    if (stats) {
+                        stats->record_arrival_latency(last_arrival, host_now);
+                    }
+                }
+            }
+            advance_read(prefix, r);
+        }
+        if (n > 0) {
+            packets_read.store(packets_read.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            read_position.store(r, std::memory_order_release);
+            if (stats) {
+                stats->record_pop(n);
+            }
+        }
+        if (last_arrival != 0) {
+            store_last_popped_timing(last_arrival, host_now);
+        }
+        return n;
+    }
+
+    // the arrival time of the last packet popped which had one, and the time it was popped, both
+    // from host_time(), read as a consistent pair; zeros if no packet with an arrival time has been popped
+    [[nodiscard]] std::pair<uint64_t, uint64_t> last_popped_timing() const {
+        while (true) {
+            const uint32_t before = timing_sequence.load(std::memory_order_acquire);
+            if ((before & 1U) == 0) {
+                const uint64_t arrival = last_arrival_time.load(std::memory_order_relaxed);
+                const uint64_t popped  = last_pop_time.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (timing_sequence.load(std::memory_order_relaxed) == before) {
+                    return {arrival, popped};
+                }
+            }
+        }
+    }
+
+    // number of packets in the ring; exact when called with the other side idle, otherwise a snapshot
+    [[nodiscard]] size_t read_available() const {
+        return packets_written.load(std::memory_order_relaxed) - packets_read.load(std::memory_order_relaxed);
+    }
+
+    // consumer side: discards all packets in the ring
+    void reset() {
+        size_t r = read_position.load(std::memory_order_relaxed);
+        cached_write_position = write_position.load(std::memory_order_acquire);
+        size_t n = 0;
+        while (r != cached_write_position) {
+            const record_prefix prefix = next_record();
+            n += (prefix.packet_bytes > 0) ? 1 : 0;
+            advance_read(prefix, r);
+        }
+        packets_read.store(packets_read.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        read_position.store(r, std::memory_order_release);
+        store_last_popped_timing(0, 0);
+    }
+
+    // bytes reserved for the ring
+    [[nodiscard]] size_t size_bytes() const { return ring_bytes; }
+    // bytes of the reservation the ring has grown to use
+    [[nodiscard]] size_t used_size_bytes() const { return active_bytes.load(std::memory_order_relaxed); }
+
+  private:
+    struct record_prefix {
+        uint32_t record_bytes;
+        uint32_t packet_bytes;
+        // time of the push, if statistics are enabled
+        uint64_t enqueue_time;
+        // time the packet reached the host, or 0 if unknown
+        uint64_t arrival_time;
+    };
+
+    // publishes n of n_requested packets written up to position w
+    void publish_write(const size_t w, const size_t n, const size_t n_requested) {
+        if (n > 0) {
+            packets_written.store(packets_written.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            write_position.store(w, std::memory_order_release);
+        }
+        if (stats) {
+            stats->record_push(n, n_requested, w - read_position.load(std::memory_order_relaxed));
+        }
+    }
+
+    // writes p at position w and advances w past it, without publishing it to the consumer
+    bool write_record(const packet& p, size_t& w, const uint64_t enqueue_time, const uint64_t arrival_time) {
+        const size_t packet_bytes = p.hdr.packet_size;
+        if (packet_bytes < sizeof(packet_header) or packet_bytes > MAX_DATA_PACKET_BYTES) {
+            return false;
+        }
+        const size_t need = record_bytes(packet_bytes);
+        size_t active     = active_bytes.load(std::memory_order_relaxed);
+        // room is always left after a record for one marking the end of the part in use, so the
+        // reader always finds a marker before the writer goes back to the start
+        if (write_offset + need + record_alignment > active and active < ring_bytes) {
+            cached_read_position = read_position.load(std::memory_order_acquire);
+            const size_t used    = w - cached_read_position;
+            // the data does not wrap if every byte in use lies before the write offset, and only
+            // then is the reader sure never to reach the space past the end
+            if (used <= write_offset and 2 * (used + need) > active) {
+                active = std::min(ring_bytes, active + grow_bytes);
+                active_bytes.store(active, std::memory_order_relaxed);
+            }
+        }
+        const size_t skip = (write_offset + need + record_alignment > active) ? active - write_offset : 0;
+        if (active - (w - cached_read_position) < skip + need) {
+            cached_read_position = read_position.load(std::memory_order_acquire);
+            if (active - (w - cached_read_position) < skip + need) {
+                return false;
+            }
+        }
+        if (skip > 0) {
+            new (&buffer[write_offset]) record_prefix{(uint32_t)skip, 0, 0, 0};
+            w += skip;
+            write_offset = 0;
+        }
+        uint8_t* record = &buffer[write_offset];
+        new (record) record_prefix{(uint32_t)need, (uint32_t)packet_bytes, enqueue_time, arrival_time};
+        std::memcpy(record + sizeof(record_prefix), (const void*)&p, packet_bytes);
+        w += need;
+        write_offset += need;
+        return true;
+    }
+
+    // consumer only: publishes the last popped times with a sequence lock, so a reader on another
+    // thread never sees the arrival time of one packet with the pop time of another
+    void store_last_popped_timing(const uint64_t arrival, const uint64_t popped) {
+        const uint32_t sequence = timing_sequence.load(std::memory_order_relaxed);
+        timing_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        last_arrival_time.store(arrival, std::memory_order_relaxed);
+        last_pop_time.store(popped, std::memory_order_relaxed);
+        timing_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    [[nodiscard]] record_prefix next_record() const {
+        record_prefix prefix;
+        std::memcpy(&prefix, &buffer[read_offset], sizeof(record_prefix));
+        return prefix;
+    }
+
+    void advance_read(const record_prefix& prefix, size_t& r) {
+        r += prefix.record_bytes;
+        read_offset = (prefix.packet_bytes > 0) ? read_offset + prefix.record_bytes : 0;
+    }
+
+    static constexpr size_t round_up(const size_t n) { return (n + record_alignment - 1) & ~(record_alignment - 1); }
+
+    static constexpr size_t cache_line_bytes = 64;
+
+    // written by the producer, read by the consumer
+    alignas(cache_line_bytes) std::atomic<size_t> write_position = 0;
+    std::atomic<size_t> packets_written                          = 0;
+    // producer only
+    alignas(cache_line_bytes) size_t cached_read_position        = 0;
+    size_t write_offset                                          = 0;
+    // written by the consumer, read by the producer
+    alignas(cache_line_bytes) std::atomic<size_t> read_position  = 0;
+    std::atomic<size_t> packets_read                             = 0;
+    // consumer only
+    alignas(cache_line_bytes) size_t cached_write_position       = 0;
+    size_t read_offset                                           = 0;
+    // written by the consumer, read by any thread; odd while the times below are being written
+    std::atomic<uint32_t> timing_sequence                        = 0;
+    std::atomic<uint64_t> last_arrival_time                      = 0;
+    std::atomic<uint64_t> last_pop_time                          = 0;
+    // read-only after construction
+    alignas(cache_line_bytes) const size_t ring_bytes;
+    const size_t grow_bytes;
+    queue_memory storage;
+    uint8_t* const buffer;
+    std::unique_ptr<queue_statistics> stats;
+    // written only by the producer, as the ring grows
+    alignas(cache_line_bytes) std::atomic<size_t> active_bytes;
+};
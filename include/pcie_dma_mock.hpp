@@ -0,0 +1,123 @@
+// Copyright (c) 2024 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vxsdr_packets.hpp"
+#include "vxsdr_pcie.hpp"
+
+/*! @file pcie_dma_mock.hpp
+    @brief A software model of the vxsdr_dma driver and device, for running the PCIe transports without hardware.
+*/
+
+struct pcie_dma_mock_options {
+    unsigned tx_buffer_count = VXSDR_DMA_TX_BUF_CNT_MAX;
+    unsigned rx_buffer_count = VXSDR_DMA_RX_BUF_CNT_MAX;
+    unsigned buffer_bytes    = 16'384;
+    // size of the device's tx and rx buffers
+    unsigned tx_ddr_bytes    = 64 * 1024 * 1024;
+    unsigned rx_ddr_bytes    = 64 * 1024 * 1024;
+    // rate at which the device takes data from its tx buffer (0 for immediately)
+    double tx_drain_bytes_per_s = 0;
+    // whether the batched buffer ioctls of driver 2.04 are supported, or fail with ENOTTY as in earlier drivers
+    bool batch_ioctls = true;
+};
+
+// Emulates the driver's buffer checkout, upload and release semantics, buffer counts and timeouts, with the
+// DMA buffers in one shared memory region. The test or benchmark plays the device: device_put_rx() fills rx
+// buffers, and uploaded tx data packets are passed to the tx data handler. Data packets requesting an ack
+// are acked with the tx buffer use, and command packets get a response from the command handler (by default,
+// the command itself, marked as a response). All calls are thread-safe.
+class pcie_dma_mock : public pcie_dma_backend {
+  public:
+    explicit pcie_dma_mock(const pcie_dma_mock_options& options = {});
+    ~pcie_dma_mock() noexcept override;
+
+    pcie_dma_mock(const pcie_dma_mock&)            = delete;
+    pcie_dma_mock& operator=(const pcie_dma_mock&) = delete;
+    pcie_dma_mock(pcie_dma_mock&&)                 = delete;
+    pcie_dma_mock& operator=(pcie_dma_mock&&)      = delete;
+
+    int open(const std::string& path) override;
+    int close(int fd) override;
+    int ioctl(int fd, unsigned long request, unsigned long arg) override;
+    void* mmap(size_t length, int fd) override;
+    int munmap(void* addr, size_t length) override;
+    ssize_t read(int fd, void* buf, size_t n_bytes) override;
+    ssize_t write(int fd, const void* buf, size_t n_bytes) override;
+
+    // the device side: puts a packet in the next rx buffer, with the device's next sequence number, and
+    // returns false if no buffer is free
+    bool device_put_rx(const packet& p);
+    // called with each tx data packet uploaded (while the mock is locked, so it must not call the mock)
+    void set_tx_data_handler(std::function<void(const packet&)> handler);
+    // makes the response to each command packet written; a response with a packet_size of 0 is not sent
+    void set_command_handler(std::function<void(const packet& command, packet& response)> handler);
+
+    // counts of system calls made on the mock, and of tx data packets uploaded
+    [[nodiscard]] uint64_t ioctl_count() const;
+    [[nodiscard]] uint64_t tx_data_packets() const;
+
+  private:
+    int fail(const int error_code) const noexcept;
+    int checkout_tx(unsigned& index);
+    int upload_tx(const unsigned index, const size_t n_bytes, std::unique_lock<std::mutex>& lock);
+    int checkout_rx(std::unique_lock<std::mutex>& lock);
+    int release_rx(const unsigned n);
+    void drain_tx_ddr();
+    bool put_rx(const void* data, const size_t n_bytes);
+    uint8_t* buffer(const unsigned n) const noexcept;
+
+    static constexpr int mock_fd = 1000;
+
+    const pcie_dma_mock_options opts;
+    void* region        = nullptr;
+    size_t region_bytes = 0;
+    bool is_open        = false;
+
+    mutable std::mutex mutex;
+    std::condition_variable rx_ready;
+    std::condition_variable cmd_ready;
+
+    std::chrono::milliseconds tx_cmd_timeout{1500};
+    std::chrono::milliseconds rx_cmd_timeout{1500};
+    std::chrono::milliseconds tx_data_timeout{100};
+    std::chrono::milliseconds rx_data_timeout{500};
+
+    // buffers are mapped in order, tx or rx as selected by IOCTL_MMAP_TX_SEL
+    bool mmap_tx        = false;
+    unsigned tx_mapped  = 0;
+    unsigned rx_mapped  = 0;
+
+    // tx buffers free, and checked out (in checkout order)
+    std::deque<unsigned> tx_free;
+    std::deque<unsigned> tx_checked_out;
+    double tx_ddr_fill = 0;
+    std::chrono::steady_clock::time_point tx_drain_time;
+
+    // the rx ring, as counts since reset: buffers are filled at rx_head, checked out at rx_tail, and
+    // released at rx_released; one buffer is kept empty, so that a full ring is not taken as empty
+    uint64_t rx_head     = 0;
+    uint64_t rx_tail     = 0;
+    uint64_t rx_released = 0;
+    // sequence numbers of the packets the device sends on the data and command paths
+    uint16_t rx_sequence  = 0;
+    uint16_t cmd_sequence = 0;
+
+    std::deque<command_queue_element> cmd_responses;
+    std::function<void(const packet&)> tx_data_handler;
+    std::function<void(const packet&, packet&)> command_handler;
+
+    uint64_t n_ioctls     = 0;
+    uint64_t n_tx_packets = 0;
+};
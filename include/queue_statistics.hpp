@@ -0,0 +1,146 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/*! @file queue_statistics.hpp
+    @brief Optional occupancy, push failure, residency time and arrival latency statistics for the library's queues.
+*/
+
+// Each counter has a single writer: the producer records pushes and occupancy, and the consumer
+// records pops and residency times. Counters are updated with relaxed loads and stores rather
+// than read-modify-write operations, so recording costs a few plain instructions and never
+// contends with the other side; get() may be called from any thread and returns a snapshot.
+//
+// Occupancy is measured after each successful push, in the units the queue is sized in (elements,
+// or bytes for a packet_ring). Residency is the time from the push of an element to its pop, from
+// timestamps taken once per push or pop call. Arrival latency, for packets carrying the time they
+// reached the host, is the time from that arrival (by the host's real-time clock) to the pop.
+class queue_statistics {
+  public:
+    // occupancy histogram bins, each covering 1/occupancy_bins of the capacity
+    static constexpr size_t occupancy_bins = 10;
+    // time histogram bins: bin 0 is under 1 us, bin k is [2^(k-1), 2^k) us, and the last bin is open-ended
+    static constexpr size_t time_bins = 24;
+
+    explicit queue_statistics(const size_t queue_capacity) : capacity(std::max<size_t>(queue_capacity, 1)) {}
+
+    queue_statistics(const queue_statistics&)            = delete;
+    queue_statistics& operator=(const queue_statistics&) = delete;
+    queue_statistics(queue_statistics&&)                 = delete;
+    queue_statistics& operator=(queue_statistics&&)      = delete;
+
+    // a cheap monotonic timestamp in nanoseconds
+    static uint64_t timestamp() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // producer side: n_pushed of n_requested elements were accepted, leaving occupancy in the queue
+    void record_push(const size_t n_pushed, const size_t n_requested, const size_t occupancy) noexcept {
+        if (n_pushed < n_requested) {
+            add(push_failures, n_requested - n_pushed);
+        }
+        if (n_pushed == 0) {
+            return;
+        }
+        add(pushes, n_pushed);
+        if (occupancy > high_water_mark.load(std::memory_order_relaxed)) {
+            high_water_mark.store(occupancy, std::memory_order_relaxed);
+        }
+        add(occupancy_histogram[std::min(occupancy_bins - 1, occupancy * occupancy_bins / capacity)], 1);
+    }
+
+    // consumer side: n_popped elements were removed
+    void record_pop(const size_t n_popped) noexcept { add(pops, n_popped); }
+
+    // consumer side: n elements pushed at enqueue_time were popped at dequeue_time
+    void record_residency(const uint64_t enqueue_time, const uint64_t dequeue_time, const size_t n = 1) noexcept {
+        residency.record(enqueue_time, dequeue_time, n);
+    }
+
+    // consumer side: n elements which reached the host at arrival_time were popped at dequeue_time,
+    // both in nanoseconds since the epoch
+    void record_arrival_latency(const uint64_t arrival_time, const uint64_t dequeue_time, const size_t n = 1) noexcept {
+        arrival_latency.record(arrival_time, dequeue_time, n);
+    }
+
+    // the statistics as "<name>:<statistic>" entries; histogram entries are named by the lower
+    // edge of the bin
+    [[nodiscard]] std::map<std::string, int64_t> get(const std::string& name) const {
+        std::map<std::string, int64_t> stats;
+        stats[name + ":capacity"]        = (int64_t)capacity;
+        stats[name + ":pushes"]          = load(pushes);
+        stats[name + ":push_failures"]   = load(push_failures);
+        stats[name + ":pops"]            = load(pops);
+        stats[name + ":high_water_mark"] = load(high_water_mark);
+        for (size_t i = 0; i < occupancy_bins; i++) {
+            stats[name + ":occupancy_" + std::to_string(100 * i / occupancy_bins) + "_percent"] = load(occupancy_histogram[i]);
+        }
+        residency.get(stats, name + ":residency");
+        arrival_latency.get(stats, name + ":arrival_latency");
+        return stats;
+    }
+
+  private:
+    // a count, mean, maximum and histogram of time intervals, written by one side only
+    struct time_histogram {
+        std::atomic<uint64_t> count    = 0;
+        std::atomic<uint64_t> total_ns = 0;
+        std::atomic<uint64_t> max_ns   = 0;
+        std::array<std::atomic<uint64_t>, time_bins> bins = {};
+
+        void record(const uint64_t start_time, const uint64_t end_time, const size_t n) noexcept {
+            const uint64_t ns = (end_time > start_time) ? end_time - start_time : 0;
+            add(count, n);
+            add(total_ns, n * ns);
+            if (ns > max_ns.load(std::memory_order_relaxed)) {
+                max_ns.store(ns, std::memory_order_relaxed);
+            }
+            add(bins[std::min<size_t>(time_bins - 1, std::bit_width(ns / 1000))], n);
+        }
+
+        // adds "<prefix>_count", "<prefix>_mean_ns", "<prefix>_max_ns" and "<prefix>_<n>_us" entries,
+        // if any intervals were recorded
+        void get(std::map<std::string, int64_t>& stats, const std::string& prefix) const {
+            const int64_t n = load(count);
+            if (n > 0) {
+                stats[prefix + "_count"]   = n;
+                stats[prefix + "_mean_ns"] = load(total_ns) / n;
+                stats[prefix + "_max_ns"]  = load(max_ns);
+                for (size_t i = 0; i < time_bins; i++) {
+                    stats[prefix + "_" + std::to_string(i == 0 ? 0 : 1UL << (i - 1)) + "_us"] = load(bins[i]);
+                }
+            }
+        }
+    };
+
+    static void add(std::atomic<uint64_t>& counter, const uint64_t n) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    static int64_t load(const std::atomic<uint64_t>& counter) noexcept {
+        return (int64_t)counter.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t cache_line_bytes = 64;
+
+    const size_t capacity;
+    // written by the producer
+    alignas(cache_line_bytes) std::atomic<uint64_t> pushes          = 0;
+    std::atomic<uint64_t> push_failures                              = 0;
+    std::atomic<uint64_t> high_water_mark                            = 0;
+    std::array<std::atomic<uint64_t>, occupancy_bins> occupancy_histogram = {};
+    // written by the consumer
+    alignas(cache_line_bytes) std::atomic<uint64_t> pops            = 0;
+    time_histogram residency;
+    time_histogram arrival_latency;
+};
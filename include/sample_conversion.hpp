@@ -0,0 +1,97 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "vxsdr.hpp"
+
+/*! @file sample_conversion.hpp
+    @brief Conversions between user sample types and the @p vxsdr::wire_sample type.
+*/
+
+#ifdef VXSDR_HAS_FLOAT16
+// half precision conversions use vector kernels chosen at run time (see sample_conversion.cpp)
+void convert_from_wire_float16(const vxsdr::wire_sample* in, vxsdr::complex_float16* out, const size_t n);
+void convert_to_wire_float16(const vxsdr::complex_float16* in, vxsdr::wire_sample* out, const size_t n);
+#endif
+
+// the type of the real and imaginary parts of user sample type S
+template <typename S> struct sample_component {
+    using type = typename S::value_type;
+};
+#ifdef VXSDR_HAS_FLOAT16
+template <> struct sample_component<vxsdr::complex_float16> {
+    using type = _Float16;
+};
+#endif
+
+// converts n wire samples to the user sample type; floating-point types are scaled to [-1, 1)
+template <typename S> void convert_from_wire(const vxsdr::wire_sample* in, S* out, const size_t n) {
+    using T = typename sample_component<S>::type;
+    if constexpr(std::is_same<T, int16_t>()) {
+        std::copy_n(in, n, out);
+#ifdef VXSDR_HAS_FLOAT16
+    } else if constexpr(std::is_same<T, _Float16>()) {
+        convert_from_wire_float16(in, out, n);
+#endif
+    } else if constexpr(std::is_floating_point<T>()) {
+        constexpr T scale = 1.0 / 32'768.0;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = std::complex<T>(scale * (T)in[i].real(), scale * (T)in[i].imag());
+        }
+    }
+}
+
+// converts n samples of the user sample type to wire samples; floating-point types are scaled from [-1, 1]
+template <typename S> void convert_to_wire(const S* in, vxsdr::wire_sample* out, const size_t n) {
+    using T = typename sample_component<S>::type;
+    if constexpr(std::is_same<T, int16_t>()) {
+        // data is in native format -- just copy
+        std::copy_n(in, n, out);
+#ifdef VXSDR_HAS_FLOAT16
+    } else if constexpr(std::is_same<T, _Float16>()) {
+        convert_to_wire_float16(in, out, n);
+#endif
+    } else if constexpr(std::is_floating_point<T>()) {
+        // must convert data from float and scale it
+        constexpr T scale = 32'767.0;
+        for (size_t j = 0; j < n; j++) {
+#ifndef VXSDR_LIB_TRUNCATE_FLOAT_CONVERSION
+#if defined(VXSDR_COMPILER_CLANG) || defined(VXSDR_COMPILER_APPLECLANG) || defined(VXSDR_COMPILER_GCC)
+            // for float32 data (the only floating-point data currently supported),
+            // the implementation below is nearly as fast as truncating with clang++ or g++ with -fno-trapping-math,
+            // (which should be set by CMake when gcc is used)
+            // It rounds properly and quickly; however, it is untested with other compilers
+            T re = scale * in[j].real();
+            if (re > (T)0.0) {
+                re += (T)0.5;
+            } else {
+                re -= (T)0.5;
+            }
+            T im = scale * in[j].imag();
+            if (im > (T)0.0) {
+                im += (T)0.5;
+            } else {
+                im -= (T)0.5;
+            }
+            out[j] = std::complex<int16_t>((int16_t)(re), (int16_t)(im));
+#else // #if defined(VXSDR_COMPILER_CLANG) or defined(VXSDR_COMPILER_GCC)
+            // the implementation below rounds properly using a library routine; it can be several times slower
+            out[j] = std::complex<int16_t>((int16_t)std::lroundf(scale * in[j].real()),
+                                           (int16_t)std::lroundf(scale * in[j].imag()));
+#endif // #if defined(VXSDR_COMPILER_CLANG) or defined(VXSDR_COMPILER_GCC)
+#else // #ifndef VXSDR_LIB_TRUNCATE_FLOAT_CONVERSION
+            // truncate is fast but costs 6 dB in output noise floor
+            out[j] = std::complex<int16_t>((int16_t)(scale * in[j].real()),
+                                           (int16_t)(scale * in[j].imag()));
+#endif // #ifndef VXSDR_LIB_TRUNCATE_FLOAT_CONVERSION
+        }
+    }
+}
@@ -3,7 +3,47 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
 #include "vxsdr_net.hpp"
 
 int get_socket_mtu(net::ip::udp::socket& sock);
-int set_socket_dontfrag(net::ip::udp::socket& sock);
\ No newline at end of file
+int set_socket_dontfrag(net::ip::udp::socket& sock);
+
+// sets SO_BUSY_POLL and SO_PREFER_BUSY_POLL (Linux only); returns 0 if both are set, 1 if only
+// SO_BUSY_POLL is set (SO_PREFER_BUSY_POLL needs Linux 5.11 and CAP_NET_ADMIN), and -1 on failure
+int set_socket_busy_poll(net::ip::udp::socket& sock, const int busy_poll_us);
+
+// enables SO_TIMESTAMPING software receive time-stamps (Linux only); returns 0 on success and -1 on failure
+int set_socket_timestamping(net::ip::udp::socket& sock);
+
+// receives like sock.receive(), also setting arrival_time to the time the packet reached the host
+// in ns since the epoch on the system's real-time clock, or to 0 if the packet has none
+size_t receive_timestamped(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes, uint64_t& arrival_time,
+                           int& error_code);
+
+// sets UDP_GRO (Linux only), so the kernel may coalesce datagrams of the same size into one receive;
+// returns 0 on success and -1 on failure
+int set_socket_gro(net::ip::udp::socket& sock);
+
+// receives like receive_timestamped(); if the kernel coalesced several datagrams, sets segment_bytes
+// to the size of each (the last may be shorter), and otherwise to the size received
+size_t receive_coalesced(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes, size_t& segment_bytes,
+                         uint64_t& arrival_time, int& error_code);
+
+struct busy_poll_options {
+    // how long to spin without a packet before backing off
+    std::chrono::microseconds spin_time{1000};
+    // how long to sleep between receive attempts after that, until a packet arrives
+    std::chrono::microseconds idle_backoff{50};
+};
+
+// receives from a non-blocking socket, spinning until a packet arrives or stop_flag is set
+// (returning 0 with no error in that case); if arrival_time or segment_bytes is not null, they
+// are set as by receive_coalesced()
+size_t receive_polling(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes,
+                       const std::atomic<bool>& stop_flag, const busy_poll_options& options, int& error_code,
+                       uint64_t* arrival_time = nullptr, size_t* segment_bytes = nullptr);
\ No newline at end of file
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <cstdlib>
@@ -114,6 +115,59 @@ struct ProducerConsumerQueue {
     return true;
   }
 
+  /* This modification adds bulk operations which load the other side's index
+     and publish their own index once per call instead of once per record */
+
+  // copy up to n records into the queue; returns the number copied
+  size_t writeBulk(const T* records, size_t n) {
+    auto const currentWrite = writeIndex_.load(std::memory_order_relaxed);
+    auto const currentRead = readIndex_.load(std::memory_order_acquire);
+    size_t const free = currentRead > currentWrite
+        ? currentRead - currentWrite - 1
+        : size_ - currentWrite + currentRead - 1;
+    if (n > free) {
+      n = free;
+    }
+    if (n == 0) {
+      return 0;
+    }
+    size_t const first = std::min<size_t>(n, size_ - currentWrite);
+    std::uninitialized_copy_n(records, first, &records_[currentWrite]);
+    std::uninitialized_copy_n(records + first, n - first, records_);
+    auto nextRecord = currentWrite + n;
+    if (nextRecord >= size_) {
+      nextRecord -= size_;
+    }
+    writeIndex_.store(nextRecord, std::memory_order_release);
+    return n;
+  }
+
+  // move up to n records out of the queue; returns the number moved
+  size_t readBulk(T* records, size_t n) {
+    auto const currentRead = readIndex_.load(std::memory_order_relaxed);
+    auto const currentWrite = writeIndex_.load(std::memory_order_acquire);
+    size_t const available = currentWrite >= currentRead
+        ? currentWrite - currentRead
+        : size_ - currentRead + currentWrite;
+    if (n > available) {
+      n = available;
+    }
+    if (n == 0) {
+      return 0;
+    }
+    size_t const first = std::min<size_t>(n, size_ - currentRead);
+    std::move(&records_[currentRead], &records_[currentRead + first], records);
+    std::destroy_n(&records_[currentRead], first);
+    std::move(records_, records_ + (n - first), records + first);
+    std::destroy_n(records_, n - first);
+    auto nextRecord = currentRead + n;
+    if (nextRecord >= size_) {
+      nextRecord -= size_;
+    }
+    readIndex_.store(nextRecord, std::memory_order_release);
+    return n;
+  }
+
   // pointer to the value at the front of the queue (for use in-place) or
   // nullptr if empty.
   T* frontPtr() {
@@ -0,0 +1,127 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "memory_utils.hpp"
+
+/*! @file uring_socket.hpp
+    @brief io_uring receive and send paths for connected UDP sockets.
+*/
+
+// The rings are set up and driven with the io_uring system calls directly, so liburing is not
+// needed. Each ring is used by one thread only: the uring_receiver by the receiver thread, and
+// the uring_sender by the sender thread.
+class uring_ring {
+  public:
+    uring_ring(const uint32_t sq_entries, const uint32_t cq_entries);
+    ~uring_ring() noexcept;
+
+    uring_ring(const uring_ring&)            = delete;
+    uring_ring& operator=(const uring_ring&) = delete;
+    uring_ring(uring_ring&&)                 = delete;
+    uring_ring& operator=(uring_ring&&)      = delete;
+
+  protected:
+    // the next free submission entry (zeroed), or nullptr if the submission ring is full
+    void* next_sqe() noexcept;
+    // makes the entries from next_sqe() visible to the kernel, submits them, and waits for at
+    // least min_complete completions or timeout_ms (if not negative); returns 0 or an errno value
+    int submit_and_wait(const uint32_t min_complete, const int timeout_ms = -1) noexcept;
+    // takes back the entries from next_sqe() which the kernel has not yet consumed, so the memory
+    // they refer to can be reused; returns the number taken back
+    uint32_t withdraw_unsubmitted() noexcept;
+    // the oldest completion not yet consumed, or nullptr if there is none
+    const void* peek_cqe() const noexcept;
+    void consume_cqe() noexcept;
+
+    int ring_fd = -1;
+    uint32_t sq_pending = 0;
+
+  private:
+    void close_all() noexcept;
+
+    void* sq_map       = nullptr;
+    size_t sq_map_bytes = 0;
+    void* cq_map       = nullptr;
+    size_t cq_map_bytes = 0;
+    void* sqes         = nullptr;
+    size_t sqes_bytes  = 0;
+
+    uint32_t* sq_head  = nullptr;
+    uint32_t* sq_tail  = nullptr;
+    uint32_t* sq_array = nullptr;
+    uint32_t sq_mask   = 0;
+    uint32_t sq_size   = 0;
+    uint32_t* cq_head  = nullptr;
+    uint32_t* cq_tail  = nullptr;
+    void* cqes         = nullptr;
+    uint32_t cq_mask   = 0;
+
+    // local copies of the submission tail and completion head, published as needed
+    uint32_t sq_local_tail = 0;
+    uint32_t cq_local_head = 0;
+};
+
+struct uring_receiver_options {
+    // number of provided receive buffers; must be a power of 2, at most 32768
+    uint32_t buffer_count = 1024;
+    // bytes per buffer; packets longer than this are truncated
+    uint32_t buffer_bytes = 9216;
+    // allocation options for the buffers
+    queue_memory_options memory = {};
+};
+
+// Receives from a connected UDP socket with a single multishot receive, which keeps completing
+// as packets arrive without being resubmitted. The kernel picks a buffer for each packet from a
+// ring of provided buffers, and the buffer is returned to the ring as soon as the packet has
+// been copied out, so no system call is needed per packet while packets keep arriving.
+class uring_receiver : private uring_ring {
+  public:
+    uring_receiver(const int socket_fd, const uring_receiver_options& options = {});
+    ~uring_receiver() noexcept;
+
+    // copies the next packet (up to max_bytes) to dest and returns its size; returns 0 if no
+    // packet arrives within timeout_ms, and sets error_code on an error
+    size_t receive(void* dest, const size_t max_bytes, const int timeout_ms, int& error_code);
+
+    [[nodiscard]] size_t max_packet_bytes() const noexcept { return buffer_bytes; }
+
+  private:
+    void arm() noexcept;
+    void release_buffer(const uint16_t id) noexcept;
+
+    const int fd;
+    const uint32_t buffer_count;
+    const uint32_t buffer_bytes;
+    std::unique_ptr<queue_memory> buffers;
+    void* buffer_ring        = nullptr;
+    size_t buffer_ring_bytes = 0;
+    uint16_t buffer_ring_tail = 0;
+    bool armed = false;
+};
+
+// Sends on a connected UDP socket in batches: queue() adds a send to the submission ring, and
+// flush() submits the whole batch and waits for it to complete in a single system call. Packets
+// are sent from the caller's memory, which must not change until flush() returns.
+class uring_sender : private uring_ring {
+  public:
+    uring_sender(const int socket_fd, const uint32_t batch_size = 256);
+    ~uring_sender() noexcept = default;
+
+    // adds a send to the batch, flushing first if the batch is full; returns the number of
+    // earlier sends which failed in that flush, and sets error_code for the first of them
+    size_t queue(const void* data, const size_t n_bytes, int& error_code);
+    // submits the batch and waits for it to complete; returns the number of sends which failed,
+    // and sets error_code for the first of them; when it returns, no send refers to the caller's
+    // memory, and each send has been counted once, as sent or as failed
+    size_t flush(int& error_code);
+
+  private:
+    const int fd;
+    const uint32_t batch_size;
+};
@@ -14,10 +14,12 @@
 #include <string>
 #include <ratio>
 #include <map>
+#include <utility>
 #include <chrono>
 using namespace std::chrono_literals;
 
 #include "vxsdr_export.h"
+#include "vxsdr_config.h"
 
 /*! @file vxsdr.hpp
     @class vxsdr
@@ -29,9 +31,12 @@ class LIBVXSDR_EXPORT vxsdr {
   /*!
     @enum transport_type
     @brief The @p transport_type describes the transports used to send and receive data and commands.
-    (UDP is the default, and UDP and PCIE are currently the only transports supported.)
+    (UDP is the default. XDP is for data only, with commands sent by UDP; it receives data with
+    Linux AF_XDP sockets, and is only available if the library is built with VXSDR_ENABLE_XDP.
+    IO_URING is also for data only; it uses UDP sockets driven by Linux io_uring, and is only
+    available if the library is built with VXSDR_ENABLE_IO_URING.)
   */
-    enum transport_type { TRANSPORT_TYPE_UDP = 1, TRANSPORT_TYPE_PCIE };
+    enum transport_type { TRANSPORT_TYPE_UDP = 1, TRANSPORT_TYPE_PCIE, TRANSPORT_TYPE_XDP, TRANSPORT_TYPE_IO_URING };
   /*!
     @enum stream_state
     @brief The @p stream_state type reports the status of TX or RX data streaming.
@@ -66,6 +71,18 @@ class LIBVXSDR_EXPORT vxsdr {
   */
     using filter_coefficient = std::complex<int16_t>;
 
+#ifdef VXSDR_HAS_FLOAT16
+  /*!
+    @struct complex_float16
+    @brief The @p complex_float16 type holds a half precision sample, real part first; it is used instead of
+    @p std::complex<_Float16>, which the C++ standard leaves unspecified.
+  */
+    struct complex_float16 {
+        _Float16 real;
+        _Float16 imag;
+    };
+#endif
+
   /*!
     @brief The @p duration type is used for acquisition and wait durations; it has a 1 nanosecond resolution, although the
     granularity of the device clock may be larger.
@@ -1102,6 +1119,22 @@ class LIBVXSDR_EXPORT vxsdr {
                        const uint8_t subdev   = 0,
                        const double timeout_s = 10);
 
+#ifdef VXSDR_HAS_FLOAT16
+    /*!
+      @brief Send transmit data to the device.
+      @returns the number of samples placed in the queue for transmission
+      @param data the @p complex_float16 vector of data to be sent
+      @param n_requested the number of samples to be sent (0 means use data.size();
+          if data.size() \< n_requested, only data.size() will be sent)
+      @param subdev the subdevice number
+      @param timeout_s timeout in seconds
+    */
+    size_t put_tx_data(const std::vector<complex_float16>& data,
+                       size_t n_requested = 0,
+                       const uint8_t subdev   = 0,
+                       const double timeout_s = 10);
+#endif
+
     /*!
       @brief Receive data from the device and return it in a vector.
       @returns the number of samples received before a sequence error, or @p n_desired if no sequence errors occur
@@ -1130,6 +1163,22 @@ class LIBVXSDR_EXPORT vxsdr {
                        const uint8_t subdev = 0,
                        const double timeout_s = 10);
 
+#ifdef VXSDR_HAS_FLOAT16
+    /*!
+      @brief Receive data from the device and return it in a vector.
+      @returns the number of samples received before a sequence error, or @p n_desired if no sequence errors occur
+      @param data the @p complex_float16 vector for the received data
+      @param n_requested the number of samples to be received (0 means use data.size();
+          if data.size() \< n_requested, only data.size() will be acquired)
+      @param subdev the subdevice number
+      @param timeout_s timeout in seconds
+    */
+    size_t get_rx_data(std::vector<complex_float16>& data,
+                       const size_t n_requested = 0,
+                       const uint8_t subdev = 0,
+                       const double timeout_s = 10);
+#endif
+
    /*!
       @brief Set the timeout used by the host for commands sent to the device.
       We do not recommend values less than 0.5 seconds
@@ -1144,6 +1193,62 @@ class LIBVXSDR_EXPORT vxsdr {
     */
     [[nodiscard]] double get_host_command_timeout() const;
 
+    /*!
+      @brief Start collecting commands into a transaction. Until @p end_transaction is called, commands
+      which only report success (such as setting frequencies, gains, ports and filters, or stopping streams)
+      are collected instead of sent, and return @b true. Commands which return values from the device (other
+      than static properties already read; see @p clear_property_cache), starting streams, @p reset,
+      @p set_ipv4_address and @p save_ipv4_address fail while a transaction is open. Only commands made on
+      the thread which called @p begin_transaction are collected; commands from other threads are sent at
+      once, and @p end_transaction must be called on the same thread.
+      @returns @b true if a transaction was started, @b false if one is already open
+    */
+    bool begin_transaction();
+
+    /*!
+      @brief Send the commands collected since @p begin_transaction back-to-back, with several awaiting
+      responses at once, and wait for all of their responses. The device executes the commands in the
+      order they were given, so reconfiguring N settings takes about one round trip rather than N.
+      @returns a std::vector with @b true for each command which succeeded and @b false for each which
+      failed, in the order the commands were given; the std::vector is empty if no transaction was open
+    */
+    std::vector<bool> end_transaction();
+
+    /*!
+      @brief Clear the host's copy of the device's static properties. Properties which do not change while
+      the device runs (such as frequency, gain and rate ranges, the number and names of stages, ports and
+      sensors, filter lengths, and the number of subdevices and channels) are read from the device the
+      first time they are requested and returned from the host afterwards; after this call, they are read
+      from the device again. The copy is also cleared by @p reset.
+    */
+    void clear_property_cache();
+
+    /*!
+      @brief Read the static properties already requested from the device again, with the queries sent
+      together so that they take about one round trip.
+      @returns @b true if all of the properties were read, @b false otherwise
+    */
+    bool refresh_property_cache();
+
+    /*!
+      @brief Get statistics for the host library's internal queues. Statistics are only collected
+      if the @p queue_statistics entry of the configuration map passed to the constructor is nonzero.
+      @returns a std::map with entries named <tt>queue:statistic</tt>, such as <tt>tx_data_queue:high_water_mark</tt>;
+      the map is empty if statistics are not collected
+    */
+    [[nodiscard]] std::map<std::string, int64_t> get_queue_statistics() const;
+
+    /*!
+      @brief Get the arrival time and latency of the last data packet that @p get_rx_data took from a
+      subdevice's receive queue. Arrival times are only recorded if the data transport time-stamps
+      received packets, as set by the @p udp_data_transport:timestamping entry of the configuration map.
+      @param subdev the subdevice number
+      @returns a std::optional with a std::pair containing the time the packet reached the host, by the
+      host's clock, and the time in seconds from then until @p get_rx_data took it from the queue; the
+      std::optional is empty if no time-stamped packet has been received
+    */
+    [[nodiscard]] std::optional<std::pair<vxsdr::time_point, double>> get_rx_packet_timing(const uint8_t subdev = 0) const;
+
     /*!
       @brief Helper function to compute the sample granularity from the wire format returned by hello().
       @returns the sample granularity
@@ -1,13 +1,14 @@
 #ifndef _VXSDR_DMA_CMD_H
 #define _VXSDR_DMA_CMD_H
 
-#define VXSDR_DMA_DRIVER_VERSION "2.03"
+#define VXSDR_DMA_DRIVER_VERSION "2.04"
 
 #define ALTERA_DMA_DID 0xE003
 #define ALTERA_DMA_VID 0x1172
 
 #define VXSDR_DMA_TX_BUF_CNT_MAX 128
 #define VXSDR_DMA_RX_BUF_CNT_MAX 512
+#define VXSDR_DMA_BATCH_MAX       64
 
 #define ALTERA_IOC_MAGIC   0x66
 
@@ -40,6 +41,28 @@
 #define IOCTL_GET_RX_TAIL         _IO(ALTERA_IOC_MAGIC, 63)
 #define IOCTL_GET_RX_HEAD         _IO(ALTERA_IOC_MAGIC, 64)
 
+/* batched buffer ioctls (driver 2.04 and later; earlier drivers fail them with ENOTTY):
+ *   IOCTL_CHECKOUT_TX_BUFFERS          checks out up to count free tx buffers, returning their
+ *                                      indices and the number checked out in count
+ *   IOCTL_UPLOAD_TX_BUFFERS_BLOCKING   uploads the first count checked-out tx buffers, with
+ *                                      sizes in bytes, then releases all checked-out tx buffers
+ *   IOCTL_CHECKOUT_RX_BUFFERS_BLOCKING waits for a filled rx buffer, then checks out up to count
+ *                                      filled rx buffers, returning their indices and the number
+ *                                      checked out in count
+ *   IOCTL_RELEASE_RX_BUFFERS           releases the oldest arg checked-out rx buffers
+ * indices and sizes are in checkout order
+ */
+struct vxsdr_dma_batch {
+    unsigned int count;
+    unsigned int index[VXSDR_DMA_BATCH_MAX];
+    unsigned int bytes[VXSDR_DMA_BATCH_MAX];
+};
+
+#define IOCTL_CHECKOUT_TX_BUFFERS          _IOWR(ALTERA_IOC_MAGIC, 70, struct vxsdr_dma_batch)
+#define IOCTL_UPLOAD_TX_BUFFERS_BLOCKING   _IOW(ALTERA_IOC_MAGIC, 71, struct vxsdr_dma_batch)
+#define IOCTL_CHECKOUT_RX_BUFFERS_BLOCKING _IOWR(ALTERA_IOC_MAGIC, 72, struct vxsdr_dma_batch)
+#define IOCTL_RELEASE_RX_BUFFERS           _IO(ALTERA_IOC_MAGIC, 73)
+
 #define IOCTL_RX_CLEAR_DATA       _IO(ALTERA_IOC_MAGIC, 97)
 #define IOCTL_RX_CLEAR_CTRL       _IO(ALTERA_IOC_MAGIC, 98)
 #define IOCTL_TX_RESET            _IO(ALTERA_IOC_MAGIC, 99)
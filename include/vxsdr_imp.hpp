@@ -8,12 +8,16 @@
 #include <cstdint>
 #include <cstring>
 #include <fstream>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <vector>
 #include <span>
 #include <ratio>
 #include <string>
+#include <unordered_map>
 #include <array>
+#include <utility>
 #include <chrono>
 using namespace std::chrono_literals;
 
@@ -22,6 +26,7 @@ using namespace std::chrono_literals;
 #include "vxsdr_queues.hpp"
 #include "vxsdr_threads.hpp"
 #include "vxsdr_transport.hpp"
+#include "conversion_pool.hpp"
 
 #if !defined(VXSDR_ENABLE_UDP) && !defined(VXSDR_ENABLE_PCIE)
 #error "at least one transport must be enabled"
@@ -37,14 +42,22 @@ class vxsdr::imp {
     std::map<std::string, int64_t> default_config = {
         {"command_transport",             vxsdr::TRANSPORT_TYPE_UDP},
         {"data_transport",                vxsdr::TRANSPORT_TYPE_UDP},
-        {"async_message_handler",         vxsdr::ASYNC_FULL_LOG}
+        {"async_message_handler",         vxsdr::ASYNC_FULL_LOG},
+        {"conversion_pool:threads",                0},
+        {"conversion_pool:thread_affinity_offset", -1},
+        {"conversion_pool:min_packets",            64},
+        {"queue_statistics",                        0}
     };
 #else
     // make PCIe the default if UDP disabled (since one must be enabled)
     std::map<std::string, int64_t> default_config = {
         {"command_transport",             vxsdr::TRANSPORT_TYPE_PCIE},
         {"data_transport",                vxsdr::TRANSPORT_TYPE_PCIE},
-        {"async_message_handler",         vxsdr::ASYNC_FULL_LOG}
+        {"async_message_handler",         vxsdr::ASYNC_FULL_LOG},
+        {"conversion_pool:threads",                0},
+        {"conversion_pool:thread_affinity_offset", -1},
+        {"conversion_pool:min_packets",            64},
+        {"queue_statistics",                        0}
     };
     static constexpr bool udp_transport_enabled{false};
 #endif
@@ -62,9 +75,32 @@ class vxsdr::imp {
     static constexpr unsigned tx_data_queue_wait_us   = 100;
     static constexpr unsigned rx_data_queue_wait_us   = 100;
 
-    // timeout and wait for command responses from device
+    // timeout for command responses from device
     vxsdr::duration command_response_timeout                 = 1s;  // not static since user can set
-    static constexpr vxsdr::duration command_response_wait   = 1ms;
+
+    // commands collected between begin_transaction() and end_transaction(), with the work to do
+    // on the host if each succeeds
+    struct transaction_command {
+        command_queue_element packet{};
+        std::string name;
+        std::function<bool()> on_success;
+    };
+    std::mutex transaction_mutex;
+    bool transaction_open = false;
+    // only commands from the thread which began the transaction are collected
+    std::thread::id transaction_owner;
+    std::vector<transaction_command> transaction_commands;
+
+    // responses to queries for properties which do not change while the device runs (such as ranges,
+    // stage and port names, and counts), keyed by the query packet; filled as the queries are made,
+    // and cleared by reset()
+    struct cached_property {
+        command_queue_element command{};
+        command_queue_element response{};
+        std::string name;
+    };
+    std::mutex property_cache_mutex;
+    std::unordered_map<std::string, cached_property> property_cache;
 
     // timeout and wait between checks for transport to become ready
     static constexpr vxsdr::duration transport_ready_timeout = 1s;
@@ -84,6 +120,13 @@ class vxsdr::imp {
     std::unique_ptr<command_transport> command_tport{};
     std::unique_ptr<data_transport>    data_tport{};
 
+    // optional worker threads for converting large data requests in parallel
+    std::unique_ptr<conversion_pool> conv_pool{};
+    // requests needing fewer packets than this are converted on the calling thread
+    size_t conversion_min_packets = 0;
+    // maximum number of packets converted in parallel at once
+    static constexpr size_t conversion_batch_packets = 256;
+
   public:
     explicit imp(const std::map<std::string, int64_t>& config);
 
@@ -96,11 +139,11 @@ class vxsdr::imp {
     uint32_t get_library_version();
     uint32_t get_library_packet_version();
     std::vector<std::string> get_library_details();
-    template <typename T> size_t get_rx_data(std::vector<std::complex<T>>& data,
+    template <typename S> size_t get_rx_data(std::vector<S>& data,
                        size_t n_requested,
                        const uint8_t subdev,
                        const double timeout_s);
-    template <typename T> size_t put_tx_data(const std::vector<std::complex<T>>& data,
+    template <typename S> size_t put_tx_data(const std::vector<S>& data,
                        size_t n_requested,
                        const uint8_t subdev,
                        const double timeout_s);
@@ -217,6 +260,12 @@ class vxsdr::imp {
     std::optional<double> get_timing_resolution();
     bool set_host_command_timeout(const double timeout_s);
     [[nodiscard]] double get_host_command_timeout() const;
+    [[nodiscard]] std::map<std::string, int64_t> get_queue_statistics() const;
+    [[nodiscard]] std::optional<std::pair<vxsdr::time_point, double>> get_rx_packet_timing(const uint8_t subdev = 0) const;
+    bool begin_transaction();
+    std::vector<bool> end_transaction();
+    void clear_property_cache();
+    bool refresh_property_cache();
     std::vector<std::string> discover_ipv4_addresses(const std::string& local_addr,
                                                             const std::string& broadcast_addr,
                                                             const double timeout_s);
@@ -234,9 +283,30 @@ class vxsdr::imp {
     std::string radio_cmd_to_name(const uint8_t cmd) const;
     std::string async_msg_to_name(const uint8_t msg) const;
   private:
-    bool send_command_and_check_response(packet& p, const std::string& cmd_name = "unknown");
+    bool clear_data_buffer(const uint8_t subdev = 0);
+    // in a transaction, the command is collected rather than sent, and on_success (if given) is run
+    // only once the command succeeds
+    bool send_command_and_check_response(packet& p, const std::string& cmd_name = "unknown",
+                                         std::function<bool()> on_success = {});
     std::optional<command_queue_element> send_command_and_return_response(packet& p, const std::string& cmd_name = "unknown");
-    [[nodiscard]] bool cmd_queue_push_check(packet& p, const std::string& cmd_name = "unknown");
+    // sends the commands with several in flight at once, and returns the response to each (or nothing
+    // for a command which failed); the device still executes them in order
+    std::vector<std::optional<command_queue_element>> send_commands_and_return_responses(std::span<command_queue_element> commands,
+                                                                                        std::span<const std::string> cmd_names);
+    // true if the calling thread has a transaction open
+    bool in_transaction();
+    // returns the cached response to a query for a static property, asking the device only the first time
+    std::optional<command_queue_element> send_query_and_return_cached_response(packet& p, const std::string& cmd_name = "unknown");
+    std::string property_cache_key(const packet& p) const;
+    // checks that a stream is enabled and stopped, with both queries in flight at once
+    bool stream_can_start(const bool tx, const uint8_t subdev, const std::string& cmd_name);
+    vxsdr::stream_state stream_state_from_response(const command_queue_element& q, const bool tx) const;
+    [[nodiscard]] std::optional<uint64_t> submit_command(const packet& p, const std::string& cmd_name = "unknown");
+    [[nodiscard]] std::optional<command_queue_element> wait_for_response(const packet& p, const uint64_t id,
+                                                                         const std::string& cmd_name = "unknown");
+    // returns the response if it answers command p successfully, and logs why it does not otherwise
+    [[nodiscard]] std::optional<command_queue_element> check_response(const packet& p, const command_transport::command_response_status status,
+                                                                      const command_queue_element& q, const std::string& cmd_name);
     void async_handler(const vxsdr::async_message_handler output_type);
     void time_point_to_time_spec_t(const vxsdr::time_point& t, time_spec_t& ts) const;
     void duration_to_time_spec_t(const vxsdr::duration& d, time_spec_t& ts) const;
@@ -247,45 +317,22 @@ class vxsdr::imp {
     void throw_async_message_handler(const command_queue_element& a) const;
     std::map<std::string, int64_t> apply_config(const std::map<std::string, int64_t>& input_config) const;
     template <typename SampleType> std::span<SampleType> get_packet_data_span(packet& q) const {
-        constexpr unsigned packet_header_only_size = sizeof(packet_header);
-        constexpr unsigned packet_header_time_size = sizeof(packet_header) + sizeof(time_spec_t);
-        constexpr unsigned packet_header_stream_size = sizeof(packet_header) + sizeof(stream_spec_t);
-        constexpr unsigned packet_header_time_stream_size = sizeof(packet_header) + sizeof(time_spec_t) + sizeof(stream_spec_t);
-        constexpr unsigned sample_size = sizeof(SampleType);
-
-        SampleType* d;
-        unsigned data_samples = 0;
-        unsigned data_bytes = 0;
-        const unsigned packet_bytes = q.hdr.packet_size;
-
-        const bool has_time      = (bool)(q.hdr.flags & FLAGS_TIME_PRESENT);
-        const bool has_stream_id = (bool)(q.hdr.flags & FLAGS_STREAM_ID_PRESENT);
-
-        if (not has_time and not has_stream_id) {
-            auto* p = std::bit_cast<data_packet*>(&q);
-            data_bytes = packet_bytes - packet_header_only_size;
-            d = (SampleType*)p->data;
-        } else if (has_time and not has_stream_id) {
-            auto* p = std::bit_cast<data_packet_time*>(&q);
-            data_bytes = packet_bytes - packet_header_time_size;
-            d = (SampleType*)p->data;
-        } else if (has_stream_id and not has_time) {
-            auto* p = std::bit_cast<data_packet_stream*>(&q);
-            data_bytes = packet_bytes - packet_header_stream_size;
-            d = (SampleType*)p->data;
-        } else {
-            auto* p = std::bit_cast<data_packet_time_stream*>(&q);
-            data_bytes = packet_bytes - packet_header_time_stream_size;
-            d = (SampleType*)p->data;
-        }
-        if (data_bytes < sample_size) {
-            data_samples = 0;
-            d = nullptr;
-        } else {
-            data_samples = data_bytes / sample_size;
+        const unsigned preamble_bytes = data_packet_preamble_bytes[q.hdr.flags];
+        const unsigned packet_bytes   = q.hdr.packet_size;
+        if (packet_bytes < preamble_bytes + sizeof(SampleType)) {
+            return {};
         }
-        return std::span(d, data_samples);
+        auto* d = (SampleType*)((uint8_t*)&q + preamble_bytes);
+        return std::span(d, (packet_bytes - preamble_bytes) / sizeof(SampleType));
     }
+    // status returned by the specialized receive loop below
+    enum rx_loop_status { RX_LOOP_DONE, RX_LOOP_LAYOUT_CHANGED, RX_LOOP_TIMEOUT, RX_LOOP_ERROR };
+    template <unsigned LayoutFlags, typename S> rx_loop_status receive_packets(data_queue_element& q,
+                                                                             S* data,
+                                                                             size_t& n_received,
+                                                                             const size_t n_requested,
+                                                                             const uint8_t subdev,
+                                                                             const vxsdr::duration& timeout);
     template <typename SampleType>unsigned max_samples_per_packet(const unsigned payload_bytes) const {
       constexpr unsigned bytes_in_largest_header = sizeof(packet_header) + sizeof(time_spec_t) + sizeof(stream_spec_t);
       return (payload_bytes - bytes_in_largest_header) / sizeof(SampleType);
@@ -3,8 +3,13 @@
 
 #pragma once
 
+#include <array>
+#include <bit>
 #include <complex>
+#include <cstddef>
 #include <cstdint>
+#include <span>
+#include <type_traits>
 
 #include "packet_header.h"
 
@@ -187,6 +192,42 @@ class alignas(VXSDR_DATA_BUFFER_ALIGNMENT) data_queue_element : public largest_d
 
 #pragma pack(pop)
 
+// the header flags which determine where the payload starts in a data packet
+constexpr unsigned DATA_PACKET_LAYOUT_MASK = FLAGS_TIME_PRESENT | FLAGS_STREAM_ID_PRESENT;
+
+// size of the header, time and stream ID (if present) for each value of the header flags
+constexpr auto data_packet_preamble_bytes = [] {
+    std::array<uint8_t, 1U << VXSDR_FLAGS_BITS> sizes{};
+    for (unsigned flags = 0; flags < sizes.size(); flags++) {
+        sizes[flags] = sizeof(packet_header) + ((flags & FLAGS_TIME_PRESENT) != 0 ? sizeof(time_spec_t) : 0) +
+                       ((flags & FLAGS_STREAM_ID_PRESENT) != 0 ? sizeof(stream_spec_t) : 0);
+    }
+    return sizes;
+}();
+
+// A view of a data packet whose layout is known at compile time; Flags is the value of
+// (hdr.flags & DATA_PACKET_LAYOUT_MASK), which is constant within a stream, so loops
+// specialized on it need no per-packet decoding of the header
+template <unsigned Flags> class data_packet_view {
+    static_assert((Flags & ~DATA_PACKET_LAYOUT_MASK) == 0, "data_packet_view flags must only include layout flags");
+
+  public:
+    using packet_type = std::conditional_t<(Flags & FLAGS_TIME_PRESENT) != 0,
+                                           std::conditional_t<(Flags & FLAGS_STREAM_ID_PRESENT) != 0, data_packet_time_stream, data_packet_time>,
+                                           std::conditional_t<(Flags & FLAGS_STREAM_ID_PRESENT) != 0, data_packet_stream, data_packet>>;
+    static constexpr unsigned flags          = Flags;
+    static constexpr size_t preamble_bytes   = data_packet_preamble_bytes[Flags];
+
+    template <typename SampleType> static std::span<SampleType> samples(packet& p) noexcept {
+        const size_t packet_bytes = p.hdr.packet_size;
+        if (packet_bytes < preamble_bytes + sizeof(SampleType)) {
+            return {};
+        }
+        auto* d = (SampleType*)(std::bit_cast<packet_type*>(&p)->data);
+        return std::span(d, (packet_bytes - preamble_bytes) / sizeof(SampleType));
+    }
+};
+
 // checks to ensure that sizes of these objects are as expected
 VXSDR_CHECK_SIZE_EQUALS(time_spec_t, 8);
 VXSDR_CHECK_SIZE_EQUALS(stream_spec_t, 8);
@@ -213,3 +254,5 @@ VXSDR_CHECK_SIZE_EQUALS(largest_cmd_or_rsp_packet, MAX_CMD_RSP_PACKET_BYTES);
 VXSDR_CHECK_SIZE_EQUALS(async_msg_packet, 8);
 VXSDR_CHECK_SIZE_EQUALS(largest_data_packet, MAX_DATA_PACKET_BYTES);
 VXSDR_CHECK_SIZE_LESS_EQUAL(largest_data_packet, sizeof(data_queue_element));
+static_assert(data_packet_view<0>::preamble_bytes == sizeof(packet_header));
+static_assert(data_packet_view<DATA_PACKET_LAYOUT_MASK>::preamble_bytes == sizeof(largest_data_packet) - MAX_DATA_PAYLOAD_BYTES);
@@ -7,7 +7,12 @@
 #include <algorithm>
 #include <bit>
 #include <cerrno>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 
@@ -20,8 +25,35 @@
 #include "vxsdr_dma_cmd.h"
 
 
+// The system calls pcie_dma_interface makes on the driver. The device backend passes them to the kernel
+// module; other backends (such as pcie_dma_mock) can stand in for the device and driver.
+class pcie_dma_backend {
+    public:
+        virtual ~pcie_dma_backend() = default;
+        // each returns as the system call does, setting errno on an error
+        virtual int open(const std::string &path) = 0;
+        virtual int close(int fd) = 0;
+        virtual int ioctl(int fd, unsigned long request, unsigned long arg) = 0;
+        virtual void* mmap(size_t length, int fd) = 0;
+        virtual int munmap(void *addr, size_t length) = 0;
+        virtual ssize_t read(int fd, void *buf, size_t n_bytes) = 0;
+        virtual ssize_t write(int fd, const void *buf, size_t n_bytes) = 0;
+};
+
+class pcie_dma_device_backend : public pcie_dma_backend {
+    public:
+        int open(const std::string &path) override { return ::open(path.c_str(), O_RDWR); }
+        int close(int fd) override { return ::close(fd); }
+        int ioctl(int fd, unsigned long request, unsigned long arg) override { return ::ioctl(fd, request, arg); }
+        void* mmap(size_t length, int fd) override { return ::mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0); }
+        int munmap(void *addr, size_t length) override { return ::munmap(addr, length); }
+        ssize_t read(int fd, void *buf, size_t n_bytes) override { return ::read(fd, buf, n_bytes); }
+        ssize_t write(int fd, const void *buf, size_t n_bytes) override { return ::write(fd, buf, n_bytes); }
+};
+
 class pcie_dma_interface {
     private:
+        std::shared_ptr<pcie_dma_backend> backend;
         std::string dma_path;
         int dma_filedes = 0;
         size_t pcie_buffer_size = 0;
@@ -29,28 +61,46 @@ class pcie_dma_interface {
         int tx_ddr_size = 0;
         std::vector<void *> tx_buffer_ptrs;
         std::vector<void *> rx_buffer_ptrs;
+        // whether the driver has the batched buffer ioctls; cleared when it fails one with ENOTTY
+        bool tx_batches = true;
+        bool rx_batches = true;
+        vxsdr_dma_batch tx_batch = {};
+        vxsdr_dma_batch rx_batch = {};
+        unsigned tx_checked_out  = 0;
+        int dma_ioctl(const unsigned long request, const unsigned long arg) {
+            return backend->ioctl(dma_filedes, request, arg);
+        }
+        int dma_ioctl_ptr(const unsigned long request, void *arg) {
+            return backend->ioctl(dma_filedes, request, reinterpret_cast<unsigned long>(arg));
+        }
     public:
         pcie_dma_interface(const std::string dev_path = "/dev/vxsdr_dma",
+                           const int tx_cmd_timeout_ms = 1500, const int rx_cmd_timeout_ms = 1500,
+                           const int tx_data_timeout_ms = 100, const int rx_data_timeout_ms = 500)
+            : pcie_dma_interface(std::make_shared<pcie_dma_device_backend>(), dev_path,
+                                 tx_cmd_timeout_ms, rx_cmd_timeout_ms, tx_data_timeout_ms, rx_data_timeout_ms) {}
+        pcie_dma_interface(std::shared_ptr<pcie_dma_backend> dma_backend, const std::string dev_path = "/dev/vxsdr_dma",
                            const int tx_cmd_timeout_ms = 1500, const int rx_cmd_timeout_ms = 1500,
                            const int tx_data_timeout_ms = 100, const int rx_data_timeout_ms = 500) {
+            backend  = std::move(dma_backend);
             dma_path = dev_path;
             LOG_DEBUG("pcie_dma_interface constructor entered");
             LOG_DEBUG("pcie_dma_interface attempting to open {:s}", dma_path);
 
-            dma_filedes = open(dma_path.c_str(), O_RDWR);
+            dma_filedes = backend->open(dma_path);
             if (dma_filedes == -1) {
                 LOG_ERROR("pcie_dma_interface unable to open dma at path {:s}", dma_path);
                 throw std::runtime_error("pcie_dma_interface unable to open dma");
             }
 
             // clear the rx data buffer
-            int result = ioctl(dma_filedes, IOCTL_RX_CLEAR_DATA, 0);
+            int result = dma_ioctl(IOCTL_RX_CLEAR_DATA, 0);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface error clearing rx data buffer");
                 throw std::runtime_error("pcie_dma_interface error clearing rx data buffer");
             }
 
-            result = ioctl(dma_filedes, IOCTL_GET_DATA_MSG_BUFFER_SIZE, 0);
+            result = dma_ioctl(IOCTL_GET_DATA_MSG_BUFFER_SIZE, 0);
             if (result <= 0) {
                 LOG_ERROR("pcie_dma_interface incorrect dma buffer size returned");
                 throw std::runtime_error("pcie_dma_interface incorrect dma buffer size returned");
@@ -58,7 +108,7 @@ class pcie_dma_interface {
             pcie_buffer_size = result;
             LOG_DEBUG("pcie_dma_interface IOCTL_BUF_SIZE: {:d}", pcie_buffer_size);
 
-            result = ioctl(dma_filedes, IOCTL_TX_BUFFER_CNT, 0);
+            result = dma_ioctl(IOCTL_TX_BUFFER_CNT, 0);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface incorrect tx buffer count returned");
                 throw std::runtime_error("pcie_dma_interface incorrect tx buffer count returned");
@@ -66,7 +116,7 @@ class pcie_dma_interface {
             LOG_DEBUG("pcie_dma_interface IOCTL_TX_BUF_CNT: {:d}", result);
             tx_buffer_ptrs.resize(result);
 
-            result = ioctl(dma_filedes, IOCTL_RX_BUFFER_CNT, 0);
+            result = dma_ioctl(IOCTL_RX_BUFFER_CNT, 0);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface incorrect rx buffer count returned");
                 throw std::runtime_error("pcie_dma_interface incorrect rx buffer count returned");
@@ -74,52 +124,52 @@ class pcie_dma_interface {
             LOG_DEBUG("pcie_dma_interface IOCTL_RX_BUF_CNT: {:d}", result);
             rx_buffer_ptrs.resize(result);
 
-            rx_ddr_size = ioctl(dma_filedes, IOCTL_GET_RX_DEV_DDR_SIZE, 0);
+            rx_ddr_size = dma_ioctl(IOCTL_GET_RX_DEV_DDR_SIZE, 0);
             LOG_DEBUG("pcie_dma_interface rx ddr buffer size: {:d}", rx_ddr_size);
 
-            tx_ddr_size = ioctl(dma_filedes, IOCTL_GET_TX_DEV_DDR_SIZE, 0);
+            tx_ddr_size = dma_ioctl(IOCTL_GET_TX_DEV_DDR_SIZE, 0);
             LOG_DEBUG("pcie_dma_interface tx ddr buffer size: {:d}", tx_ddr_size);
 
-            result = ioctl(dma_filedes, IOCTL_TX_BLOCK_TIMEOUT, tx_cmd_timeout_ms);
+            result = dma_ioctl(IOCTL_TX_BLOCK_TIMEOUT, tx_cmd_timeout_ms);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface error setting tx cmd pcie timeout");
                 throw std::runtime_error("pcie_dma_interface error setting tx cmd pcie timeout");
             }
 
-            result = ioctl(dma_filedes, IOCTL_RX_BLOCK_TIMEOUT, rx_cmd_timeout_ms);
+            result = dma_ioctl(IOCTL_RX_BLOCK_TIMEOUT, rx_cmd_timeout_ms);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface error setting rx cmd pcie timeout");
                 throw std::runtime_error("pcie_dma_interface error setting rx pcie cmd timeout");
             }
 
-            result = ioctl(dma_filedes, IOCTL_TX_IOCTL_BLOCK_TIMEOUT, tx_data_timeout_ms);
+            result = dma_ioctl(IOCTL_TX_IOCTL_BLOCK_TIMEOUT, tx_data_timeout_ms);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface error setting tx data pcie timeout");
                 throw std::runtime_error("pcie_dma_interface error setting tx data pcie timeout");
             }
 
-            result = ioctl(dma_filedes, IOCTL_RX_IOCTL_BLOCK_TIMEOUT, rx_data_timeout_ms);
+            result = dma_ioctl(IOCTL_RX_IOCTL_BLOCK_TIMEOUT, rx_data_timeout_ms);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface error setting rx data pcie timeout");
                 throw std::runtime_error("pcie_dma_interface error setting rx data pcie timeout");
             }
 
             // clear the rx cmd buffer
-            result = ioctl(dma_filedes, IOCTL_RX_CLEAR_CTRL, 0);
+            result = dma_ioctl(IOCTL_RX_CLEAR_CTRL, 0);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface error clearing rx cmd buffer");
                 throw std::runtime_error("pcie_dma_interface error clearing rx cmd buffer");
             }
 
             // reset the tx data cmd and data buffers
-            result = ioctl(dma_filedes, IOCTL_TX_RESET, 0);
+            result = dma_ioctl(IOCTL_TX_RESET, 0);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface error resetting cmd and data tx");
                 throw std::runtime_error("pcie_dma_interface error resetting cmd and data tx");
             }
 
             //select tx dma mmap linking
-            result = ioctl(dma_filedes, IOCTL_MMAP_TX_SEL, 1);
+            result = dma_ioctl(IOCTL_MMAP_TX_SEL, 1);
             if (result < 0) {
                 LOG_ERROR("pcie_dma_interface IOCTL_MMAP_TX_SEL(1) ioctl failed with return: {:d}", result);
                 throw std::runtime_error("pcie_dma_interface unable to select tx dma mmap linking");
@@ -127,14 +177,14 @@ class pcie_dma_interface {
 
             //create mmap associations for tx dma
             for (unsigned i = 0; i < tx_buffer_ptrs.size(); i++) {
-                tx_buffer_ptrs[i] = mmap(NULL, pcie_buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED, dma_filedes, 0);
+                tx_buffer_ptrs[i] = backend->mmap(pcie_buffer_size, dma_filedes);
                 if (tx_buffer_ptrs[i] == MAP_FAILED) {
                     LOG_ERROR("pcie_dma_interface mmap tx failed");
                     throw std::runtime_error("pcie_dma_interface unable to mmap tx buffer");
                 }
             }
 
-            result = ioctl(dma_filedes, IOCTL_MMAP_TX_SEL, 0);
+            result = dma_ioctl(IOCTL_MMAP_TX_SEL, 0);
             if (result < 0) {
                 LOG_ERROR("IOCTL_MMAP_TX_SEL(0) ioctl failed with return {:d}", result);
                 throw std::runtime_error("pcie_dma_interface unable to select rx dma mmap linking");
@@ -142,7 +192,7 @@ class pcie_dma_interface {
 
             //create mmap associations for rx dma
             for (unsigned i = 0; i < rx_buffer_ptrs.size(); i++) {
-                rx_buffer_ptrs[i] = mmap(NULL, pcie_buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED, dma_filedes, 0);
+                rx_buffer_ptrs[i] = backend->mmap(pcie_buffer_size, dma_filedes);
                 if (rx_buffer_ptrs[i] == MAP_FAILED) {
                     LOG_ERROR("pcie_dma_interface mmap rx failed");
                     throw std::runtime_error("pcie_dma_interface unable to mmap rx buffer");
@@ -156,19 +206,19 @@ class pcie_dma_interface {
 
             LOG_DEBUG("pcie_dma_interface releasing tx mmap regions");
             for (unsigned i = 0; i < tx_buffer_ptrs.size(); i++) {
-                munmap(tx_buffer_ptrs[i], pcie_buffer_size);
+                backend->munmap(tx_buffer_ptrs[i], pcie_buffer_size);
             }
             LOG_DEBUG("pcie_dma_interface releasing rx mmap regions");
             for (unsigned i = 0; i < rx_buffer_ptrs.size(); i++) {
-                munmap(rx_buffer_ptrs[i], pcie_buffer_size);
+                backend->munmap(rx_buffer_ptrs[i], pcie_buffer_size);
             }
 
             LOG_DEBUG("pcie_dma_interface closing file descriptor");
-            close(dma_filedes);
+            backend->close(dma_filedes);
             LOG_DEBUG("pcie_dma_interface destructor complete");
         }
         size_t pcie_dma_command_send(const void *buf_ptr, const size_t buf_size, int &error_code) {
-	        auto result = write(dma_filedes, buf_ptr, buf_size);
+	        auto result = backend->write(dma_filedes, buf_ptr, buf_size);
             if (result < 0) {
                 error_code = errno;
                 return 0;
@@ -177,7 +227,7 @@ class pcie_dma_interface {
             return result;
         }
         size_t pcie_dma_command_receive(void *buf_ptr, const size_t buf_size, int &error_code) {
-	        auto result = read(dma_filedes, buf_ptr, buf_size);
+	        auto result = backend->read(dma_filedes, buf_ptr, buf_size);
             if (result < 0) {
                 error_code = errno;
                 return 0;
@@ -190,38 +240,229 @@ class pcie_dma_interface {
             return result;
         }
         size_t pcie_dma_data_send(const void *buf_ptr, const size_t buf_size, int &error_code) {
-            int idx = ioctl(dma_filedes, IOCTL_CHECKOUT_TX_BUFFER, 0);
-            if (idx < 0) {
-                 error_code = errno;
+            size_t max_bytes = 0;
+            void* tx_ptr = pcie_dma_data_send_checkout(max_bytes, error_code);
+            if (tx_ptr == nullptr) {
                 return 0;
             }
-            memcpy(tx_buffer_ptrs[idx], buf_ptr, std::min(buf_size, pcie_buffer_size));
-            if (ioctl(dma_filedes, IOCTL_UPLOAD_TX_BUFFER_BLOCKING, buf_size) < 0) {
+            memcpy(tx_ptr, buf_ptr, std::min(buf_size, max_bytes));
+            return pcie_dma_data_send_submit(buf_size, error_code);
+        }
+        // checks out the next tx buffer and returns a pointer to the mmapped buffer, so that a packet of up
+        // to max_bytes can be built in place; pcie_dma_data_send_submit() sends it and returns the buffer,
+        // and pcie_dma_data_send_cancel() returns it unsent; returns nullptr on error
+        void* pcie_dma_data_send_checkout(size_t &max_bytes, int &error_code) {
+            max_bytes = 0;
+            int idx   = dma_ioctl(IOCTL_CHECKOUT_TX_BUFFER, 0);
+            if (idx < 0) {
                 error_code = errno;
-                ioctl(dma_filedes, IOCTL_RELEASE_TX_BUFFER, 0);
+                return nullptr;
+            }
+            if ((size_t)idx >= tx_buffer_ptrs.size()) {
+                dma_ioctl(IOCTL_RELEASE_TX_BUFFER, 0);
+                error_code = EINVAL;
+                return nullptr;
+            }
+            max_bytes  = pcie_buffer_size;
+            error_code = 0;
+            return tx_buffer_ptrs[idx];
+        }
+        // sends the first buf_size bytes of the buffer checked out by pcie_dma_data_send_checkout()
+        size_t pcie_dma_data_send_submit(const size_t buf_size, int &error_code) {
+            if (dma_ioctl(IOCTL_UPLOAD_TX_BUFFER_BLOCKING, buf_size) < 0) {
+                error_code = errno;
+                dma_ioctl(IOCTL_RELEASE_TX_BUFFER, 0);
                 return 0;
             }
-            if (ioctl(dma_filedes, IOCTL_RELEASE_TX_BUFFER, 0) < 0) {
+            if (dma_ioctl(IOCTL_RELEASE_TX_BUFFER, 0) < 0) {
                 error_code = errno;
                 return 0;
             }
             error_code = 0;
             return buf_size;
         }
+        bool pcie_dma_data_send_cancel(int &error_code) {
+            if (dma_ioctl(IOCTL_RELEASE_TX_BUFFER, 0) < 0) {
+                error_code = errno;
+                return false;
+            }
+            error_code = 0;
+            return true;
+        }
+        // checks out up to n tx buffers (at most VXSDR_DMA_BATCH_MAX) for packets of up to max_bytes, and stores
+        // pointers to them in tx_ptrs; returns the number checked out, or 0 on error; drivers without the
+        // batched ioctls check out one buffer at a time
+        unsigned pcie_dma_data_send_checkout_batch(void **tx_ptrs, const unsigned n, size_t &max_bytes, int &error_code) {
+            if (tx_batches) {
+                tx_batch.count = std::min(n, (unsigned)VXSDR_DMA_BATCH_MAX);
+                if (dma_ioctl_ptr(IOCTL_CHECKOUT_TX_BUFFERS, &tx_batch) >= 0) {
+                    tx_checked_out = std::min(tx_batch.count, (unsigned)VXSDR_DMA_BATCH_MAX);
+                    for (unsigned i = 0; i < tx_checked_out; i++) {
+                        if (tx_batch.index[i] >= tx_buffer_ptrs.size()) {
+                            pcie_dma_data_send_submit_batch(nullptr, 0, error_code);
+                            error_code = EINVAL;
+                            return 0;
+                        }
+                        tx_ptrs[i] = tx_buffer_ptrs[tx_batch.index[i]];
+                    }
+                    max_bytes  = pcie_buffer_size;
+                    error_code = (tx_checked_out > 0) ? 0 : EAGAIN;
+                    return tx_checked_out;
+                }
+                if (errno != ENOTTY) {
+                    error_code = errno;
+                    return 0;
+                }
+                LOG_INFO("pcie_dma_interface driver has no batched tx ioctls; using single buffers");
+                tx_batches = false;
+            }
+            tx_ptrs[0]     = pcie_dma_data_send_checkout(max_bytes, error_code);
+            tx_checked_out = (tx_ptrs[0] != nullptr) ? 1 : 0;
+            return tx_checked_out;
+        }
+        // sends the first n_filled buffers checked out by pcie_dma_data_send_checkout_batch(), with sizes in bytes,
+        // and returns all of the checked-out buffers to the driver; returns the number sent
+        unsigned pcie_dma_data_send_submit_batch(const size_t *bytes, const unsigned n_filled, int &error_code) {
+            const unsigned n = std::min(n_filled, tx_checked_out);
+            const bool any_checked_out = tx_checked_out > 0;
+            tx_checked_out = 0;
+            if (tx_batches) {
+                if (not any_checked_out) {
+                    error_code = 0;
+                    return 0;
+                }
+                tx_batch.count = n;
+                for (unsigned i = 0; i < n; i++) {
+                    tx_batch.bytes[i] = (unsigned)bytes[i];
+                }
+                if (dma_ioctl_ptr(IOCTL_UPLOAD_TX_BUFFERS_BLOCKING, &tx_batch) < 0) {
+                    error_code = errno;
+                    return 0;
+                }
+                error_code = 0;
+                return n;
+            }
+            if (n == 0) {
+                if (any_checked_out) {
+                    pcie_dma_data_send_cancel(error_code);
+                }
+                return 0;
+            }
+            return (pcie_dma_data_send_submit(bytes[0], error_code) == bytes[0]) ? 1 : 0;
+        }
         size_t pcie_dma_data_receive(void *buf_ptr, const size_t buf_size, int &error_code) {
-		    int idx = ioctl(dma_filedes, IOCTL_CHECKOUT_RX_BUFFER_BLOCKING, 0);
+            size_t bytes = 0;
+            const void* rx_ptr = pcie_dma_data_receive_borrow(bytes, error_code);
+            if (rx_ptr == nullptr) {
+                return 0;
+            }
+            auto bytes_to_copy = std::min(bytes, buf_size);
+            memcpy(buf_ptr, rx_ptr, bytes_to_copy);
+            if (not pcie_dma_data_receive_release(error_code)) {
+                return 0;
+            }
+            return bytes_to_copy;
+        }
+        // checks out the next rx buffer and returns a pointer to the packet in the mmapped buffer, which
+        // can be read in place until pcie_dma_data_receive_release() is called; returns nullptr on error
+        const void* pcie_dma_data_receive_borrow(size_t &bytes, int &error_code) {
+            bytes   = 0;
+            int idx = dma_ioctl(IOCTL_CHECKOUT_RX_BUFFER_BLOCKING, 0);
             if (idx < 0) {
                 error_code = errno;
-                return 0;
+                return nullptr;
+            }
+            if ((size_t)idx >= rx_buffer_ptrs.size()) {
+                dma_ioctl(IOCTL_RELEASE_RX_BUFFER, 0);
+                error_code = EINVAL;
+                return nullptr;
             }
             auto h_ptr = reinterpret_cast<packet_header *>(rx_buffer_ptrs[idx]);
-            auto bytes_to_copy = std::min((size_t)h_ptr->packet_size, std::min(buf_size, pcie_buffer_size));
-            memcpy(buf_ptr, rx_buffer_ptrs[idx], bytes_to_copy);
-            if (ioctl(dma_filedes, IOCTL_RELEASE_RX_BUFFER, 0) < 0) {
+            bytes      = std::min((size_t)h_ptr->packet_size, pcie_buffer_size);
+            error_code = 0;
+            return rx_buffer_ptrs[idx];
+        }
+        // returns the buffer checked out by pcie_dma_data_receive_borrow() to the driver
+        bool pcie_dma_data_receive_release(int &error_code) {
+            if (dma_ioctl(IOCTL_RELEASE_RX_BUFFER, 0) < 0) {
                 error_code = errno;
-                return 0;
+                return false;
             }
             error_code = 0;
-            return bytes_to_copy;
+            return true;
+        }
+        // the size of the device's tx buffer, in bytes (0 if unknown)
+        size_t pcie_dma_tx_ddr_size() const noexcept {
+            return (tx_ddr_size > 0) ? (size_t)tx_ddr_size : 0;
+        }
+        // the bytes in use in the device's tx buffer; returns -1 on error
+        int pcie_dma_tx_ddr_fill(int &error_code) {
+            int result = dma_ioctl(IOCTL_GET_TX_DEV_DDR_FILL, 0);
+            error_code = (result < 0) ? errno : 0;
+            return result;
+        }
+        // the number of filled rx buffers not yet checked out, from the ring indices: the device fills buffers
+        // at the head, and they are checked out from the tail; returns -1 on error. The driver never fills the
+        // last free buffer, so that head == tail always means the ring is empty; a driver which let the ring
+        // fill completely would have a full ring read here as empty, so pcie_dma_mock checks for this.
+        int pcie_dma_rx_buffers_ready(int &error_code) {
+            int head = dma_ioctl(IOCTL_GET_RX_HEAD, 0);
+            int tail = (head < 0) ? -1 : dma_ioctl(IOCTL_GET_RX_TAIL, 0);
+            if (head < 0 or tail < 0) {
+                error_code = errno;
+                return -1;
+            }
+            const int n_buffers = (int)rx_buffer_ptrs.size();
+            error_code = 0;
+            return (n_buffers > 0) ? ((head - tail) % n_buffers + n_buffers) % n_buffers : 0;
+        }
+        // checks out up to n filled rx buffers (at most VXSDR_DMA_BATCH_MAX), waiting for the first, and stores
+        // pointers to the packets in them and their sizes in rx_ptrs and bytes; the packets can be read in place
+        // until pcie_dma_data_receive_release_batch() is called; returns the number checked out, or 0 on error
+        unsigned pcie_dma_data_receive_borrow_batch(const void **rx_ptrs, size_t *bytes, const unsigned n, int &error_code) {
+            if (rx_batches) {
+                rx_batch.count = std::min(n, (unsigned)VXSDR_DMA_BATCH_MAX);
+                if (dma_ioctl_ptr(IOCTL_CHECKOUT_RX_BUFFERS_BLOCKING, &rx_batch) >= 0) {
+                    const unsigned n_checked_out = std::min(rx_batch.count, (unsigned)VXSDR_DMA_BATCH_MAX);
+                    for (unsigned i = 0; i < n_checked_out; i++) {
+                        if (rx_batch.index[i] >= rx_buffer_ptrs.size()) {
+                            dma_ioctl(IOCTL_RELEASE_RX_BUFFERS, n_checked_out);
+                            error_code = EINVAL;
+                            return 0;
+                        }
+                        auto h_ptr = reinterpret_cast<packet_header *>(rx_buffer_ptrs[rx_batch.index[i]]);
+                        rx_ptrs[i] = rx_buffer_ptrs[rx_batch.index[i]];
+                        bytes[i]   = std::min((size_t)h_ptr->packet_size, pcie_buffer_size);
+                    }
+                    error_code = (n_checked_out > 0) ? 0 : EAGAIN;
+                    return n_checked_out;
+                }
+                if (errno != ENOTTY) {
+                    error_code = errno;
+                    return 0;
+                }
+                LOG_INFO("pcie_dma_interface driver has no batched rx ioctls; using single buffers");
+                rx_batches = false;
+            }
+            rx_ptrs[0] = pcie_dma_data_receive_borrow(bytes[0], error_code);
+            return (rx_ptrs[0] != nullptr) ? 1 : 0;
+        }
+        // returns the n oldest buffers checked out by pcie_dma_data_receive_borrow_batch() to the driver
+        bool pcie_dma_data_receive_release_batch(const unsigned n, int &error_code) {
+            if (rx_batches) {
+                if (dma_ioctl(IOCTL_RELEASE_RX_BUFFERS, n) < 0) {
+                    error_code = errno;
+                    return false;
+                }
+                error_code = 0;
+                return true;
+            }
+            for (unsigned i = 0; i < n; i++) {
+                if (not pcie_dma_data_receive_release(error_code)) {
+                    return false;
+                }
+            }
+            error_code = 0;
+            return true;
         }
 };
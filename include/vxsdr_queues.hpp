@@ -3,10 +3,46 @@
 
 #pragma once
 
-#include <thread>
-#include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 
-#ifdef VXSDR_USE_BOOST_QUEUES
+// Each backend below is wrapped to give the same interface: push and pop of single elements,
+// bulk push and pop, read_available, and reset. The vxsdr_queue alias at the end of this file
+// selects the backend used by the library, wrapped to collect optional statistics; the others
+// remain available for benchmarking.
+
+#include "third_party/ProducerConsumerQueue.h"
+
+template<typename Element> class vxsdr_folly_queue : public folly::ProducerConsumerQueue<Element> {
+    public:
+        explicit vxsdr_folly_queue(const uint32_t size) : folly::ProducerConsumerQueue<Element>(size) {};
+
+        bool push(const Element& e) { return folly::ProducerConsumerQueue<Element>::write(e); };
+        size_t push(const Element* p, size_t n_max) { return folly::ProducerConsumerQueue<Element>::writeBulk(p, n_max); };
+        bool pop(Element& e) { return folly::ProducerConsumerQueue<Element>::read(e); };
+        size_t pop(Element* p, size_t n_max) { return folly::ProducerConsumerQueue<Element>::readBulk(p, n_max); };
+        size_t read_available() { return folly::ProducerConsumerQueue<Element>::sizeGuess(); };
+        void reset() { Element e; while(folly::ProducerConsumerQueue<Element>::read(e)); }
+};
+
+#include "cached_spsc_queue.hpp"
+
+template<typename Element> class vxsdr_cached_queue : public cached_spsc_queue<Element> {
+    public:
+        explicit vxsdr_cached_queue(const size_t size) : cached_spsc_queue<Element>(size) {};
+
+        bool push(const Element& e) { return cached_spsc_queue<Element>::write(e); };
+        size_t push(const Element* p, size_t n_max) { return cached_spsc_queue<Element>::write_bulk(p, n_max); };
+        bool pop(Element& e) { return cached_spsc_queue<Element>::read(e); };
+        size_t pop(Element* p, size_t n_max) { return cached_spsc_queue<Element>::read_bulk(p, n_max); };
+        size_t read_available() { return cached_spsc_queue<Element>::size_guess(); };
+        void reset() { Element e; while(cached_spsc_queue<Element>::read(e)); }
+};
+
+// the boost backend needs boost::lockfree, so it is only defined when selected, or
+// when VXSDR_ENABLE_BOOST_QUEUE is defined (as the queue benchmark does if boost is present)
+#if defined(VXSDR_USE_BOOST_QUEUE) || defined(VXSDR_ENABLE_BOOST_QUEUE)
 
 // Confines the boost specifics to this file
 
@@ -17,45 +53,94 @@
 
 #include <boost/lockfree/spsc_queue.hpp>
 
-template<typename Element> class vxsdr_queue : public boost::lockfree::spsc_queue<Element, boost::lockfree::fixed_sized<true>> {
+template<typename Element> class vxsdr_boost_queue : public boost::lockfree::spsc_queue<Element, boost::lockfree::fixed_sized<true>> {
     public:
-        explicit vxsdr_queue<Element>(const size_t size) : boost::lockfree::spsc_queue<Element, boost::lockfree::fixed_sized<true>>{size - 1} {};
+        explicit vxsdr_boost_queue(const size_t size) : boost::lockfree::spsc_queue<Element, boost::lockfree::fixed_sized<true>>{size - 1} {};
 };
 
-#else
+#endif
 
-#include "third_party/ProducerConsumerQueue.h"
+#include <memory>
+#include <vector>
+
+#include "queue_statistics.hpp"
 
-template<typename Element> class vxsdr_queue : public folly::ProducerConsumerQueue<Element> {
+// Adds optional statistics to a backend; until enable_statistics() is called, the only cost
+// is a test of a null pointer on each call. Residency times are kept in a ring of timestamps
+// indexed by element count: the producer writes the slots for the elements it is about to
+// push before publishing them, and the consumer reads them after it pops. The ring has room
+// for four queues' worth of timestamps, so the slots the producer writes (at most one queue's
+// worth ahead of the newest element) never overlap those the consumer has still to read (at
+// most two queues' worth behind it).
+template<typename Element, typename Queue> class vxsdr_measured_queue : public Queue {
     public:
-        explicit vxsdr_queue<Element>(const uint32_t size) : folly::ProducerConsumerQueue<Element>(size) {};
-
-        bool push(Element& e) { return folly::ProducerConsumerQueue<Element>::write(e); };
-        size_t push(Element* p, size_t n_max) {
-            size_t n_pushed = 0;
-            while (n_pushed < n_max) {
-                if (folly::ProducerConsumerQueue<Element>::write(*(p + n_pushed))) {
-                    n_pushed++;
-                } else {
-                    break;
+        explicit vxsdr_measured_queue(const size_t size) : Queue(size), queue_size(size) {};
+
+        // must be called before the queue is used; residency times are only kept if measure_residency is set
+        void enable_statistics(const bool measure_residency = false) {
+            stats = std::make_unique<queue_statistics>(queue_size - 1);
+            if (measure_residency) {
+                push_times.assign(4 * queue_size, 0);
+            }
+        }
+        [[nodiscard]] const queue_statistics* statistics() const { return stats.get(); }
+
+        bool push(const Element& e) { return push(&e, 1) == 1; };
+        size_t push(const Element* p, size_t n_max) {
+            if (not stats) {
+                return push_backend(p, n_max);
+            }
+            if (not push_times.empty()) {
+                const uint64_t now = queue_statistics::timestamp();
+                for (size_t i = 0; i < std::min(n_max, queue_size - 1); i++) {
+                    push_times[(n_pushed + i) % push_times.size()] = now;
                 }
             }
-            return n_pushed;
+            const size_t n = push_backend(p, n_max);
+            n_pushed += n;
+            stats->record_push(n, n_max, Queue::read_available());
+            return n;
         };
-        bool pop(Element& e) { return folly::ProducerConsumerQueue<Element>::read(e); };
+        bool pop(Element& e) { return pop(&e, 1) == 1; };
         size_t pop(Element* p, size_t n_max) {
-            size_t n_popped = 0;
-            while (n_popped < n_max) {
-                if (folly::ProducerConsumerQueue<Element>::read(*(p + n_popped))) {
-                    n_popped++;
-                } else {
-                    break;
+            const size_t n = pop_backend(p, n_max);
+            if (stats and n > 0) {
+                if (not push_times.empty()) {
+                    const uint64_t now = queue_statistics::timestamp();
+                    for (size_t i = 0; i < n; i++) {
+                        stats->record_residency(push_times[(n_popped + i) % push_times.size()], now);
+                    }
                 }
+                n_popped += n;
+                stats->record_pop(n);
             }
-            return n_popped;
+            return n;
         };
-        size_t read_available() { return folly::ProducerConsumerQueue<Element>::sizeGuess(); };
-        void reset() { Element e; while(folly::ProducerConsumerQueue<Element>::read(e)); }
+        void reset() { Element e; while (pop_backend(&e, 1) == 1) { n_popped++; } }
+
+    private:
+        size_t push_backend(const Element* p, size_t n_max) {
+            return (n_max == 1) ? (Queue::push(*p) ? 1 : 0) : Queue::push(p, n_max);
+        }
+        size_t pop_backend(Element* p, size_t n_max) {
+            return (n_max == 1) ? (Queue::pop(*p) ? 1 : 0) : Queue::pop(p, n_max);
+        }
+
+        const size_t queue_size;
+        std::unique_ptr<queue_statistics> stats;
+        std::vector<uint64_t> push_times;
+        // producer only
+        size_t n_pushed = 0;
+        // consumer only
+        size_t n_popped = 0;
 };
 
+#if defined(VXSDR_USE_BOOST_QUEUE)
+template<typename Element> using vxsdr_queue_backend = vxsdr_boost_queue<Element>;
+#elif defined(VXSDR_USE_CACHED_QUEUE)
+template<typename Element> using vxsdr_queue_backend = vxsdr_cached_queue<Element>;
+#else
+template<typename Element> using vxsdr_queue_backend = vxsdr_folly_queue<Element>;
 #endif
+
+template<typename Element> using vxsdr_queue = vxsdr_measured_queue<Element, vxsdr_queue_backend<Element>>;
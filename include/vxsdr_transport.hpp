@@ -5,12 +5,17 @@
 
 #include <array>
 #include <atomic>
+#include <cerrno>
 #include <complex>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
+#include <deque>
 #include <fstream>
+#include <mutex>
 #include <optional>
 #include <ratio>
+#include <span>
 #include <string>
 #include <stdexcept>
 #include <thread>
@@ -21,10 +26,17 @@ using namespace std::chrono_literals;
 #include "logging.hpp"
 #include "vxsdr_packets.hpp"
 #include "vxsdr_queues.hpp"
+#include "packet_ring.hpp"
 #include "thread_utils.hpp"
 #include "socket_utils.hpp"
 #include "vxsdr_net.hpp"
 #include "vxsdr_pcie.hpp"
+#ifdef VXSDR_ENABLE_XDP
+#include "xdp_socket.hpp"
+#endif
+#ifdef VXSDR_ENABLE_IO_URING
+#include "uring_socket.hpp"
+#endif
 
 #include "vxsdr.hpp"
 
@@ -141,6 +153,14 @@ class packet_transport {
         } else {
             LOG_WARN("   {:15d} send errors", send_errors);
         }
+        log_queue_statistics();
+    }
+    // statistics for the transport's queues, if enabled by the "queue_statistics" setting
+    virtual std::map<std::string, int64_t> get_queue_statistics() const { return {}; }
+    void log_queue_statistics() const {
+        for (const auto& stat : get_queue_statistics()) {
+            LOG_INFO("   {:15d} {:s}", stat.second, stat.first);
+        }
     }
     void set_log_stats_on_exit(const bool value) noexcept {
         log_stats_on_exit = value;
@@ -197,14 +217,7 @@ class packet_transport {
         return true;
     }
     size_t get_packet_preamble_size(const packet_header& hdr) const noexcept {
-        size_t preamble_size = sizeof(packet_header);
-        if ((bool)(hdr.flags & FLAGS_TIME_PRESENT)) {
-            preamble_size += sizeof(time_spec_t);
-        }
-        if ((bool)(hdr.flags & FLAGS_STREAM_ID_PRESENT)) {
-            preamble_size += sizeof(stream_spec_t);
-        }
-        return preamble_size;
+        return data_packet_preamble_bytes[hdr.flags];
     };
     std::string packet_type_to_string(const uint8_t number) const noexcept {
         switch (number) {
@@ -259,24 +272,88 @@ class packet_transport {
 };
 
 class command_transport : public packet_transport {
+  public:
+    using command_response_status = enum { COMMAND_RESPONSE_PENDING, COMMAND_RESPONSE_RECEIVED, COMMAND_RESPONSE_MISSING };
+
   protected:
-    static constexpr unsigned command_send_wait_us  =   500;
+    // the sender thread is woken when a command is queued; this only limits how long it takes to see a shutdown
+    static constexpr unsigned command_send_wait_us  = 10000;
     static constexpr unsigned queue_push_wait_us    =   500;
     static constexpr unsigned queue_push_tries      =    10;
 
+    // the number of commands which may be awaiting responses at once (set from the
+    // "<prefix>:commands_in_flight" setting, and at most max_commands_in_flight_limit)
+    static constexpr unsigned max_commands_in_flight_limit = 64;
+    unsigned max_commands_in_flight = 1;
+
+    // a command sent to the device and not yet collected by its sender; the device answers commands
+    // in the order it receives them, but a response carries the device's own sequence number rather
+    // than the command's, so each response is matched to the oldest outstanding command it answers
+    struct outstanding_command {
+        uint64_t id                    = 0;
+        uint8_t packet_type            = 0;
+        uint8_t command                = 0;
+        bool abandoned                 = false;
+        std::chrono::steady_clock::time_point abandon_time{};
+        command_response_status status = COMMAND_RESPONSE_PENDING;
+        command_queue_element response{};
+    };
+    std::mutex outstanding_mutex;
+    std::deque<outstanding_command> outstanding;
+    uint64_t next_command_id = 1;
+    // signalled (with outstanding_mutex) when a command is queued for the sender thread, and when
+    // a command stops awaiting its response
+    std::condition_variable command_queued;
+    std::condition_variable response_arrived;
+
+    // how long an abandoned command keeps its place; a late response normally arrives soon after the
+    // command times out, and if it never does, the command must not go on taking the responses to
+    // later commands of the same type
+    static constexpr vxsdr::duration abandoned_command_lifetime{250ms};
+    void expire_abandoned();
+
+    // stores a response for its command; returns false if no outstanding command matches it
+    bool match_response(const command_queue_element& response);
+    void clear_outstanding();
+    unsigned commands_awaiting_response() const;
+    command_response_status take_response(const uint64_t id, command_queue_element& response);
+
   public:
     command_transport() = default;
     virtual ~command_transport() = default;
 
-    // because every command has a response, the command and
-    // response queues are just used as interprocess comms mechanisms;
-    // there will never be more than one command or response in flight
-    vxsdr_queue<command_queue_element> command_queue{2};
-    vxsdr_queue<command_queue_element> response_queue{2};
+    // commands go to the sender thread through the command queue, which holds as many commands
+    // as may be in flight; responses are kept with their outstanding commands until collected
+    vxsdr_queue<command_queue_element> command_queue{max_commands_in_flight_limit + 1};
     vxsdr_queue<command_queue_element> async_msg_queue{1024};
 
     std::string get_payload_type() const noexcept final { return "command"; };
 
+    // queues a command for sending and returns the id used to collect its response, or nothing if
+    // the maximum number of commands are still in flight after waiting up to timeout
+    std::optional<uint64_t> submit_command(const packet& p, const vxsdr::duration timeout = vxsdr::duration::zero());
+    // collects the response to a submitted command; once the status returned is not
+    // COMMAND_RESPONSE_PENDING, the command is forgotten
+    command_response_status get_response(const uint64_t id, command_queue_element& response);
+    // as get_response(), but waits up to timeout for the response to arrive
+    command_response_status wait_for_response(const uint64_t id, command_queue_element& response, const vxsdr::duration timeout);
+    // stops waiting for a command's response, which is discarded if it arrives later
+    void abandon_command(const uint64_t id);
+    // sends the commands with as many awaiting responses at once as the transport allows, and waits up
+    // to timeout for each response; sets the status and response of each command (a command which
+    // times out is abandoned, and is left COMMAND_RESPONSE_PENDING), and returns the number sent,
+    // which is less than the number of commands only if the command queue stays full
+    size_t send_commands(std::span<const command_queue_element> commands, std::span<command_response_status> statuses,
+                         std::span<command_queue_element> responses, const vxsdr::duration timeout);
+    unsigned get_max_commands_in_flight() const noexcept { return max_commands_in_flight; };
+
+    // must be called before the sender and receiver threads start
+    void enable_queue_statistics() {
+        command_queue.enable_statistics();
+        async_msg_queue.enable_statistics();
+    }
+    std::map<std::string, int64_t> get_queue_statistics() const final;
+
     virtual size_t packet_receive(command_queue_element& packet, int& error_code) { return 0; };
 
     void command_send();
@@ -286,7 +363,7 @@ class command_transport : public packet_transport {
         if (not packet_transport::reset_rx()) {
             return false;
         }
-        response_queue.reset();
+        clear_outstanding();
         async_msg_queue.reset();
         return true;
     }
@@ -295,6 +372,7 @@ class command_transport : public packet_transport {
             return false;
         }
         command_queue.reset();
+        clear_outstanding();
         return true;
     }
 };
@@ -314,6 +392,17 @@ class data_transport : public packet_transport {
     virtual unsigned data_throttle_wait_us() const noexcept { return 100; };
     virtual unsigned data_send_wait_us() const noexcept     { return 100; };
 
+    // transports which batch sends submit the packets queued by packet_send() here; the packets
+    // must not change until it returns, and it returns the number which failed to send
+    virtual size_t packet_send_flush(int& error_code) { return 0; };
+    void flush_sends();
+
+    // transports which probe the path MTU at startup: the time to wait for each probe's ack, and
+    // the smallest packet (in samples) to try
+    virtual bool use_mtu_probing() const noexcept              { return false; };
+    virtual vxsdr::duration mtu_probe_timeout() const noexcept { return 100ms; };
+    virtual unsigned mtu_probe_min_samples() const noexcept    { return 0; };
+
 
     // how long to wait for a command response with stats at shutdown
     static constexpr vxsdr::duration final_stats_wait{20ms};
@@ -323,6 +412,20 @@ class data_transport : public packet_transport {
     std::atomic<unsigned> tx_buffer_size_bytes   {0};
     std::atomic<unsigned> tx_buffer_used_bytes   {0};
     std::atomic<unsigned> tx_buffer_fill_percent {0};
+    std::atomic<unsigned> tx_buffer_fill_percent_max {0};
+    void update_tx_buffer_fill(const unsigned used_bytes, const unsigned size_bytes) noexcept;
+
+    // transports which can read the device's tx buffer use directly do it here, instead of requesting
+    // acks from the device; returns false if the read failed
+    virtual bool use_tx_buffer_fill_reads() const noexcept { return false; };
+    virtual bool read_tx_buffer_fill() { return false; };
+    // for sends from send_packet_in_place(): reads the fill when due, and waits while the device's buffer
+    // is too full, as data_send() does
+    void pace_in_place_send();
+    uint64_t in_place_packets_sent = 0;
+    uint64_t in_place_last_check   = 0;
+    // the longest pace_in_place_send() waits for the buffer to drain before sending anyway
+    static constexpr vxsdr::duration max_in_place_fill_wait{1s};
 
     // number of samples in current stream (0 if continuous)
     uint64_t samples_expected_tx_stream = 0;
@@ -338,6 +441,17 @@ class data_transport : public packet_transport {
     uint64_t samples_received_current_stream = 0;
 
     std::atomic<unsigned> tx_packet_oos_count {0};
+    // number of tx data acks received, used to confirm probe packets
+    std::atomic<uint64_t> tx_acks_received    {0};
+
+    // transports which time-stamp received packets set this in packet_receive() to the time the packet
+    // reached the host, in ns since the epoch (0 if unknown); it is stored with the packet in the rx queue
+    uint64_t rx_arrival_time = 0;
+
+    // serializes the sends from data_send() with those from send_packet_in_place() on the producer's thread
+    std::mutex send_mutex;
+    // the packet send_packet_in_place() is sending, which packet_send() sends where it is, without copying
+    const packet* in_place_packet = nullptr;
 
   public:
 
@@ -351,8 +465,9 @@ class data_transport : public packet_transport {
     // single data queue for TX (since the device handles sending to the right subdevice)
     std::unique_ptr<vxsdr_queue<data_queue_element>> tx_data_queue;
     // vector of unique_ptrs to rx data queues, one for each subdevice
-    // (required since queue may not be moveable)
-    std::vector<std::unique_ptr<vxsdr_queue<data_queue_element>>> rx_data_queue;
+    // (required since queue may not be moveable); packets are stored at their
+    // actual size, so memory use depends on the packet size the device sends
+    std::vector<std::unique_ptr<packet_ring>> rx_data_queue;
     // sample queues for each device hold samples left over when the requested data
     // size is less than a full packet
     std::vector<std::unique_ptr<vxsdr_queue<vxsdr::wire_sample>>> rx_sample_queue;
@@ -361,12 +476,55 @@ class data_transport : public packet_transport {
 
     bool send_packet(packet& packet) final;
     virtual size_t packet_receive(data_queue_element& packet, int& error_code) { return 0; };
+    // transports which receive into memory they own can lend it instead of copying: packet_receive_borrow()
+    // returns the next packet in place (or nullptr on error), valid until packet_receive_release()
+    virtual bool use_borrowed_receive() const noexcept { return false; };
+    virtual const packet* packet_receive_borrow(size_t& bytes, int& error_code) { return nullptr; };
+    virtual bool packet_receive_release(int& error_code) { return true; };
+    // transports which send from memory the device reads can have packets built there: packet_send_checkout()
+    // returns a buffer for a packet of up to max_bytes (or nullptr on error), which packet_send() then sends
+    // in place, and packet_send_cancel() returns it unsent
+    virtual bool use_in_place_send() const noexcept { return false; };
+    virtual packet* packet_send_checkout(size_t& max_bytes, int& error_code) { return nullptr; };
+    virtual bool packet_send_cancel(int& error_code) { return true; };
+
+    // builds a packet with make(packet&) in the transport's send memory and sends it, in order with the
+    // packets sent by data_send(); returns false if it was not sent
+    template <typename F> bool send_packet_in_place(F&& make) {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        pace_in_place_send();
+        int err          = 0;
+        size_t max_bytes = 0;
+        packet* p        = packet_send_checkout(max_bytes, err);
+        if (p != nullptr) {
+            make(*p);
+            if (p->hdr.packet_size <= max_bytes) {
+                in_place_packet = p;
+                bool sent       = send_packet(*p);
+                in_place_packet = nullptr;
+                return sent;
+            }
+            packet_send_cancel(err);
+            err = EMSGSIZE;
+        }
+        tx_state = TRANSPORT_ERROR;
+        LOG_ERROR("send error in {:s} {:s} tx: {:s}", get_transport_type(), get_payload_type(), strerror(err));
+        send_errors++;
+        if (throw_on_tx_error) {
+            throw(std::runtime_error("send error in " + get_transport_type() + " " + get_payload_type() + " tx"));
+        }
+        return false;
+    }
 
     void data_send();
     void data_receive();
 
     void log_stats() const final;
 
+    // must be called after the queues are made and before the sender and receiver threads start
+    void enable_queue_statistics();
+    std::map<std::string, int64_t> get_queue_statistics() const final;
+
     bool reset_rx() final {
         if (not packet_transport::reset_rx()) {
             return false;
@@ -388,6 +546,9 @@ class data_transport : public packet_transport {
         samples_sent                = 0;
         send_errors_current_stream  = 0;
         samples_sent_current_stream = 0;
+        in_place_packets_sent       = 0;
+        in_place_last_check         = 0;
+        tx_buffer_fill_percent_max  = 0;
         tx_data_queue->reset();
         return true;
     }
@@ -415,6 +576,22 @@ class data_transport : public packet_transport {
         return max_samples_per_packet;
     }
 
+    // finds the largest packet (in samples, up to the current maximum) the device acknowledges, by
+    // sending tx data packets of zero samples with ack requests; must be called with tx stopped and
+    // the tx queue empty, and the device's data buffer should be cleared afterward; returns 0 if the
+    // transport does not probe, and the current maximum if no probe was acknowledged
+    unsigned probe_max_samples_per_packet();
+
+    // allocation options for the rx data queues from the "<prefix>:rx_data_queue_*" settings; the NUMA
+    // node is that of the receiver thread's cpu
+    static queue_memory_options rx_data_queue_memory_options(std::map<std::string, int64_t>& config, const std::string& prefix);
+
+    // bytes in an rx data queue holding n_packets of the largest size allowed by max_samples_per_packet
+    size_t rx_data_queue_bytes(const size_t n_packets) const noexcept {
+        return n_packets * packet_ring::record_bytes(data_packet_view<DATA_PACKET_LAYOUT_MASK>::preamble_bytes
+                                                     + max_samples_per_packet * sizeof(vxsdr::wire_sample));
+    }
+
     bool set_max_samples_per_packet(const unsigned n_samples) noexcept {
         if (n_samples > 0 and n_samples <= MAX_DATA_LENGTH_SAMPLES) {
             max_samples_per_packet = sample_granularity * (n_samples / sample_granularity);
@@ -427,7 +604,13 @@ class data_transport : public packet_transport {
 class udp_command_transport : public command_transport {
   protected:
     std::string get_transport_type() const noexcept final { return "udp"; };
-    std::map<std::string, int64_t> get_default_settings() const { return {}; };
+    std::map<std::string, int64_t> get_default_settings() const noexcept { return
+                                                      {{"udp_command_transport:busy_poll",                      0},
+                                                       {"udp_command_transport:busy_poll_us",                  50},
+                                                       {"udp_command_transport:busy_poll_spin_us",          1'000},
+                                                       {"udp_command_transport:busy_poll_backoff_us",          50},
+                                                       {"udp_command_transport:commands_in_flight",            16}};
+    };
     // timeouts for the UDP transport to reach ready state
     static constexpr auto udp_ready_timeout = 100'000us;
     static constexpr auto udp_ready_wait    =   1'000us;
@@ -442,6 +625,10 @@ class udp_command_transport : public command_transport {
     net::ip::udp::socket sender_socket;
     net::ip::udp::socket receiver_socket;
 
+    // in low-latency mode, the receiver spins on a non-blocking, busy-polled socket instead of blocking
+    bool busy_poll = false;
+    busy_poll_options poll_options;
+
   public:
     explicit udp_command_transport(const std::map<std::string, int64_t>& settings);
     ~udp_command_transport() noexcept;
@@ -457,9 +644,22 @@ class udp_data_transport : public data_transport {
     std::map<std::string, int64_t> get_default_settings() const noexcept { return
                                                       {{"udp_data_transport:tx_data_queue_packets",              512},
                                                        {"udp_data_transport:rx_data_queue_packets",           32'768},
+                                                       {"udp_data_transport:rx_data_queue_initial_packets",        0},
+                                                       {"udp_data_transport:rx_data_queue_huge_pages",             0},
+                                                       {"udp_data_transport:rx_data_queue_numa_local",             0},
+                                                       {"udp_data_transport:rx_data_queue_prefault",               0},
+                                                       {"udp_data_transport:rx_data_queue_lock",                   0},
                                                        {"udp_data_transport:mtu_bytes",                        9'000},
+                                                       {"udp_data_transport:mtu_probe",                            0},
+                                                       {"udp_data_transport:mtu_probe_timeout_ms",               100},
                                                        {"udp_data_transport:network_send_buffer_bytes",      262'144},
                                                        {"udp_data_transport:network_receive_buffer_bytes", 8'388'608},
+                                                       {"udp_data_transport:busy_poll",                            0},
+                                                       {"udp_data_transport:busy_poll_us",                        50},
+                                                       {"udp_data_transport:busy_poll_spin_us",                1'000},
+                                                       {"udp_data_transport:busy_poll_backoff_us",                50},
+                                                       {"udp_data_transport:timestamping",                         0},
+                                                       {"udp_data_transport:gro",                                  0},
                                                        {"udp_data_transport:thread_priority",                      1},
                                                        {"udp_data_transport:thread_affinity_offset",               0},
                                                        {"udp_data_transport:sender_thread_affinity",               0},
@@ -475,11 +675,41 @@ class udp_data_transport : public data_transport {
     static constexpr unsigned udp_host_data_send_port      = 55124;
     static constexpr unsigned udp_device_data_send_port    =  1031;
 
+    // packet size limits: the smallest MTU accepted, and the Ethernet MTU which probing starts from
+    static constexpr int min_mtu_bytes               =   576;
+    static constexpr int standard_mtu_bytes          = 1'500;
+    static constexpr int minimum_ip_udp_header_bytes =    28;
+
+    // path MTU probing settings
+    bool mtu_probing = false;
+    vxsdr::duration probe_timeout{100ms};
+    unsigned min_probe_samples = 0;
+    bool use_mtu_probing() const noexcept final                { return mtu_probing; };
+    vxsdr::duration mtu_probe_timeout() const noexcept final   { return probe_timeout; };
+    unsigned mtu_probe_min_samples() const noexcept final      { return min_probe_samples; };
+
     // net context and sockets
     net::io_context context;
     net::ip::udp::socket sender_socket;
     net::ip::udp::socket receiver_socket;
 
+    // in low-latency mode, the receiver spins on a non-blocking, busy-polled socket instead of blocking
+    bool busy_poll = false;
+    busy_poll_options poll_options;
+
+    // with time-stamping, packets are received with the time they reached the host
+    bool timestamping = false;
+
+    // with GRO, the kernel may deliver several packets in one receive; they are held in gro_buffer
+    // and returned one at a time by packet_receive()
+    static constexpr size_t gro_buffer_bytes = 65'536;
+    bool gro = false;
+    std::vector<uint8_t> gro_buffer;
+    size_t gro_bytes         = 0;
+    size_t gro_offset        = 0;
+    size_t gro_segment_bytes = 0;
+    uint64_t gro_arrival_time = 0;
+
     // transmit throttling settings
     bool use_tx_throttling() const noexcept final { return true; };
     unsigned throttle_hard_percent() const noexcept final { return  90; };
@@ -499,12 +729,146 @@ class udp_data_transport : public data_transport {
   protected:
     size_t packet_send(const packet& packet, int& error_code) final;
     size_t packet_receive(data_queue_element& packet, int& error_code) final;
+    size_t packet_receive_coalesced(data_queue_element& packet, int& error_code);
 };
 
+#ifdef VXSDR_ENABLE_XDP
+// sends data packets on a UDP socket like udp_data_transport, but receives them on an AF_XDP
+// socket, bypassing the kernel network stack; commands use the udp_command_transport
+class xdp_data_transport : public data_transport {
+  protected:
+    std::string get_transport_type() const noexcept final { return "xdp"; };
+    std::map<std::string, int64_t> get_default_settings() const noexcept { return
+                                                      {{"xdp_data_transport:tx_data_queue_packets",              512},
+                                                       {"xdp_data_transport:rx_data_queue_packets",           32'768},
+                                                       {"xdp_data_transport:rx_data_queue_initial_packets",        0},
+                                                       {"xdp_data_transport:rx_data_queue_huge_pages",             0},
+                                                       {"xdp_data_transport:rx_data_queue_numa_local",             0},
+                                                       {"xdp_data_transport:rx_data_queue_prefault",               0},
+                                                       {"xdp_data_transport:rx_data_queue_lock",                   0},
+                                                       {"xdp_data_transport:interface_index",                      0},
+                                                       {"xdp_data_transport:queue_id",                             0},
+                                                       {"xdp_data_transport:frame_count",                      4'096},
+                                                       {"xdp_data_transport:frame_bytes",                      4'096},
+                                                       {"xdp_data_transport:zero_copy",                            1},
+                                                       {"xdp_data_transport:network_send_buffer_bytes",      262'144},
+                                                       {"xdp_data_transport:thread_priority",                      1},
+                                                       {"xdp_data_transport:thread_affinity_offset",               0},
+                                                       {"xdp_data_transport:sender_thread_affinity",               0},
+                                                       {"xdp_data_transport:receiver_thread_affinity",             1}};
+    };
+
+    // timeouts for the XDP transport to reach ready state
+    static constexpr auto xdp_ready_timeout = 100'000us;
+    static constexpr auto xdp_ready_wait    =   1'000us;
+    // how long a receive waits for a packet before checking for shutdown
+    static constexpr int xdp_receive_timeout_ms = 10;
+
+    static constexpr unsigned udp_host_data_receive_port   =  1031;
+    static constexpr unsigned udp_device_data_receive_port =  1031;
+    static constexpr unsigned udp_host_data_send_port      = 55124;
+
+    net::io_context context;
+    net::ip::udp::socket sender_socket;
+    std::unique_ptr<xdp_socket> receiver_xsk;
+
+    // transmit throttling settings
+    bool use_tx_throttling() const noexcept final { return true; };
+    unsigned throttle_hard_percent() const noexcept final { return  90; };
+    unsigned throttle_on_percent() const noexcept final   { return  80; };
+    unsigned throttle_off_percent() const noexcept final  { return  60; };
+
+    unsigned data_send_wait_us() const noexcept final     { return 100; };
+    unsigned data_throttle_wait_us() const noexcept final { return  50; };
+
+  public:
+    explicit xdp_data_transport(const std::map<std::string, int64_t>& settings,
+                                const unsigned granularity,
+                                const unsigned n_subdevs,
+                                const unsigned max_samps_per_packet);
+    ~xdp_data_transport() noexcept;
+
+  protected:
+    size_t packet_send(const packet& packet, int& error_code) final;
+    size_t packet_receive(data_queue_element& packet, int& error_code) final;
+};
+#endif // #ifdef VXSDR_ENABLE_XDP
+
+#ifdef VXSDR_ENABLE_IO_URING
+// uses the same sockets as udp_data_transport, but receives with a multishot io_uring receive
+// and sends in batches, each submitted and completed with one system call; commands use the
+// udp_command_transport
+class uring_data_transport : public data_transport {
+  protected:
+    std::string get_transport_type() const noexcept final { return "io_uring"; };
+    std::map<std::string, int64_t> get_default_settings() const noexcept { return
+                                                      {{"uring_data_transport:tx_data_queue_packets",              512},
+                                                       {"uring_data_transport:rx_data_queue_packets",           32'768},
+                                                       {"uring_data_transport:rx_data_queue_initial_packets",        0},
+                                                       {"uring_data_transport:rx_data_queue_huge_pages",             0},
+                                                       {"uring_data_transport:rx_data_queue_numa_local",             0},
+                                                       {"uring_data_transport:rx_data_queue_prefault",               0},
+                                                       {"uring_data_transport:rx_data_queue_lock",                   0},
+                                                       {"uring_data_transport:receive_buffer_count",             1'024},
+                                                       {"uring_data_transport:receive_buffer_bytes",             9'216},
+                                                       {"uring_data_transport:send_batch_packets",                 256},
+                                                       {"uring_data_transport:network_send_buffer_bytes",      262'144},
+                                                       {"uring_data_transport:network_receive_buffer_bytes", 8'388'608},
+                                                       {"uring_data_transport:thread_priority",                      1},
+                                                       {"uring_data_transport:thread_affinity_offset",               0},
+                                                       {"uring_data_transport:sender_thread_affinity",               0},
+                                                       {"uring_data_transport:receiver_thread_affinity",             1}};
+    };
+
+    // timeouts for the io_uring transport to reach ready state
+    static constexpr auto uring_ready_timeout = 100'000us;
+    static constexpr auto uring_ready_wait    =   1'000us;
+    // how long a receive waits for a packet before checking for shutdown
+    static constexpr int uring_receive_timeout_ms = 10;
+
+    static constexpr unsigned udp_host_data_receive_port   =  1031;
+    static constexpr unsigned udp_device_data_receive_port =  1031;
+    static constexpr unsigned udp_host_data_send_port      = 55124;
+    static constexpr unsigned udp_device_data_send_port    =  1031;
+
+    net::io_context context;
+    net::ip::udp::socket sender_socket;
+    net::ip::udp::socket receiver_socket;
+    std::unique_ptr<uring_sender> sender_ring;
+    std::unique_ptr<uring_receiver> receiver_ring;
+    // failures found when packet_send() flushes a full batch, reported by packet_send_flush()
+    size_t earlier_send_failures = 0;
+    int earlier_send_error       = 0;
+
+    // transmit throttling settings
+    bool use_tx_throttling() const noexcept final { return true; };
+    unsigned throttle_hard_percent() const noexcept final { return  90; };
+    unsigned throttle_on_percent() const noexcept final   { return  80; };
+    unsigned throttle_off_percent() const noexcept final  { return  60; };
+
+    unsigned data_send_wait_us() const noexcept final     { return 100; };
+    unsigned data_throttle_wait_us() const noexcept final { return  50; };
+
+  public:
+    explicit uring_data_transport(const std::map<std::string, int64_t>& settings,
+                                  const unsigned granularity,
+                                  const unsigned n_subdevs,
+                                  const unsigned max_samps_per_packet);
+    ~uring_data_transport() noexcept;
+
+  protected:
+    size_t packet_send(const packet& packet, int& error_code) final;
+    size_t packet_send_flush(int& error_code) final;
+    size_t packet_receive(data_queue_element& packet, int& error_code) final;
+};
+#endif // #ifdef VXSDR_ENABLE_IO_URING
+
 class pcie_command_transport : public command_transport {
   protected:
     std::string get_transport_type() const noexcept final { return "pcie"; };
-    std::map<std::string, int64_t> get_default_settings() const noexcept { return {}; };
+    std::map<std::string, int64_t> get_default_settings() const noexcept { return
+                                                      {{"pcie_command_transport:commands_in_flight",           16}};
+    };
     // timeouts for the PCIe transport to reach ready state
     static constexpr auto pcie_ready_timeout = 100'000us;
     static constexpr auto pcie_ready_wait    =   1'000us;
@@ -526,20 +890,73 @@ class pcie_data_transport : public data_transport {
     std::map<std::string, int64_t> get_default_settings() const noexcept { return
                                                       {{"pcie_data_transport:tx_data_queue_packets",              512},
                                                        {"pcie_data_transport:rx_data_queue_packets",           32'768},
+                                                       {"pcie_data_transport:rx_data_queue_initial_packets",        0},
+                                                       {"pcie_data_transport:rx_data_queue_huge_pages",             0},
+                                                       {"pcie_data_transport:rx_data_queue_numa_local",             0},
+                                                       {"pcie_data_transport:rx_data_queue_prefault",               0},
+                                                       {"pcie_data_transport:rx_data_queue_lock",                   0},
                                                        {"pcie_data_transport:thread_priority",                      1},
                                                        {"pcie_data_transport:thread_affinity_offset",               0},
                                                        {"pcie_data_transport:sender_thread_affinity",               0},
-                                                       {"pcie_data_transport:receiver_thread_affinity",             1}};
+                                                       {"pcie_data_transport:receiver_thread_affinity",             1},
+                                                       {"pcie_data_transport:in_place_tx",                          1},
+                                                       {"pcie_data_transport:tx_batch_packets",                    32},
+                                                       {"pcie_data_transport:rx_batch_packets",                    32},
+                                                       {"pcie_data_transport:busy_poll",                            0},
+                                                       {"pcie_data_transport:busy_poll_spin_us",                1'000},
+                                                       {"pcie_data_transport:busy_poll_backoff_us",                50},
+                                                       {"pcie_data_transport:tx_throttling",                        1}};
     };
 
     // timeouts for the PCIe transport to reach ready state
     static constexpr auto pcie_ready_timeout = 100'000us;
     static constexpr auto pcie_ready_wait    =   1'000us;
 
-    bool use_tx_throttling() const noexcept final { return false; };
+    // transmit throttling settings; the device's buffer use is read through the driver
+    bool tx_throttling = false;
+    bool use_tx_throttling() const noexcept final { return tx_throttling; };
+    unsigned throttle_hard_percent() const noexcept final { return  90; };
+    unsigned throttle_on_percent() const noexcept final   { return  80; };
+    unsigned throttle_off_percent() const noexcept final  { return  60; };
+
+    unsigned data_send_wait_us() const noexcept final     { return 100; };
+    unsigned data_throttle_wait_us() const noexcept final { return  50; };
+
+    bool use_tx_buffer_fill_reads() const noexcept final { return tx_throttling; };
+    bool read_tx_buffer_fill() final;
+    bool fill_read_error_logged = false;
 
     std::shared_ptr<pcie_dma_interface> pcie_if = nullptr;
 
+    // whether put_tx_data() builds packets directly in the DMA buffers
+    bool in_place_tx = true;
+
+    // DMA buffers are checked out, sent and released in batches of up to these numbers of packets
+    unsigned tx_batch_packets = 1;
+    unsigned rx_batch_packets = 1;
+    // the tx buffers checked out for the current batch, and the sizes of the packets copied into them
+    std::array<void*, VXSDR_DMA_BATCH_MAX> tx_batch_ptrs{};
+    std::array<size_t, VXSDR_DMA_BATCH_MAX> tx_batch_bytes{};
+    unsigned tx_batch_checked_out = 0;
+    unsigned tx_batch_filled      = 0;
+    size_t tx_batch_max_bytes     = 0;
+    // failures found when packet_send() submits a full batch, reported by packet_send_flush()
+    size_t earlier_send_failures = 0;
+    int earlier_send_error       = 0;
+    // the rx buffers checked out, and the next one packet_receive_borrow() lends
+    std::array<const void*, VXSDR_DMA_BATCH_MAX> rx_batch_ptrs{};
+    std::array<size_t, VXSDR_DMA_BATCH_MAX> rx_batch_bytes{};
+    unsigned rx_batch_checked_out = 0;
+    unsigned rx_batch_next        = 0;
+
+    // the receiver polls the rx ring indices instead of sleeping in the driver, and checks out every
+    // filled buffer (up to VXSDR_DMA_BATCH_MAX) at once
+    bool busy_poll = false;
+    busy_poll_options poll_options;
+
+    void submit_tx_batch();
+    unsigned poll_rx_buffers(int& error_code);
+
   public:
     explicit pcie_data_transport(const std::map<std::string, int64_t>& settings,
                                  std::shared_ptr<pcie_dma_interface> pcie_iface,
@@ -550,5 +967,15 @@ class pcie_data_transport : public data_transport {
 
   protected:
     size_t packet_send(const packet& packet, int& error_code) final;
+    size_t packet_send_flush(int& error_code) final;
     size_t packet_receive(data_queue_element& packet, int& error_code) final;
+    // received packets are read in place from the DMA buffers, and copied once, into the rx queue
+    bool use_borrowed_receive() const noexcept final { return true; };
+    const packet* packet_receive_borrow(size_t& bytes, int& error_code) final;
+    bool packet_receive_release(int& error_code) final;
+
+  public:
+    bool use_in_place_send() const noexcept final { return in_place_tx; };
+    packet* packet_send_checkout(size_t& max_bytes, int& error_code) final;
+    bool packet_send_cancel(int& error_code) final;
 };
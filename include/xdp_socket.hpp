@@ -0,0 +1,98 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "memory_utils.hpp"
+
+/*! @file xdp_socket.hpp
+    @brief An AF_XDP socket which receives the UDP packets sent to one port on one network interface queue.
+*/
+
+struct xdp_socket_options {
+    // number of frames in the UMEM (also the size of the fill and rx rings); must be a power of 2
+    uint32_t frame_count = 4096;
+    // bytes per frame; must be a power of 2 from 2048 to the page size (or larger, for huge-page UMEMs on recent kernels)
+    uint32_t frame_bytes = 4096;
+    // try the driver's zero-copy mode first, falling back to copy mode if it is not supported
+    bool zero_copy = true;
+    // allocation options for the UMEM
+    queue_memory_options memory = {};
+};
+
+// Attaches a small XDP program to the interface which redirects IPv4 UDP packets for udp_port
+// arriving on queue queue_id to this socket, and passes everything else to the kernel stack as
+// usual. The program is built and loaded with the bpf() system call, so libbpf and libxdp are
+// not needed; it is attached through a BPF link, so it is detached when the socket is destroyed
+// or the process exits. Requires Linux 5.9 or later and CAP_NET_ADMIN, CAP_BPF and CAP_NET_RAW (or root).
+//
+// Packets are read directly from the UMEM shared with the driver, with no kernel socket
+// processing. Frames are returned to the driver, and the rx ring position published, in batches.
+// Only the receiver thread may call receive().
+class xdp_socket {
+  public:
+    xdp_socket(const unsigned ifindex, const uint32_t queue_id, const uint16_t udp_port, const xdp_socket_options& options = {});
+    ~xdp_socket() noexcept;
+
+    xdp_socket(const xdp_socket&)            = delete;
+    xdp_socket& operator=(const xdp_socket&) = delete;
+    xdp_socket(xdp_socket&&)                 = delete;
+    xdp_socket& operator=(xdp_socket&&)      = delete;
+
+    // copies the UDP payload of the next packet (up to max_bytes) to dest and returns its size;
+    // returns 0 if no packet arrives within timeout_ms, and sets error_code on an error
+    size_t receive(void* dest, const size_t max_bytes, const int timeout_ms, int& error_code);
+
+    // largest UDP payload that fits in a frame
+    [[nodiscard]] size_t max_payload_bytes() const noexcept;
+    // true if the driver is using zero-copy mode
+    [[nodiscard]] bool is_zero_copy() const noexcept { return zero_copy; }
+
+    // index of the interface with the given IPv4 address (in host byte order), or 0 if there is none
+    static unsigned interface_index(const uint32_t ipv4_address);
+
+  private:
+    struct ring {
+        uint32_t* producer = nullptr;
+        uint32_t* consumer = nullptr;
+        uint32_t* flags    = nullptr;
+        void* descriptors  = nullptr;
+        uint32_t mask      = 0;
+        void* map          = nullptr;
+        size_t map_bytes   = 0;
+    };
+
+    void map_ring(ring& r, const uint32_t size, const uint64_t offset, const void* ring_offsets, const size_t descriptor_bytes);
+    void unmap_ring(ring& r) noexcept;
+    // publishes the rx descriptors consumed and returns their frames to the fill ring
+    void release_frames();
+    void load_program(const uint16_t udp_port);
+    void close_all() noexcept;
+
+    // frames consumed from the rx ring are returned to the driver at least this often
+    static constexpr uint32_t release_batch = 64;
+
+    const uint32_t frame_count;
+    const uint32_t frame_bytes;
+    std::unique_ptr<queue_memory> umem;
+    int xsk_fd  = -1;
+    int map_fd  = -1;
+    int prog_fd = -1;
+    int link_fd = -1;
+    bool zero_copy = false;
+
+    ring fill;
+    ring completion;
+    ring rx;
+
+    // receiver thread only; descriptors between rx_released and rx_consumer have been read but
+    // their frames are not yet back in the fill ring
+    uint32_t rx_cached_producer = 0;
+    uint32_t rx_consumer        = 0;
+    uint32_t rx_released        = 0;
+    uint32_t fill_producer      = 0;
+};
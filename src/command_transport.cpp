@@ -1,7 +1,15 @@
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cstring>
 #include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <stdexcept>
 
@@ -12,6 +20,162 @@
 #include "vxsdr_queues.hpp"
 #include "vxsdr_transport.hpp"
 
+std::map<std::string, int64_t> command_transport::get_queue_statistics() const {
+    std::map<std::string, int64_t> stats;
+    if (command_queue.statistics() != nullptr) {
+        stats.merge(command_queue.statistics()->get("command_queue"));
+        stats.merge(async_msg_queue.statistics()->get("async_msg_queue"));
+    }
+    return stats;
+}
+
+std::optional<uint64_t> command_transport::submit_command(const packet& p, const vxsdr::duration timeout) {
+    command_queue_element q;
+    std::memcpy((void *)&q, &p, std::min((size_t)p.hdr.packet_size, sizeof(q)));
+
+    // the command is added to the table before it is queued, so its response cannot arrive first
+    std::unique_lock<std::mutex> lock(outstanding_mutex);
+    if (not response_arrived.wait_for(lock, timeout, [this] {
+            expire_abandoned();
+            return commands_awaiting_response() < max_commands_in_flight;
+        })) {
+        return std::nullopt;
+    }
+    const uint64_t id = next_command_id++;
+    outstanding.push_back({id, (uint8_t)(p.hdr.packet_type & PACKET_TYPE_MASK), (uint8_t)p.hdr.command});
+    if (not command_queue.push(q)) {
+        outstanding.pop_back();
+        return std::nullopt;
+    }
+    lock.unlock();
+    command_queued.notify_one();
+    return id;
+}
+
+command_transport::command_response_status command_transport::get_response(const uint64_t id, command_queue_element& response) {
+    std::lock_guard<std::mutex> lock(outstanding_mutex);
+    return take_response(id, response);
+}
+
+command_transport::command_response_status command_transport::wait_for_response(const uint64_t id, command_queue_element& response,
+                                                                                 const vxsdr::duration timeout) {
+    std::unique_lock<std::mutex> lock(outstanding_mutex);
+    response_arrived.wait_for(lock, timeout, [this, id] {
+        auto c = std::find_if(outstanding.begin(), outstanding.end(), [id](const outstanding_command& o) { return o.id == id; });
+        return c == outstanding.end() or c->status != COMMAND_RESPONSE_PENDING;
+    });
+    return take_response(id, response);
+}
+
+// must be called with outstanding_mutex held
+command_transport::command_response_status command_transport::take_response(const uint64_t id, command_queue_element& response) {
+    auto c = std::find_if(outstanding.begin(), outstanding.end(), [id](const outstanding_command& o) { return o.id == id; });
+    if (c == outstanding.end()) {
+        // forgotten by a reset
+        return COMMAND_RESPONSE_MISSING;
+    }
+    const auto status = c->status;
+    if (status == COMMAND_RESPONSE_RECEIVED) {
+        response = c->response;
+    }
+    if (status != COMMAND_RESPONSE_PENDING) {
+        outstanding.erase(c);
+    }
+    return status;
+}
+
+// must be called with outstanding_mutex held
+unsigned command_transport::commands_awaiting_response() const {
+    return (unsigned)std::count_if(outstanding.begin(), outstanding.end(),
+                                   [](const outstanding_command& c) { return c.status == COMMAND_RESPONSE_PENDING; });
+}
+
+void command_transport::abandon_command(const uint64_t id) {
+    std::lock_guard<std::mutex> lock(outstanding_mutex);
+    auto c = std::find_if(outstanding.begin(), outstanding.end(), [id](const outstanding_command& o) { return o.id == id; });
+    if (c != outstanding.end()) {
+        if (c->status == COMMAND_RESPONSE_PENDING) {
+            // keep its place for a while, so that a late response is not matched to a later command
+            c->abandoned    = true;
+            c->abandon_time = std::chrono::steady_clock::now();
+        } else {
+            outstanding.erase(c);
+        }
+    }
+}
+
+// must be called with outstanding_mutex held
+void command_transport::expire_abandoned() {
+    const auto now = std::chrono::steady_clock::now();
+    std::erase_if(outstanding, [now](const outstanding_command& o) {
+        return o.abandoned and now - o.abandon_time > abandoned_command_lifetime;
+    });
+}
+
+size_t command_transport::send_commands(std::span<const command_queue_element> commands, std::span<command_response_status> statuses,
+                                        std::span<command_queue_element> responses, const vxsdr::duration timeout) {
+    // responses are collected oldest first, keeping as many commands in flight as allowed
+    std::deque<std::pair<size_t, uint64_t>> in_flight;
+    size_t n_submitted = 0;
+    while (n_submitted < commands.size() or not in_flight.empty()) {
+        while (n_submitted < commands.size()) {
+            // with none in flight, commands abandoned earlier may still be taking up the slots, so wait for one
+            auto id = submit_command(commands[n_submitted], in_flight.empty() ? timeout : vxsdr::duration::zero());
+            if (not id) {
+                break;
+            }
+            in_flight.emplace_back(n_submitted++, id.value());
+        }
+        if (in_flight.empty()) {
+            for (size_t k = n_submitted; k < commands.size(); k++) {
+                statuses[k] = COMMAND_RESPONSE_MISSING;
+            }
+            return n_submitted;
+        }
+        auto [k, id] = in_flight.front();
+        in_flight.pop_front();
+        statuses[k] = wait_for_response(id, responses[k], timeout);
+        if (statuses[k] == COMMAND_RESPONSE_PENDING) {
+            abandon_command(id);
+        }
+    }
+    return n_submitted;
+}
+
+bool command_transport::match_response(const command_queue_element& response) {
+    std::lock_guard<std::mutex> lock(outstanding_mutex);
+    expire_abandoned();
+    auto c = std::find_if(outstanding.begin(), outstanding.end(), [&response](const outstanding_command& o) {
+        return o.status == COMMAND_RESPONSE_PENDING and o.packet_type == (response.hdr.packet_type & PACKET_TYPE_MASK)
+               and o.command == response.hdr.command;
+    });
+    if (c == outstanding.end()) {
+        return false;
+    }
+    // since responses arrive in command order, commands before this one still pending will never get theirs
+    for (auto m = outstanding.begin(); m != c; m++) {
+        if (m->status == COMMAND_RESPONSE_PENDING) {
+            m->status = COMMAND_RESPONSE_MISSING;
+            if (not m->abandoned) {
+                LOG_WARN("no response received to {:s} command (type {:d} command {:d})", get_transport_type(),
+                         m->packet_type, m->command);
+            }
+        }
+    }
+    c->status   = COMMAND_RESPONSE_RECEIVED;
+    c->response = response;
+    // abandoned commands have no one to collect them
+    std::erase_if(outstanding, [](const outstanding_command& o) { return o.abandoned and o.status != COMMAND_RESPONSE_PENDING; });
+    response_arrived.notify_all();
+    return true;
+}
+
+void command_transport::clear_outstanding() {
+    std::lock_guard<std::mutex> lock(outstanding_mutex);
+    outstanding.clear();
+    response_arrived.notify_all();
+}
+
 void command_transport::command_send() {
     LOG_DEBUG("{:s} command tx started", get_transport_type());
     const std::string transport_type = get_transport_type();
@@ -24,7 +188,9 @@ void command_transport::command_send() {
         if (command_queue.pop(packet_buffer)) {
             send_packet(packet_buffer);
         } else {
-            std::this_thread::sleep_for(std::chrono::microseconds(command_send_wait_us));
+            std::unique_lock<std::mutex> lock(outstanding_mutex);
+            command_queued.wait_for(lock, std::chrono::microseconds(command_send_wait_us),
+                                    [this] { return command_queue.read_available() > 0 or sender_thread_stop_flag; });
         }
     }
 
@@ -110,21 +276,11 @@ void command_transport::command_receive() {
                         case PACKET_TYPE_DEVICE_CMD_ERR:
                         case PACKET_TYPE_TX_RADIO_CMD_ERR:
                         case PACKET_TYPE_RX_RADIO_CMD_ERR:
-                        {
-                            unsigned n_tries = 0;
-                            while (not response_queue.push(recv_buffer) and n_tries < queue_push_tries) {
-                                std::this_thread::sleep_for(std::chrono::microseconds(queue_push_wait_us));
-                                n_tries++;
-                            }
-                            if (n_tries >= queue_push_tries) {
-                                rx_state = TRANSPORT_ERROR;
-                                LOG_ERROR("timeout pushing to command response queue in {:s} command rx", transport_type);
-                                if (throw_on_rx_error) {
-                                    throw(std::runtime_error("timeout pushing to command response queue in " + transport_type + " command rx"));
-                                }
+                            if (not match_response(recv_buffer)) {
+                                LOG_WARN("{:s} command rx discarded response to no outstanding command (type {:d} command {:d})",
+                                         transport_type, (int)recv_buffer.hdr.packet_type, (int)recv_buffer.hdr.command);
                             }
                             break;
-                        }
                         default:
                             LOG_WARN("{:s} command rx discarded incorrect packet (type {:d})", transport_type, (int)recv_buffer.hdr.packet_type);
                             break;
@@ -0,0 +1,113 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "logging.hpp"
+#include "thread_utils.hpp"
+#include "vxsdr_threads.hpp"
+#include "conversion_pool.hpp"
+
+/*! @file conversion_pool.cpp
+    @brief Constructor, destructor, and task dispatch for the @p conversion_pool class.
+*/
+
+conversion_pool::conversion_pool(const unsigned n_threads, const int64_t thread_affinity_offset) {
+    LOG_DEBUG("conversion pool constructor entered");
+    for (unsigned i = 0; i < n_threads; i++) {
+        workers.push_back(vxsdr_thread([this] { worker(); }));
+        if (thread_affinity_offset >= 0) {
+            auto desired_affinity = thread_affinity_offset + i;
+            if (set_thread_affinity(workers.back(), desired_affinity) != 0) {
+                LOG_ERROR("unable to set conversion thread affinity in conversion pool constructor");
+                throw std::runtime_error("unable to set conversion thread affinity in conversion pool constructor");
+            }
+            LOG_DEBUG("conversion thread {:d} affinity set to cpu {:d}", i, desired_affinity);
+        }
+    }
+    LOG_DEBUG("conversion pool constructor complete ({:d} threads)", n_threads);
+}
+
+conversion_pool::~conversion_pool() noexcept {
+    LOG_DEBUG("conversion pool destructor entered");
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stop_flag = true;
+    }
+    work_ready.notify_all();
+    LOG_DEBUG("joining conversion threads");
+    for (auto& w : workers) {
+        if (w.joinable()) {
+            w.join();
+        }
+    }
+    LOG_DEBUG("conversion pool destructor complete");
+}
+
+void conversion_pool::run(const size_t n_tasks, const std::function<void(size_t)>& task) {
+    if (n_tasks == 0) {
+        return;
+    }
+    // only one call at a time can use the workers; a call made while another is
+    // running (e.g. put_tx_data during get_rx_data) converts on its own thread
+    std::unique_lock<std::mutex> run_lock(run_mutex, std::try_to_lock);
+    if (workers.empty() or n_tasks == 1 or not run_lock.owns_lock()) {
+        for (size_t i = 0; i < n_tasks; i++) {
+            task(i);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        current_task    = &task;
+        current_n_tasks = n_tasks;
+        next_task       = 0;
+        generation++;
+    }
+    work_ready.notify_all();
+
+    run_tasks(task, n_tasks);
+
+    // every task has been claimed; wait for workers still running theirs, then
+    // clear the task so a worker waking late finds nothing to do
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    work_done.wait(lock, [this] { return n_active_workers == 0; });
+    current_task    = nullptr;
+    current_n_tasks = 0;
+}
+
+void conversion_pool::run_tasks(const std::function<void(size_t)>& task, const size_t n_tasks) {
+    for (size_t i = next_task.fetch_add(1); i < n_tasks; i = next_task.fetch_add(1)) {
+        task(i);
+    }
+}
+
+void conversion_pool::worker() {
+    uint64_t last_generation = 0;
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    while (true) {
+        work_ready.wait(lock, [this, last_generation] { return stop_flag or generation != last_generation; });
+        if (stop_flag) {
+            return;
+        }
+        last_generation = generation;
+        if (current_task == nullptr) {
+            continue;
+        }
+        const auto* task = current_task;
+        const size_t n_tasks = current_n_tasks;
+        n_active_workers++;
+        lock.unlock();
+
+        run_tasks(*task, n_tasks);
+
+        lock.lock();
+        if (--n_active_workers == 0) {
+            work_done.notify_all();
+        }
+    }
+}
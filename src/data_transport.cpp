@@ -4,7 +4,9 @@
 #include <bit>
 #include <cstdint>
 #include <cstring>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <stdexcept>
 #include <thread>
@@ -15,6 +17,7 @@ using namespace std::chrono_literals;
 #include <errno.h>
 
 #include "logging.hpp"
+#include "memory_utils.hpp"
 #include "vxsdr_packets.hpp"
 #include "vxsdr_queues.hpp"
 #include "vxsdr_transport.hpp"
@@ -50,6 +53,48 @@ void data_transport::log_stats() const {
     } else {
         LOG_WARN("   {:15d} send errors", send_errors);
     }
+    log_queue_statistics();
+}
+
+void data_transport::enable_queue_statistics() {
+    // residency is measured for the data queues, but not for the sample queues, which are pushed
+    // and popped by the same thread
+    tx_data_queue->enable_statistics(true);
+    for (auto& q : rx_data_queue) {
+        q->enable_statistics();
+    }
+}
+
+std::map<std::string, int64_t> data_transport::get_queue_statistics() const {
+    std::map<std::string, int64_t> stats;
+    if (tx_data_queue != nullptr and tx_data_queue->statistics() != nullptr) {
+        stats.merge(tx_data_queue->statistics()->get("tx_data_queue"));
+        // the device's own tx buffer, as last reported by acks or read by the transport
+        if (tx_buffer_size_bytes > 0) {
+            stats["device_tx_buffer:capacity"]         = tx_buffer_size_bytes;
+            stats["device_tx_buffer:used_bytes"]       = tx_buffer_used_bytes;
+            stats["device_tx_buffer:fill_percent"]     = tx_buffer_fill_percent;
+            stats["device_tx_buffer:max_fill_percent"] = tx_buffer_fill_percent_max;
+        }
+    }
+    for (unsigned i = 0; i < rx_data_queue.size(); i++) {
+        if (rx_data_queue[i]->statistics() != nullptr) {
+            stats.merge(rx_data_queue[i]->statistics()->get("rx_data_queue_" + std::to_string(i)));
+        }
+    }
+    return stats;
+}
+
+queue_memory_options data_transport::rx_data_queue_memory_options(std::map<std::string, int64_t>& config, const std::string& prefix) {
+    queue_memory_options options;
+    options.huge_pages = config[prefix + ":rx_data_queue_huge_pages"] != 0;
+    options.prefault   = config[prefix + ":rx_data_queue_prefault"] != 0;
+    options.lock       = config[prefix + ":rx_data_queue_lock"] != 0;
+    if (config[prefix + ":rx_data_queue_numa_local"] != 0 and config[prefix + ":thread_affinity_offset"] >= 0
+            and config[prefix + ":receiver_thread_affinity"] >= 0) {
+        options.numa_cpu = config[prefix + ":thread_affinity_offset"] + config[prefix + ":receiver_thread_affinity"];
+    }
+    return options;
 }
 
 bool data_transport::send_packet(packet& packet) {
@@ -67,6 +112,132 @@ bool data_transport::send_packet(packet& packet) {
     return true;
 }
 
+void data_transport::update_tx_buffer_fill(const unsigned used_bytes, const unsigned size_bytes) noexcept {
+    tx_buffer_used_bytes = used_bytes;
+    tx_buffer_size_bytes = size_bytes;
+    if (size_bytes > 0) {
+        tx_buffer_fill_percent = (unsigned)std::min(100ULL, (100ULL * used_bytes) / size_bytes);
+    } else {
+        tx_buffer_fill_percent = 0;
+    }
+    if (tx_buffer_fill_percent > tx_buffer_fill_percent_max) {
+        tx_buffer_fill_percent_max = tx_buffer_fill_percent.load();
+    }
+}
+
+void data_transport::pace_in_place_send() {
+    // the fill is read about as often as data_send() requests acks: every packet while throttling,
+    // and every in_place_check_packets otherwise
+    static constexpr uint64_t in_place_check_packets = 128;
+    if (not use_tx_throttling() or not use_tx_buffer_fill_reads()) {
+        return;
+    }
+    const uint64_t check_interval = (tx_buffer_fill_percent >= throttle_on_percent()) ? 1 : in_place_check_packets;
+    if (in_place_packets_sent == 0 or in_place_packets_sent - in_place_last_check >= check_interval) {
+        read_tx_buffer_fill();
+        in_place_last_check = in_place_packets_sent;
+    }
+    in_place_packets_sent++;
+
+    if (tx_buffer_fill_percent >= throttle_hard_percent()) {
+        // wait for the device to drain to the normal throttling level, rather than block in the upload
+        auto start_time = std::chrono::steady_clock::now();
+        while (tx_buffer_fill_percent >= throttle_on_percent() and not sender_thread_stop_flag
+                and (std::chrono::steady_clock::now() - start_time) < max_in_place_fill_wait) {
+            std::this_thread::sleep_for(std::chrono::microseconds(data_send_wait_us()));
+            if (not read_tx_buffer_fill()) {
+                break;
+            }
+        }
+    } else if (tx_buffer_fill_percent >= throttle_on_percent()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(data_throttle_wait_us()));
+    }
+}
+
+void data_transport::flush_sends() {
+    int err = 0;
+    size_t n_failed = packet_send_flush(err);
+    if (n_failed > 0) {
+        tx_state = TRANSPORT_ERROR;
+        LOG_ERROR("send error in {:s} {:s} tx ({:d} packets): {:s}", get_transport_type(), get_payload_type(), n_failed, strerror(err));
+        send_errors += n_failed;
+        if (throw_on_tx_error) {
+            throw(std::runtime_error("send error in " + get_transport_type() + " " + get_payload_type() + " tx"));
+        }
+    }
+}
+
+unsigned data_transport::probe_max_samples_per_packet() {
+    if (not use_mtu_probing()) {
+        return 0;
+    }
+    const std::string transport_type = get_transport_type();
+    const auto probe_wait            = std::chrono::microseconds(data_send_wait_us());
+    const auto initial_tx_state      = tx_state.load();
+
+    // sends a packet as large as a data packet with n_samples and the largest preamble, and waits for its
+    // ack; the acks carry no sequence number, so only one probe is outstanding at a time
+    auto probe = [&](const unsigned n_samples) {
+        constexpr unsigned largest_preamble_bytes = sizeof(packet_header) + sizeof(time_spec_t) + sizeof(stream_spec_t);
+        data_queue_element q{};
+        auto packet_size = (uint16_t)(largest_preamble_bytes + n_samples * sizeof(vxsdr::wire_sample));
+        q.hdr            = {PACKET_TYPE_TX_SIGNAL_DATA, 0, FLAGS_REQUEST_ACK, 0, 0, packet_size, 0};
+        const uint64_t acks_before = tx_acks_received;
+        if (not tx_data_queue->push(q)) {
+            return false;
+        }
+        auto start_time = std::chrono::steady_clock::now();
+        while (tx_acks_received == acks_before) {
+            if ((std::chrono::steady_clock::now() - start_time) > mtu_probe_timeout()) {
+                LOG_DEBUG("{:s} data tx mtu probe of {:d} bytes not acknowledged", transport_type, packet_size);
+                return false;
+            }
+            std::this_thread::sleep_for(probe_wait);
+        }
+        LOG_DEBUG("{:s} data tx mtu probe of {:d} bytes acknowledged", transport_type, packet_size);
+        return true;
+    };
+
+    // sizes are searched in units of the sample granularity; the largest size is tried first, since it
+    // usually works, then the standard size, then a binary search between the two
+    unsigned high = max_samples_per_packet / sample_granularity;
+    unsigned low  = std::min(high, mtu_probe_min_samples() / sample_granularity);
+    unsigned good = 0;
+    if (probe(high * sample_granularity)) {
+        good = high;
+    } else if (low < high and probe(low * sample_granularity)) {
+        good = low;
+        while (high - good > 1) {
+            unsigned mid = good + (high - good) / 2;
+            if (probe(mid * sample_granularity)) {
+                good = mid;
+            } else {
+                high = mid;
+            }
+        }
+    }
+    // oversize probes may have failed to send, which is expected here; the state is restored under
+    // send_mutex once every probe has been sent, so no send is in progress to change it afterwards
+    const auto drain_start = std::chrono::steady_clock::now();
+    while (true) {
+        std::unique_lock<std::mutex> lock(send_mutex);
+        if (tx_data_queue->read_available() == 0 or (std::chrono::steady_clock::now() - drain_start) > mtu_probe_timeout()) {
+            tx_state = initial_tx_state;
+            break;
+        }
+        lock.unlock();
+        std::this_thread::sleep_for(probe_wait);
+    }
+
+    if (good == 0) {
+        LOG_WARN("no {:s} data tx mtu probes were acknowledged; keeping max_samples_per_packet of {:d}", transport_type,
+                 max_samples_per_packet);
+        return max_samples_per_packet;
+    }
+    LOG_INFO("{:s} data tx mtu probing found max_samples_per_packet of {:d}", transport_type, good * sample_granularity);
+    return good * sample_granularity;
+}
+
 void data_transport::data_send() {
     LOG_DEBUG("{:s} data tx started", get_transport_type());
     const std::string transport_type = get_transport_type();
@@ -95,6 +266,10 @@ void data_transport::data_send() {
     const unsigned throttle_off_pct  = throttle_off_percent();
     const auto data_send_wait        = std::chrono::microseconds(data_send_wait_us());
     const auto data_throttle_wait    = std::chrono::microseconds(data_throttle_wait_us());
+    const bool read_fill             = use_tx_buffer_fill_reads();
+    // producers may also send, with send_packet_in_place(), and the mtu probe checks the tx state
+    // between sends, so sends are made holding send_mutex; it is uncontended otherwise
+    auto lock_sends = [&]() { return std::unique_lock<std::mutex>(send_mutex); };
 
     if (tx_data_queue == nullptr) {
         tx_state = TRANSPORT_SHUTDOWN;
@@ -161,23 +336,40 @@ void data_transport::data_send() {
         } else {
             throttling_state = NO_THROTTLING;
         }
-        if (use_throttling and throttling_state == HARD_THROTTLING) {
+        if (use_throttling and throttling_state == HARD_THROTTLING and read_fill) {
+            // when hard throttling with the buffer use read directly, just wait and read it again
+            read_tx_buffer_fill();
+            last_check = data_packets_processed;
+            std::this_thread::sleep_for(data_send_wait);
+        } else if (use_throttling and throttling_state == HARD_THROTTLING) {
             // when hard throttling, send one empty data packet and request ack to update buffer use
+            auto send_lock     = lock_sends();
             data_buffer[0].hdr = {PACKET_TYPE_TX_SIGNAL_DATA, 0, FLAGS_REQUEST_ACK, 0, 0, sizeof(header_only_packet), 0};
             send_packet(data_buffer[0]);
+            flush_sends();
+            send_lock.unlock();
             last_check = data_packets_processed;
             std::this_thread::sleep_for(data_send_wait);
         } else {
             // when not hard throttling, send at most max_packets_to_send packets and update buffer fills
             // by requesting an ack every buffer_check_interval packets
+            // the lock is taken before the pop, so a packet is never out of the queue but not yet sent
+            // while another thread holds send_mutex
+            auto send_lock    = lock_sends();
             unsigned n_popped = tx_data_queue->pop(data_buffer.data(), max_packets_to_send);
             if (n_popped == 0) {
+                send_lock.unlock();
                 std::this_thread::sleep_for(data_send_wait);
+                continue;
             }
             for (unsigned i = 0; i < n_popped; i++) {
                 if (use_throttling and (data_packets_processed == 0 or data_packets_processed - last_check >= buffer_check_interval)) {
-                    // request ack to update buffer use
-                    data_buffer[i].hdr.flags |= FLAGS_REQUEST_ACK;
+                    // read buffer use, or request ack to update it
+                    if (read_fill) {
+                        read_tx_buffer_fill();
+                    } else {
+                        data_buffer[i].hdr.flags |= FLAGS_REQUEST_ACK;
+                    }
                     last_check = data_packets_processed;
                 }
                 if (data_buffer[i].hdr.packet_size > 0) {
@@ -189,16 +381,22 @@ void data_transport::data_send() {
                 }
                 if (use_throttling and throttling_state != NO_THROTTLING) {
                     // if we are throttling, pause between each packet
+                    flush_sends();
                     std::this_thread::sleep_for(data_throttle_wait);
                 }
             }
+            // the next pop reuses data_buffer, so batched sends must complete first
+            flush_sends();
         }
     }
 
     if (rx_state == TRANSPORT_READY or rx_state == TRANSPORT_ERROR) {
         // send a last empty packet with an ack request so that the stats are updated
+        auto send_lock     = lock_sends();
         data_buffer[0].hdr = {PACKET_TYPE_TX_SIGNAL_DATA, 0, FLAGS_REQUEST_ACK, 0, 0, sizeof(header_only_packet), 0};
         send_packet(data_buffer[0]);
+        flush_sends();
+        send_lock.unlock();
         // wait for the response to be received by the data rx
         std::this_thread::sleep_for(final_stats_wait);
     } else {
@@ -234,8 +432,15 @@ void data_transport::data_receive() {
         int err = 0;
         size_t bytes_in_packet = 0;
 
-        // sync receive
-        bytes_in_packet = packet_receive(recv_buffer, err);
+        // sync receive, in place if the transport lends its buffers
+        const bool borrowed = use_borrowed_receive();
+        const packet* rx_ptr = &recv_buffer;
+        if (borrowed) {
+            rx_ptr = packet_receive_borrow(bytes_in_packet, err);
+        } else {
+            bytes_in_packet = packet_receive(recv_buffer, err);
+        }
+        const packet& rx_packet = (rx_ptr != nullptr) ? *rx_ptr : recv_buffer;
 
         if (not receiver_thread_stop_flag) {
             if (err != 0 and err != ETIMEDOUT) {
@@ -246,23 +451,23 @@ void data_transport::data_receive() {
                 }
             } else if (bytes_in_packet > 0) {
                 // check size and discard unless packet size agrees with header
-                if (recv_buffer.hdr.packet_size != bytes_in_packet) {
+                if (rx_packet.hdr.packet_size != bytes_in_packet) {
                     rx_state = TRANSPORT_ERROR;
                     LOG_ERROR("packet size error in {:s} data rx (header {:d}, packet {:d})",
-                            transport_type, (uint16_t)recv_buffer.hdr.packet_size, bytes_in_packet);
+                            transport_type, (uint16_t)rx_packet.hdr.packet_size, bytes_in_packet);
                     if (throw_on_rx_error) {
                         throw(std::runtime_error("packet size error in " + transport_type + " data rx"));
                     }
                 } else {
                     // update stats
                     packets_received++;
-                    packet_types_received.at(recv_buffer.hdr.packet_type)++;
+                    packet_types_received.at(rx_packet.hdr.packet_type)++;
                     bytes_received += bytes_in_packet;
 
                     // check sequence and update sequence counter
-                    if (packets_received > 1 and recv_buffer.hdr.sequence_counter != (uint16_t)(last_seq + 1)) {
+                    if (packets_received > 1 and rx_packet.hdr.sequence_counter != (uint16_t)(last_seq + 1)) {
                         rx_state = TRANSPORT_ERROR;
-                        uint16_t received = recv_buffer.hdr.sequence_counter;
+                        uint16_t received = rx_packet.hdr.sequence_counter;
                         LOG_ERROR("sequence error in {:s} data rx (expected {:d}, received {:d})",
                                 transport_type, (uint16_t)(last_seq + 1), received);
                         sequence_errors++;
@@ -271,44 +476,48 @@ void data_transport::data_receive() {
                             throw(std::runtime_error("sequence error in " + transport_type + " data rx"));
                         }
                     }
-                    last_seq = recv_buffer.hdr.sequence_counter;
+                    last_seq = rx_packet.hdr.sequence_counter;
 
-                    if (recv_buffer.hdr.packet_type == PACKET_TYPE_RX_SIGNAL_DATA) {
+                    if (rx_packet.hdr.packet_type == PACKET_TYPE_RX_SIGNAL_DATA) {
                         // check subdevice
-                        if (recv_buffer.hdr.subdevice < num_rx_subdevs) {
-                            uint16_t preamble_size = get_packet_preamble_size(recv_buffer.hdr);
+                        if (rx_packet.hdr.subdevice < num_rx_subdevs) {
+                            uint16_t preamble_size = get_packet_preamble_size(rx_packet.hdr);
                             // update sample stats
-                            size_t n_samps = (recv_buffer.hdr.packet_size - preamble_size) / sizeof(vxsdr::wire_sample);
+                            size_t n_samps = (rx_packet.hdr.packet_size - preamble_size) / sizeof(vxsdr::wire_sample);
                             samples_received += n_samps;
                             samples_received_current_stream += n_samps;
-                            if (not rx_data_queue[recv_buffer.hdr.subdevice]->push(recv_buffer)) {
+                            if (not rx_data_queue[rx_packet.hdr.subdevice]->push(rx_packet, rx_arrival_time)) {
                                 rx_state = TRANSPORT_ERROR;
                                 LOG_ERROR("error pushing to data queue in {:s} data rx (subdevice {:d} sample {:d})",
-                                        transport_type, recv_buffer.hdr.subdevice, samples_received);
+                                        transport_type, rx_packet.hdr.subdevice, samples_received);
                                 if (throw_on_rx_error) {
                                     throw(std::runtime_error("error pushing to data queue in " + transport_type + " data rx"));
                                 }
                             }
                         } else {
                             LOG_WARN("{:s} data rx discarded rx data packet from unknown subdevice {:d}",
-                                    transport_type, recv_buffer.hdr.subdevice);
+                                    transport_type, rx_packet.hdr.subdevice);
                         }
-                    } else if (recv_buffer.hdr.packet_type == PACKET_TYPE_TX_SIGNAL_DATA_ACK) {
-                        auto* r = std::bit_cast<six_uint32_packet*>(&recv_buffer);
-                        tx_buffer_used_bytes = r->value3;
-                        tx_buffer_size_bytes = r->value4;
-                        tx_packet_oos_count  = r->value5;
-                        if (tx_buffer_size_bytes > 0) {
-                            tx_buffer_fill_percent = (unsigned)std::min(100ULL, (100ULL * tx_buffer_used_bytes) / tx_buffer_size_bytes);
-                        } else {
-                            tx_buffer_fill_percent = 0;
+                    } else if (rx_packet.hdr.packet_type == PACKET_TYPE_TX_SIGNAL_DATA_ACK) {
+                        auto* r = std::bit_cast<const six_uint32_packet*>(&rx_packet);
+                        tx_packet_oos_count = r->value5;
+                        tx_acks_received++;
+                        if (not use_tx_buffer_fill_reads()) {
+                            update_tx_buffer_fill(r->value3, r->value4);
                         }
                     } else {
-                        LOG_WARN("{:s} data rx discarded incorrect packet (type {:d})", transport_type, (int)recv_buffer.hdr.packet_type);
+                        LOG_WARN("{:s} data rx discarded incorrect packet (type {:d})", transport_type, (int)rx_packet.hdr.packet_type);
                     }
                 }
             }
         }
+        if (borrowed and rx_ptr != nullptr and not packet_receive_release(err)) {
+            rx_state = TRANSPORT_ERROR;
+            LOG_ERROR("{:s} data receive buffer release error: {:s}", transport_type, std::strerror(err));
+            if (throw_on_rx_error) {
+                throw(std::runtime_error(transport_type + " data receive buffer release error"));
+            }
+        }
     }
 
     rx_state = TRANSPORT_SHUTDOWN;
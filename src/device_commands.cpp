@@ -36,9 +36,17 @@ std::optional<std::array<uint32_t, 8>> vxsdr::imp::hello() {
 }
 
 bool vxsdr::imp::reset() {
+    if (vxsdr::imp::in_transaction()) {
+        LOG_ERROR("reset() cannot be used in a transaction");
+        return false;
+    }
     header_only_packet p;
     p.hdr = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_RESET, 0, 0, 0, sizeof(p), 0};
-    return vxsdr::imp::send_command_and_check_response(p, "reset()");
+    // properties are read from the device again after a reset
+    return vxsdr::imp::send_command_and_check_response(p, "reset()", [this] {
+        vxsdr::imp::clear_property_cache();
+        return true;
+    });
 }
 
 bool vxsdr::imp::clear_status(const uint8_t subdev) {
@@ -47,6 +55,12 @@ bool vxsdr::imp::clear_status(const uint8_t subdev) {
     return vxsdr::imp::send_command_and_check_response(p, "clear_status()");
 }
 
+bool vxsdr::imp::clear_data_buffer(const uint8_t subdev) {
+    header_only_packet p;
+    p.hdr = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_CLEAR_DATA_BUFFER, 0, subdev, 0, sizeof(p), 0};
+    return vxsdr::imp::send_command_and_check_response(p, "clear_data_buffer()");
+}
+
 std::optional<std::array<uint32_t, 8>> vxsdr::imp::get_status(const uint8_t subdev) {
     header_only_packet p;
     p.hdr    = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_STATUS, 0, subdev, 0, sizeof(p), 0};
@@ -94,7 +108,7 @@ std::optional<vxsdr::time_point> vxsdr::imp::get_time_now() {
 std::optional<std::array<uint32_t, 2>> vxsdr::imp::get_buffer_info(const uint8_t subdev) {
     header_only_packet p;
     p.hdr    = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_BUFFER_INFO, 0, subdev, 0, sizeof(p), 0};
-    auto res = vxsdr::imp::send_command_and_return_response(p, "get_buffer_info()");
+    auto res = vxsdr::imp::send_query_and_return_cached_response(p, "get_buffer_info()");
     if (res) {
         auto q                      = res.value();
         auto* r                     = std::bit_cast<two_uint32_packet*>(&q);
@@ -124,22 +138,7 @@ std::optional<vxsdr::stream_state> vxsdr::imp::get_tx_stream_state(const uint8_t
     p.hdr    = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_STREAM_STATE, 0, subdev, 0, sizeof(p), 0};
     auto res = vxsdr::imp::send_command_and_return_response(p, "get_tx_stream_state()");
     if (res) {
-        auto q                      = res.value();
-        auto* r                     = std::bit_cast<one_uint64_packet*>(&q);
-        bool running_flag = (r->value1 & STREAM_STATE_TX_RUNNING_FLAG) != 0;
-        bool waiting_flag = (r->value1 & STREAM_STATE_TX_WAITING_FLAG) != 0;
-        vxsdr::stream_state tx_stream_state;
-        if (not running_flag and not waiting_flag) {
-            tx_stream_state = STREAM_STOPPED;
-        } else if (not running_flag and waiting_flag) {
-            tx_stream_state = STREAM_WAITING_FOR_START;
-        }
-        else if (running_flag and not waiting_flag) {
-            tx_stream_state = STREAM_RUNNING;
-        } else {
-            tx_stream_state = STREAM_ERROR;
-        }
-        return tx_stream_state;
+        return vxsdr::imp::stream_state_from_response(res.value(), true);
     }
     return std::nullopt;
 }
@@ -149,26 +148,27 @@ std::optional<vxsdr::stream_state> vxsdr::imp::get_rx_stream_state(const uint8_t
     p.hdr    = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_STREAM_STATE, 0, subdev, 0, sizeof(p), 0};
     auto res = vxsdr::imp::send_command_and_return_response(p, "get_rx_stream_state()");
     if (res) {
-        auto q                      = res.value();
-        auto* r                     = std::bit_cast<one_uint64_packet*>(&q);
-        bool running_flag = (r->value1 & STREAM_STATE_RX_RUNNING_FLAG) != 0;
-        bool waiting_flag = (r->value1 & STREAM_STATE_RX_WAITING_FLAG) != 0;
-        vxsdr::stream_state rx_stream_state;
-        if (not running_flag and not waiting_flag) {
-            rx_stream_state = STREAM_STOPPED;
-        } else if (not running_flag and waiting_flag) {
-            rx_stream_state = STREAM_WAITING_FOR_START;
-        }
-        else if (running_flag and not waiting_flag) {
-            rx_stream_state = STREAM_RUNNING;
-        } else {
-            rx_stream_state = STREAM_ERROR;
-        }
-        return rx_stream_state;
+        return vxsdr::imp::stream_state_from_response(res.value(), false);
     }
     return std::nullopt;
 }
 
+vxsdr::stream_state vxsdr::imp::stream_state_from_response(const command_queue_element& q, const bool tx) const {
+    const auto* r     = std::bit_cast<const one_uint64_packet*>(&q);
+    bool running_flag = (r->value1 & (tx ? STREAM_STATE_TX_RUNNING_FLAG : STREAM_STATE_RX_RUNNING_FLAG)) != 0;
+    bool waiting_flag = (r->value1 & (tx ? STREAM_STATE_TX_WAITING_FLAG : STREAM_STATE_RX_WAITING_FLAG)) != 0;
+    if (not running_flag and not waiting_flag) {
+        return STREAM_STOPPED;
+    }
+    if (not running_flag and waiting_flag) {
+        return STREAM_WAITING_FOR_START;
+    }
+    if (running_flag and not waiting_flag) {
+        return STREAM_RUNNING;
+    }
+    return STREAM_ERROR;
+}
+
 std::optional<std::array<bool, 3>> vxsdr::imp::get_timing_status() {
     header_only_packet p                            = {};
     p.hdr    = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_TIMING_STATUS, 0, 0, 0, sizeof(p), 0};
@@ -187,7 +187,7 @@ std::optional<std::array<bool, 3>> vxsdr::imp::get_timing_status() {
 std::optional<double> vxsdr::imp::get_timing_resolution() {
     header_only_packet p = {};
     p.hdr    = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_TIMING_RESOLUTION, 0, 0, 0, sizeof(p), 0};
-    auto res = vxsdr::imp::send_command_and_return_response(p, "get_timing_resolution()");
+    auto res = vxsdr::imp::send_query_and_return_cached_response(p, "get_timing_resolution()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_double_packet*>(&q);
@@ -291,6 +291,10 @@ std::vector<std::string> vxsdr::imp::discover_ipv4_addresses(const std::string&
 }
 
 bool vxsdr::imp::set_ipv4_address(const std::string& device_address_str) {
+    if (vxsdr::imp::in_transaction()) {
+        LOG_ERROR("set_ipv4_address() cannot be used in a transaction");
+        return false;
+    }
     net::ip::address_v4 device_address = net::ip::address_v4::from_string(device_address_str);
     one_uint32_packet p = {};
     p.hdr               = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_SET_TRANSPORT_ADDR, 0, 0, 0, sizeof(p), 0};
@@ -299,6 +303,10 @@ bool vxsdr::imp::set_ipv4_address(const std::string& device_address_str) {
 }
 
 bool vxsdr::imp::save_ipv4_address(const std::string& device_address_str) {
+    if (vxsdr::imp::in_transaction()) {
+        LOG_ERROR("save_ipv4_address() cannot be used in a transaction");
+        return false;
+    }
     net::ip::address_v4 device_address = net::ip::address_v4::from_string(device_address_str);
     one_uint32_packet p = {};
     p.hdr               = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_SAVE_TRANSPORT_ADDR, 0, 0, 0, sizeof(p), 0};
@@ -322,17 +330,16 @@ bool vxsdr::imp::set_max_payload_bytes(const unsigned max_payload_bytes) {
     one_uint32_packet p = {};
     p.hdr               = {PACKET_TYPE_DEVICE_CMD,  DEVICE_CMD_SET_MAX_PAYLOAD, 0, 0, 0, sizeof(p), 0};
     p.value1            = max_payload_bytes;
-    if (vxsdr::imp::send_command_and_check_response(p, "set_max_payload_bytes()")) {
-        // update the value in the data transport
+    // update the value in the data transport once the device has accepted it
+    return vxsdr::imp::send_command_and_check_response(p, "set_max_payload_bytes()", [this, max_payload_bytes] {
         return data_tport->set_max_samples_per_packet(max_samples_per_packet<wire_sample>(max_payload_bytes));
-    }
-    return false;
+    });
 }
 
 std::optional<unsigned> vxsdr::imp::get_num_subdevices() {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_NUM_SUBDEVS, 0, 0, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_num_subdevices()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_num_subdevices()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -344,7 +351,7 @@ std::optional<unsigned> vxsdr::imp::get_num_subdevices() {
 std::optional<unsigned> vxsdr::imp::get_num_sensors(const uint8_t subdev) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_NUM_SENSORS, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_num_sensors()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_num_sensors()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -357,7 +364,7 @@ std::optional<std::string> vxsdr::imp::get_sensor_name(const unsigned sensor_num
     one_uint32_packet p = {};
     p.hdr         = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_SENSOR_NAME, 0, subdev, 0, sizeof(p), 0};
     p.value1      = sensor_number;
-    auto res      = vxsdr::imp::send_command_and_return_response(p, "get_sensor_names()");
+    auto res      = vxsdr::imp::send_query_and_return_cached_response(p, "get_sensor_names()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<name_packet*>(&q);
@@ -0,0 +1,150 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "logging.hpp"
+#include "memory_utils.hpp"
+
+/*! @file memory_utils.cpp
+    @brief Constructor and destructor for the @p queue_memory class.
+*/
+
+#ifdef VXSDR_TARGET_LINUX
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT (26)
+#endif
+
+namespace {
+
+void* map_anonymous(const size_t n_bytes, const int extra_flags) {
+    void* p = mmap(nullptr, n_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+    return (p == MAP_FAILED) ? nullptr : p;
+}
+
+// returns the NUMA node of a cpu, or -1 if it cannot be determined
+int numa_node_of_cpu(const int64_t cpu) {
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/cpu/cpu" + std::to_string(cpu), ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.starts_with("node") and name.size() > 4) {
+            return std::stoi(name.substr(4));
+        }
+    }
+    return -1;
+}
+
+// mbind is called directly so libnuma is not needed; MPOL_PREFERRED lets the kernel use
+// another node if the preferred one runs out of memory
+int prefer_numa_node(void* p, const size_t n_bytes, const int node) {
+    constexpr int mpol_preferred = 1;
+    constexpr size_t bits_per_word = 8 * sizeof(unsigned long);
+    unsigned long node_mask[16] = {};
+    if (node < 0 or (size_t)node >= bits_per_word * std::size(node_mask)) {
+        return -1;
+    }
+    node_mask[node / bits_per_word] = 1UL << (node % bits_per_word);
+    return (int)syscall(SYS_mbind, p, n_bytes, mpol_preferred, node_mask, bits_per_word * std::size(node_mask), 0);
+}
+
+}  // namespace
+
+queue_memory::queue_memory(const size_t n_bytes, const queue_memory_options& options) : requested_bytes(n_bytes) {
+    const size_t page_bytes = sysconf(_SC_PAGESIZE);
+
+    if (options.huge_pages) {
+        // 1 GB pages are only worthwhile for buffers of at least 1 GB
+        constexpr unsigned log2_huge_page_sizes[] = {30, 21};
+        for (auto log2_size : log2_huge_page_sizes) {
+            const size_t huge_page_bytes = 1UL << log2_size;
+            if (huge_page_bytes > 2 * 1024 * 1024 and n_bytes < huge_page_bytes) {
+                continue;
+            }
+            const size_t n_map = (n_bytes + huge_page_bytes - 1) & ~(huge_page_bytes - 1);
+            buffer = static_cast<uint8_t*>(map_anonymous(n_map, MAP_HUGETLB | (int)(log2_size << MAP_HUGE_SHIFT)));
+            if (buffer != nullptr) {
+                mapped_bytes = n_map;
+                LOG_DEBUG("queue memory of {:d} bytes using {:d} byte huge pages", n_map, huge_page_bytes);
+                break;
+            }
+        }
+    }
+    if (buffer == nullptr) {
+        mapped_bytes = (n_bytes + page_bytes - 1) & ~(page_bytes - 1);
+        // pages are only committed when touched, so a large reservation costs nothing until used
+        buffer = static_cast<uint8_t*>(map_anonymous(mapped_bytes, MAP_NORESERVE));
+        if (buffer == nullptr) {
+            throw std::bad_alloc();
+        }
+        if (options.huge_pages) {
+            LOG_WARN("huge pages unavailable for queue memory; requesting transparent huge pages");
+            if (madvise(buffer, mapped_bytes, MADV_HUGEPAGE) != 0) {
+                LOG_WARN("transparent huge pages unavailable for queue memory ({:s})", std::strerror(errno));
+            }
+        }
+    }
+
+    // the memory policy must be set before any page is touched
+    if (options.numa_cpu >= 0) {
+        int node = numa_node_of_cpu(options.numa_cpu);
+        if (node < 0) {
+            LOG_WARN("cannot find numa node of cpu {:d} for queue memory", options.numa_cpu);
+        } else if (prefer_numa_node(buffer, mapped_bytes, node) != 0) {
+            LOG_WARN("cannot bind queue memory to numa node {:d} ({:s})", node, std::strerror(errno));
+        } else {
+            LOG_DEBUG("queue memory bound to numa node {:d}", node);
+        }
+    }
+
+    // pages are faulted in and locked here, before any thread uses the buffer, so a ring which
+    // grows into its reservation never takes page faults or mlock calls on the receiver thread
+    bool faulted = false;
+    if (options.lock) {
+        // locking also faults in every page
+        if (mlock(buffer, mapped_bytes) == 0) {
+            faulted = true;
+        } else {
+            LOG_WARN("cannot lock {:d} bytes of queue memory ({:s}); check RLIMIT_MEMLOCK", mapped_bytes, std::strerror(errno));
+        }
+    }
+    if ((options.prefault or options.lock) and not faulted) {
+        if (madvise(buffer, mapped_bytes, MADV_POPULATE_WRITE) != 0) {
+            // kernels before 5.14 do not support MADV_POPULATE_WRITE, so touch each page instead
+            for (size_t i = 0; i < mapped_bytes; i += page_bytes) {
+                static_cast<volatile uint8_t*>(buffer)[i] = 0;
+            }
+        }
+    }
+}
+
+queue_memory::~queue_memory() noexcept {
+    if (buffer != nullptr) {
+        munmap(buffer, mapped_bytes);
+    }
+}
+
+#else  // VXSDR_TARGET_LINUX
+
+queue_memory::queue_memory(const size_t n_bytes, const queue_memory_options& options) : requested_bytes(n_bytes) {
+    if (options.huge_pages or options.numa_cpu >= 0 or options.prefault or options.lock) {
+        LOG_WARN("queue memory options are only supported on Linux");
+    }
+    buffer = static_cast<uint8_t*>(::operator new(n_bytes, std::align_val_t{minimum_alignment}));
+}
+
+queue_memory::~queue_memory() noexcept {
+    ::operator delete(buffer, std::align_val_t{minimum_alignment});
+}
+
+#endif  // VXSDR_TARGET_LINUX
@@ -3,6 +3,7 @@
 
 #ifdef VXSDR_ENABLE_PCIE
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cstddef>
@@ -29,6 +30,14 @@ pcie_command_transport::pcie_command_transport(const std::map<std::string, int64
 
     pcie_if = std::move(pcie_iface);
 
+    max_commands_in_flight = (unsigned)std::clamp<int64_t>(config["pcie_command_transport:commands_in_flight"], 1, max_commands_in_flight_limit);
+    LOG_DEBUG("allowing {:d} commands in flight", max_commands_in_flight);
+
+    if (config["queue_statistics"] != 0) {
+        LOG_DEBUG("enabling queue statistics");
+        enable_queue_statistics();
+    }
+
     rx_state        = TRANSPORT_STARTING;
     receiver_thread = vxsdr_thread([this] { command_receive(); });
 
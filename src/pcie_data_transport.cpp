@@ -4,9 +4,12 @@
 #ifdef VXSDR_ENABLE_PCIE
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <string>
@@ -37,19 +40,52 @@ pcie_data_transport::pcie_data_transport(const std::map<std::string, int64_t>& s
 
     pcie_if = std::move(pcie_iface);
 
+    in_place_tx = config["pcie_data_transport:in_place_tx"] != 0;
+    LOG_DEBUG("in-place transmit {:s}", in_place_tx ? "enabled" : "disabled");
+
+    tx_batch_packets = (unsigned)std::clamp<int64_t>(config["pcie_data_transport:tx_batch_packets"], 1, VXSDR_DMA_BATCH_MAX);
+    rx_batch_packets = (unsigned)std::clamp<int64_t>(config["pcie_data_transport:rx_batch_packets"], 1, VXSDR_DMA_BATCH_MAX);
+
+    if (config["pcie_data_transport:busy_poll"] != 0) {
+        poll_options.spin_time    = std::chrono::microseconds(config["pcie_data_transport:busy_poll_spin_us"]);
+        poll_options.idle_backoff = std::chrono::microseconds(config["pcie_data_transport:busy_poll_backoff_us"]);
+        busy_poll        = true;
+        rx_batch_packets = VXSDR_DMA_BATCH_MAX;
+        LOG_INFO("pcie data receiver polling the rx ring (spin {:d} us)", config["pcie_data_transport:busy_poll_spin_us"]);
+    }
+    LOG_DEBUG("using DMA batches of {:d} tx and {:d} rx packets", tx_batch_packets, rx_batch_packets);
+
+    if (config["pcie_data_transport:tx_throttling"] != 0) {
+        if (pcie_if->pcie_dma_tx_ddr_size() > 0) {
+            tx_throttling = true;
+            LOG_DEBUG("pcie data tx throttling on device buffer of {:d} bytes", pcie_if->pcie_dma_tx_ddr_size());
+        } else {
+            LOG_WARN("pcie device tx buffer size unknown; tx throttling disabled");
+        }
+    }
+
     LOG_DEBUG("using transmit data buffer of {:d} packets", config["pcie_data_transport:tx_data_queue_packets"]);
     tx_data_queue = std::make_unique<vxsdr_queue<data_queue_element>>(config["pcie_data_transport:tx_data_queue_packets"]);
 
+    const size_t rx_queue_bytes         = rx_data_queue_bytes(config["pcie_data_transport:rx_data_queue_packets"]);
+    // a nonzero initial size makes the queues start small and grow as needed
+    const size_t rx_queue_initial_bytes = rx_data_queue_bytes(config["pcie_data_transport:rx_data_queue_initial_packets"]);
+    const auto rx_queue_memory          = rx_data_queue_memory_options(config, "pcie_data_transport");
     for (unsigned i = 0; i < num_rx_subdevs; i++) {
-        rx_data_queue.push_back(
-            std::make_unique<vxsdr_queue<data_queue_element>>(config["pcie_data_transport:rx_data_queue_packets"]));
+        rx_data_queue.push_back(std::make_unique<packet_ring>(rx_queue_bytes, rx_queue_memory, rx_queue_initial_bytes));
         rx_sample_queue.push_back(
             std::make_unique<vxsdr_queue<vxsdr::wire_sample>>(MAX_DATA_LENGTH_SAMPLES));
     }
 
-    LOG_DEBUG("using {:d} receive data buffers of {:d} packets", num_rx_subdevs, config["pcie_data_transport:rx_data_queue_packets"]);
+    LOG_DEBUG("using {:d} receive data buffers of {:d} packets ({:d} bytes)", num_rx_subdevs,
+              config["pcie_data_transport:rx_data_queue_packets"], rx_queue_bytes);
     LOG_DEBUG("using {:d} receive sample buffers of {:d} samples", num_rx_subdevs, MAX_DATA_LENGTH_SAMPLES);
 
+    if (config["queue_statistics"] != 0) {
+        LOG_DEBUG("enabling queue statistics");
+        enable_queue_statistics();
+    }
+
     rx_state        = TRANSPORT_STARTING;
     receiver_thread = vxsdr_thread([this] { data_receive(); });
 
@@ -122,6 +158,11 @@ pcie_data_transport::~pcie_data_transport() noexcept {
         receiver_thread.join();
     }
 
+    if (rx_batch_checked_out > 0) {
+        int err = 0;
+        pcie_if->pcie_dma_data_receive_release_batch(rx_batch_checked_out, err);
+    }
+
     if (log_stats_on_exit) {
         log_stats();
     }
@@ -129,7 +170,74 @@ pcie_data_transport::~pcie_data_transport() noexcept {
 }
 
 size_t pcie_data_transport::packet_send(const packet& packet, int& error_code) {
-    return pcie_if->pcie_dma_data_send(&packet, packet.hdr.packet_size, error_code);
+    if (&packet == in_place_packet) {
+        // already built in the checked-out DMA buffer
+        return pcie_if->pcie_dma_data_send_submit(packet.hdr.packet_size, error_code);
+    }
+    if (tx_batch_packets <= 1) {
+        return pcie_if->pcie_dma_data_send(&packet, packet.hdr.packet_size, error_code);
+    }
+    if (tx_batch_filled == tx_batch_checked_out) {
+        // a full batch is submitted here; its failures are reported by the next packet_send_flush()
+        submit_tx_batch();
+        tx_batch_checked_out = pcie_if->pcie_dma_data_send_checkout_batch(tx_batch_ptrs.data(), tx_batch_packets, tx_batch_max_bytes, error_code);
+        if (tx_batch_checked_out == 0) {
+            return 0;
+        }
+    }
+    std::memcpy(tx_batch_ptrs[tx_batch_filled], &packet, std::min((size_t)packet.hdr.packet_size, tx_batch_max_bytes));
+    tx_batch_bytes[tx_batch_filled++] = packet.hdr.packet_size;
+    error_code = 0;
+    return packet.hdr.packet_size;
+}
+
+bool pcie_data_transport::read_tx_buffer_fill() {
+    int err = 0;
+    int used_bytes = pcie_if->pcie_dma_tx_ddr_fill(err);
+    if (used_bytes < 0) {
+        // the fill is unknown, so the blocking uploads are left to limit the rate
+        if (not fill_read_error_logged) {
+            LOG_WARN("unable to read pcie device tx buffer fill: {:s}", std::strerror(err));
+            fill_read_error_logged = true;
+        }
+        update_tx_buffer_fill(0, (unsigned)pcie_if->pcie_dma_tx_ddr_size());
+        return false;
+    }
+    update_tx_buffer_fill((unsigned)used_bytes, (unsigned)pcie_if->pcie_dma_tx_ddr_size());
+    return true;
+}
+
+size_t pcie_data_transport::packet_send_flush(int& error_code) {
+    submit_tx_batch();
+    error_code      = earlier_send_error;
+    size_t n_failed = earlier_send_failures;
+    earlier_send_failures = 0;
+    earlier_send_error    = 0;
+    return n_failed;
+}
+
+void pcie_data_transport::submit_tx_batch() {
+    if (tx_batch_checked_out == 0) {
+        return;
+    }
+    int err = 0;
+    unsigned n_sent = pcie_if->pcie_dma_data_send_submit_batch(tx_batch_bytes.data(), tx_batch_filled, err);
+    if (n_sent < tx_batch_filled) {
+        if (earlier_send_failures == 0) {
+            earlier_send_error = err;
+        }
+        earlier_send_failures += tx_batch_filled - n_sent;
+    }
+    tx_batch_checked_out = 0;
+    tx_batch_filled      = 0;
+}
+
+packet* pcie_data_transport::packet_send_checkout(size_t& max_bytes, int& error_code) {
+    return static_cast<packet*>(pcie_if->pcie_dma_data_send_checkout(max_bytes, error_code));
+}
+
+bool pcie_data_transport::packet_send_cancel(int& error_code) {
+    return pcie_if->pcie_dma_data_send_cancel(error_code);
 }
 
 size_t pcie_data_transport::packet_receive(data_queue_element& packet, int& error_code) {
@@ -137,4 +245,65 @@ size_t pcie_data_transport::packet_receive(data_queue_element& packet, int& erro
     return pcie_if->pcie_dma_data_receive(&packet, sizeof(packet), error_code);
 }
 
+const packet* pcie_data_transport::packet_receive_borrow(size_t& bytes, int& error_code) {
+    if (rx_batch_packets <= 1) {
+        return static_cast<const packet*>(pcie_if->pcie_dma_data_receive_borrow(bytes, error_code));
+    }
+    if (rx_batch_next == rx_batch_checked_out) {
+        // every packet in the batch has been read, so it is released before waiting for the next
+        if (rx_batch_checked_out > 0) {
+            const unsigned n_release = rx_batch_checked_out;
+            rx_batch_checked_out     = 0;
+            rx_batch_next            = 0;
+            if (not pcie_if->pcie_dma_data_receive_release_batch(n_release, error_code)) {
+                return nullptr;
+            }
+        }
+        unsigned n_checkout = rx_batch_packets;
+        if (busy_poll) {
+            n_checkout = std::min(poll_rx_buffers(error_code), rx_batch_packets);
+            if (n_checkout == 0) {
+                return nullptr;
+            }
+        }
+        rx_batch_checked_out = pcie_if->pcie_dma_data_receive_borrow_batch(rx_batch_ptrs.data(), rx_batch_bytes.data(), n_checkout, error_code);
+        if (rx_batch_checked_out == 0) {
+            return nullptr;
+        }
+    }
+    bytes = rx_batch_bytes[rx_batch_next];
+    return static_cast<const packet*>(rx_batch_ptrs[rx_batch_next++]);
+}
+
+// waits for filled rx buffers by reading the ring indices, spinning and then backing off as set by poll_options;
+// returns the number ready, or 0 if the receiver is stopping or on an error (which sets error_code)
+unsigned pcie_data_transport::poll_rx_buffers(int& error_code) {
+    // the clock is only read every few tries, since a try without a packet is only two ioctls
+    static constexpr unsigned tries_per_clock_check = 16;
+    auto idle_start  = std::chrono::steady_clock::now();
+    bool backing_off = false;
+    for (unsigned n_tries = 1; not receiver_thread_stop_flag; n_tries++) {
+        int n_ready = pcie_if->pcie_dma_rx_buffers_ready(error_code);
+        if (n_ready != 0) {
+            return (n_ready > 0) ? (unsigned)n_ready : 0;
+        }
+        if (backing_off) {
+            std::this_thread::sleep_for(poll_options.idle_backoff);
+        } else if (n_tries % tries_per_clock_check == 0) {
+            backing_off = (std::chrono::steady_clock::now() - idle_start) > poll_options.spin_time;
+        }
+    }
+    error_code = 0;
+    return 0;
+}
+
+bool pcie_data_transport::packet_receive_release(int& error_code) {
+    if (rx_batch_packets <= 1) {
+        return pcie_if->pcie_dma_data_receive_release(error_code);
+    }
+    // batched buffers are released together, when the next batch is checked out
+    error_code = 0;
+    return true;
+}
+
 #endif // #ifdef VXSDR_ENABLE_PCIE
\ No newline at end of file
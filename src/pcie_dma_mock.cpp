@@ -0,0 +1,400 @@
+// Copyright (c) 2024 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/mman.h>
+
+#include "logging.hpp"
+#include "pcie_dma_mock.hpp"
+
+/*! @file pcie_dma_mock.cpp
+    @brief A software model of the vxsdr_dma driver and device, for running the PCIe transports without hardware.
+*/
+
+pcie_dma_mock::pcie_dma_mock(const pcie_dma_mock_options& options) : opts(options) {
+    if (opts.tx_buffer_count == 0 or opts.rx_buffer_count < 2 or opts.buffer_bytes < sizeof(packet_header)) {
+        LOG_ERROR("pcie_dma_mock needs tx buffers, at least 2 rx buffers, and buffers larger than a packet header");
+        throw std::invalid_argument("invalid pcie_dma_mock buffer options");
+    }
+    region_bytes = (size_t)(opts.tx_buffer_count + opts.rx_buffer_count) * opts.buffer_bytes;
+    region       = ::mmap(nullptr, region_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        region = nullptr;
+        LOG_ERROR("pcie_dma_mock unable to map {:d} bytes of buffer memory", region_bytes);
+        throw std::runtime_error("pcie_dma_mock unable to map buffer memory");
+    }
+    for (unsigned i = 0; i < opts.tx_buffer_count; i++) {
+        tx_free.push_back(i);
+    }
+    tx_drain_time = std::chrono::steady_clock::now();
+}
+
+pcie_dma_mock::~pcie_dma_mock() noexcept {
+    if (region != nullptr) {
+        ::munmap(region, region_bytes);
+    }
+}
+
+int pcie_dma_mock::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (is_open) {
+        return fail(EBUSY);
+    }
+    is_open = true;
+    return mock_fd;
+}
+
+int pcie_dma_mock::close(int fd) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (not is_open or fd != mock_fd) {
+            return fail(EBADF);
+        }
+        is_open = false;
+    }
+    rx_ready.notify_all();
+    cmd_ready.notify_all();
+    return 0;
+}
+
+int pcie_dma_mock::ioctl(int fd, unsigned long request, unsigned long arg) {
+    std::unique_lock<std::mutex> lock(mutex);
+    n_ioctls++;
+    if (not is_open or fd != mock_fd) {
+        return fail(EBADF);
+    }
+    auto* batch = reinterpret_cast<vxsdr_dma_batch*>(arg);
+    switch (request) {
+        case IOCTL_GET_DATA_MSG_BUFFER_SIZE:
+            return (int)opts.buffer_bytes;
+        case IOCTL_TX_BUFFER_CNT:
+            return (int)opts.tx_buffer_count;
+        case IOCTL_RX_BUFFER_CNT:
+            return (int)opts.rx_buffer_count;
+        case IOCTL_GET_TX_DEV_DDR_SIZE:
+            return (int)opts.tx_ddr_bytes;
+        case IOCTL_GET_RX_DEV_DDR_SIZE:
+            return (int)opts.rx_ddr_bytes;
+        case IOCTL_GET_TX_DEV_DDR_FILL:
+            drain_tx_ddr();
+            return (int)tx_ddr_fill;
+        case IOCTL_GET_RX_DEV_DDR_FILL:
+            return 0;
+        case IOCTL_TX_BLOCK_TIMEOUT:
+            tx_cmd_timeout = std::chrono::milliseconds(arg);
+            return 0;
+        case IOCTL_RX_BLOCK_TIMEOUT:
+            rx_cmd_timeout = std::chrono::milliseconds(arg);
+            return 0;
+        case IOCTL_TX_IOCTL_BLOCK_TIMEOUT:
+            tx_data_timeout = std::chrono::milliseconds(arg);
+            return 0;
+        case IOCTL_RX_IOCTL_BLOCK_TIMEOUT:
+            rx_data_timeout = std::chrono::milliseconds(arg);
+            return 0;
+        case IOCTL_MMAP_TX_SEL:
+            mmap_tx = (arg != 0);
+            return 0;
+        case IOCTL_RX_CLEAR_DATA:
+            // filled buffers not yet checked out are discarded
+            rx_head = rx_tail;
+            return 0;
+        case IOCTL_RX_CLEAR_CTRL:
+            cmd_responses.clear();
+            return 0;
+        case IOCTL_TX_RESET:
+            tx_ddr_fill   = 0;
+            tx_drain_time = std::chrono::steady_clock::now();
+            return 0;
+        case IOCTL_GET_RX_HEAD:
+            // the driver keeps one buffer empty, so a full ring is not read as empty from the indices
+            if (rx_head - rx_tail >= opts.rx_buffer_count) {
+                return fail(EOVERFLOW);
+            }
+            return (int)(rx_head % opts.rx_buffer_count);
+        case IOCTL_GET_RX_TAIL:
+            return (int)(rx_tail % opts.rx_buffer_count);
+        case IOCTL_GET_TX_HEAD:
+        case IOCTL_GET_TX_TAIL:
+            return 0;
+        case IOCTL_CHECKOUT_TX_BUFFER: {
+            unsigned index = 0;
+            int result     = checkout_tx(index);
+            return (result < 0) ? result : (int)index;
+        }
+        case IOCTL_UPLOAD_TX_BUFFER_BLOCKING:
+            if (tx_checked_out.empty()) {
+                return fail(EINVAL);
+            }
+            return upload_tx(tx_checked_out.front(), arg, lock);
+        case IOCTL_RELEASE_TX_BUFFER:
+            if (tx_checked_out.empty()) {
+                return fail(EINVAL);
+            }
+            tx_free.push_back(tx_checked_out.front());
+            tx_checked_out.pop_front();
+            return 0;
+        case IOCTL_CHECKOUT_RX_BUFFER_BLOCKING:
+            return checkout_rx(lock);
+        case IOCTL_RELEASE_RX_BUFFER:
+            return release_rx(1);
+        case IOCTL_CHECKOUT_TX_BUFFERS: {
+            if (not opts.batch_ioctls) {
+                return fail(ENOTTY);
+            }
+            const unsigned n = std::min(batch->count, (unsigned)VXSDR_DMA_BATCH_MAX);
+            unsigned k = 0;
+            while (k < n and checkout_tx(batch->index[k]) == 0) {
+                k++;
+            }
+            if (k == 0) {
+                return fail(EBUSY);
+            }
+            batch->count = k;
+            return 0;
+        }
+        case IOCTL_UPLOAD_TX_BUFFERS_BLOCKING: {
+            if (not opts.batch_ioctls) {
+                return fail(ENOTTY);
+            }
+            // copy the buffers to upload, since waiting for room in the device's buffer unlocks the mock
+            const std::vector<unsigned> to_upload(tx_checked_out.begin(),
+                                                  tx_checked_out.begin() + std::min((size_t)batch->count, tx_checked_out.size()));
+            int result = 0;
+            for (unsigned i = 0; i < to_upload.size() and result == 0; i++) {
+                result = upload_tx(to_upload[i], batch->bytes[i], lock);
+            }
+            const int upload_error = errno;
+            tx_free.insert(tx_free.end(), tx_checked_out.begin(), tx_checked_out.end());
+            tx_checked_out.clear();
+            return (result < 0) ? fail(upload_error) : 0;
+        }
+        case IOCTL_CHECKOUT_RX_BUFFERS_BLOCKING: {
+            if (not opts.batch_ioctls) {
+                return fail(ENOTTY);
+            }
+            const unsigned n = std::clamp(batch->count, 1U, (unsigned)VXSDR_DMA_BATCH_MAX);
+            int first = checkout_rx(lock);
+            if (first < 0) {
+                return first;
+            }
+            batch->index[0] = (unsigned)first;
+            unsigned k = 1;
+            while (k < n and rx_head > rx_tail) {
+                batch->index[k++] = (unsigned)(rx_tail++ % opts.rx_buffer_count);
+            }
+            batch->count = k;
+            return 0;
+        }
+        case IOCTL_RELEASE_RX_BUFFERS:
+            if (not opts.batch_ioctls) {
+                return fail(ENOTTY);
+            }
+            return release_rx((unsigned)arg);
+        default:
+            return fail(ENOTTY);
+    }
+}
+
+void* pcie_dma_mock::mmap(size_t length, int fd) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (not is_open or fd != mock_fd) {
+        fail(EBADF);
+        return MAP_FAILED;
+    }
+    if (length > opts.buffer_bytes) {
+        fail(EINVAL);
+        return MAP_FAILED;
+    }
+    if (mmap_tx) {
+        if (tx_mapped >= opts.tx_buffer_count) {
+            fail(ENOMEM);
+            return MAP_FAILED;
+        }
+        return buffer(tx_mapped++);
+    }
+    if (rx_mapped >= opts.rx_buffer_count) {
+        fail(ENOMEM);
+        return MAP_FAILED;
+    }
+    return buffer(opts.tx_buffer_count + rx_mapped++);
+}
+
+int pcie_dma_mock::munmap(void* addr, size_t length) {
+    // the buffers stay mapped until the mock is destroyed
+    return 0;
+}
+
+ssize_t pcie_dma_mock::read(int fd, void* buf, size_t n_bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (not is_open or fd != mock_fd) {
+        return fail(EBADF);
+    }
+    if (not cmd_ready.wait_for(lock, rx_cmd_timeout, [this] { return not cmd_responses.empty() or not is_open; })) {
+        return fail(ETIMEDOUT);
+    }
+    if (not is_open) {
+        return fail(EBADF);
+    }
+    const auto& response = cmd_responses.front();
+    size_t bytes = std::min(n_bytes, std::min((size_t)response.hdr.packet_size, sizeof(response)));
+    std::memcpy(buf, &response, bytes);
+    cmd_responses.pop_front();
+    return (ssize_t)bytes;
+}
+
+ssize_t pcie_dma_mock::write(int fd, const void* buf, size_t n_bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (not is_open or fd != mock_fd) {
+        return fail(EBADF);
+    }
+    if (n_bytes < sizeof(packet_header) or n_bytes > sizeof(command_queue_element)) {
+        return fail(EINVAL);
+    }
+    command_queue_element command{};
+    std::memcpy(&command, buf, n_bytes);
+    command_queue_element response = command;
+    response.hdr.packet_type       = PACKET_TYPE_MAKE_RSP(command.hdr.packet_type);
+    if (command_handler) {
+        command_handler(command, response);
+        if (response.hdr.packet_size == 0) {
+            // the device drops the command without answering it
+            return (ssize_t)n_bytes;
+        }
+    }
+    response.hdr.sequence_counter = cmd_sequence++;
+    cmd_responses.push_back(response);
+    lock.unlock();
+    cmd_ready.notify_one();
+    return (ssize_t)n_bytes;
+}
+
+bool pcie_dma_mock::device_put_rx(const packet& p) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return put_rx(&p, p.hdr.packet_size);
+}
+
+void pcie_dma_mock::set_tx_data_handler(std::function<void(const packet&)> handler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tx_data_handler = std::move(handler);
+}
+
+void pcie_dma_mock::set_command_handler(std::function<void(const packet& command, packet& response)> handler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    command_handler = std::move(handler);
+}
+
+uint64_t pcie_dma_mock::ioctl_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return n_ioctls;
+}
+
+uint64_t pcie_dma_mock::tx_data_packets() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return n_tx_packets;
+}
+
+int pcie_dma_mock::fail(const int error_code) const noexcept {
+    errno = error_code;
+    return -1;
+}
+
+int pcie_dma_mock::checkout_tx(unsigned& index) {
+    if (tx_free.empty()) {
+        return fail(EBUSY);
+    }
+    index = tx_free.front();
+    tx_free.pop_front();
+    tx_checked_out.push_back(index);
+    return 0;
+}
+
+int pcie_dma_mock::upload_tx(const unsigned index, const size_t n_bytes, std::unique_lock<std::mutex>& lock) {
+    if (n_bytes < sizeof(packet_header) or n_bytes > opts.buffer_bytes) {
+        return fail(EINVAL);
+    }
+    if (opts.tx_drain_bytes_per_s > 0) {
+        // wait for room in the device's buffer, as the driver's blocking upload does
+        const auto deadline = std::chrono::steady_clock::now() + tx_data_timeout;
+        drain_tx_ddr();
+        while (tx_ddr_fill + (double)n_bytes > (double)opts.tx_ddr_bytes) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return fail(ETIMEDOUT);
+            }
+            const double wait_s = (tx_ddr_fill + (double)n_bytes - (double)opts.tx_ddr_bytes) / opts.tx_drain_bytes_per_s;
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait_s));
+            lock.lock();
+            drain_tx_ddr();
+        }
+        tx_ddr_fill += (double)n_bytes;
+    }
+    const auto* p = reinterpret_cast<const packet*>(buffer(index));
+    if (p->hdr.packet_type == PACKET_TYPE_TX_SIGNAL_DATA) {
+        n_tx_packets++;
+        if (tx_data_handler) {
+            tx_data_handler(*p);
+        }
+        if ((p->hdr.flags & FLAGS_REQUEST_ACK) != 0) {
+            six_uint32_packet ack;
+            ack.hdr    = {PACKET_TYPE_TX_SIGNAL_DATA_ACK, 0, 0, p->hdr.subdevice, 0, sizeof(six_uint32_packet), 0};
+            ack.value3 = (uint32_t)tx_ddr_fill;
+            ack.value4 = opts.tx_ddr_bytes;
+            put_rx(&ack, sizeof(ack));
+        }
+    }
+    return 0;
+}
+
+int pcie_dma_mock::checkout_rx(std::unique_lock<std::mutex>& lock) {
+    if (not rx_ready.wait_for(lock, rx_data_timeout, [this] { return rx_head > rx_tail or not is_open; })) {
+        return fail(ETIMEDOUT);
+    }
+    if (not is_open) {
+        return fail(EBADF);
+    }
+    return (int)(rx_tail++ % opts.rx_buffer_count);
+}
+
+int pcie_dma_mock::release_rx(const unsigned n) {
+    if (rx_released + n > rx_tail) {
+        return fail(EINVAL);
+    }
+    rx_released += n;
+    return 0;
+}
+
+void pcie_dma_mock::drain_tx_ddr() {
+    const auto now = std::chrono::steady_clock::now();
+    if (opts.tx_drain_bytes_per_s <= 0) {
+        tx_ddr_fill = 0;
+    } else {
+        const double drained = opts.tx_drain_bytes_per_s * std::chrono::duration<double>(now - tx_drain_time).count();
+        tx_ddr_fill          = std::max(0.0, tx_ddr_fill - drained);
+    }
+    tx_drain_time = now;
+}
+
+bool pcie_dma_mock::put_rx(const void* data, const size_t n_bytes) {
+    // one buffer is always left empty, as the driver does
+    if (not is_open or rx_head - rx_released >= opts.rx_buffer_count - 1 or n_bytes > opts.buffer_bytes) {
+        return false;
+    }
+    auto* p = buffer(opts.tx_buffer_count + (unsigned)(rx_head % opts.rx_buffer_count));
+    std::memcpy(p, data, n_bytes);
+    reinterpret_cast<packet*>(p)->hdr.sequence_counter = rx_sequence++;
+    rx_head++;
+    rx_ready.notify_all();
+    return true;
+}
+
+uint8_t* pcie_dma_mock::buffer(const unsigned n) const noexcept {
+    return static_cast<uint8_t*>(region) + (size_t)n * opts.buffer_bytes;
+}
@@ -21,20 +21,39 @@
     @brief Radio command functions for the @p vxsdr class.
 */
 
-bool vxsdr::imp::tx_start(const vxsdr::time_point& t,
-                                           const uint64_t n,
-                                           const uint8_t subdev) {
-    if (not vxsdr::imp::get_tx_enabled(subdev)) {
-        LOG_ERROR("tx is not enabled in tx_start()");
+bool vxsdr::imp::stream_can_start(const bool tx, const uint8_t subdev, const std::string& cmd_name) {
+    const std::string dir = tx ? "tx" : "rx";
+    if (vxsdr::imp::in_transaction()) {
+        LOG_ERROR("{:s} cannot be used in a transaction", cmd_name);
+        return false;
+    }
+    // send both queries before waiting for either response
+    std::array<command_queue_element, 2> q{};
+    q[0].hdr = {(uint8_t)(tx ? PACKET_TYPE_TX_RADIO_CMD : PACKET_TYPE_RX_RADIO_CMD), RADIO_CMD_GET_RF_ENABLED, 0, subdev, 0,
+                sizeof(header_only_packet), 0};
+    q[1].hdr = {PACKET_TYPE_DEVICE_CMD, DEVICE_CMD_GET_STREAM_STATE, 0, subdev, 0, sizeof(header_only_packet), 0};
+    const std::array<std::string, 2> names = {"get_" + dir + "_enabled()", "get_" + dir + "_stream_state()"};
+    auto res = vxsdr::imp::send_commands_and_return_responses(q, names);
+    if (not res[0] or std::bit_cast<const one_uint32_packet*>(&res[0].value())->value1 == 0) {
+        LOG_ERROR("{:s} is not enabled in {:s}", dir, cmd_name);
+        return false;
+    }
+    if (not res[1]) {
+        LOG_ERROR("unable to get {:s} stream state in {:s}", dir, cmd_name);
         return false;
     }
-    auto res = vxsdr::imp::get_tx_stream_state(subdev);
-    if (not res) {
-        LOG_ERROR("unable to get tx stream state in tx_start()");
+    auto state = vxsdr::imp::stream_state_from_response(res[1].value(), tx);
+    if (state != STREAM_STOPPED) {
+        LOG_ERROR("{:s} stream state is {:s} in {:s}", dir, vxsdr::imp::stream_state_to_string(state), cmd_name);
         return false;
     }
-    if (res.value() != STREAM_STOPPED) {
-        LOG_ERROR("tx stream state is {:s} in tx_start()", vxsdr::imp::stream_state_to_string(res.value()));
+    return true;
+}
+
+bool vxsdr::imp::tx_start(const vxsdr::time_point& t,
+                                           const uint64_t n,
+                                           const uint8_t subdev) {
+    if (not vxsdr::imp::stream_can_start(true, subdev, "tx_start()")) {
         return false;
     }
     vxsdr::imp::data_tport->reset_tx_stream(n);
@@ -52,18 +71,7 @@ bool vxsdr::imp::tx_start(const vxsdr::time_point& t,
 bool vxsdr::imp::rx_start(const vxsdr::time_point& t,
                                            const uint64_t n,
                                            const uint8_t subdev) {
-    if (not vxsdr::imp::get_rx_enabled(subdev)) {
-        LOG_ERROR("rx is not enabled in rx_start()");
-        return false;
-    }
-    auto res = vxsdr::imp::get_rx_stream_state(subdev);
-    if (not res) {
-        LOG_ERROR("unable to get rx stream state in rx_start()");
-        return false;
-    }
-    if (res.value() != STREAM_STOPPED) {
-        LOG_ERROR("rx stream state is {:s} in rx_start()",
-                              vxsdr::imp::stream_state_to_string(res.value()));
+    if (not vxsdr::imp::stream_can_start(false, subdev, "rx_start()")) {
         return false;
     }
     vxsdr::imp::data_tport->reset_rx_stream(n);
@@ -84,18 +92,7 @@ bool vxsdr::imp::tx_loop(const vxsdr::time_point& t,
                                         const uint32_t n_repeat,
                                         const uint8_t subdev)
 {
-    if (not vxsdr::imp::get_tx_enabled(subdev)) {
-        LOG_ERROR("tx is not enabled in tx_loop()");
-        return false;
-    }
-    auto res = vxsdr::imp::get_tx_stream_state(subdev);
-    if (not res) {
-        LOG_ERROR("unable to get tx stream state in tx_loop()");
-        return false;
-    }
-    if (res.value() != STREAM_STOPPED) {
-        LOG_ERROR("tx stream state is {:s} in tx_loop()",
-                              vxsdr::imp::stream_state_to_string(res.value()));
+    if (not vxsdr::imp::stream_can_start(true, subdev, "tx_loop()")) {
         return false;
     }
     vxsdr::imp::data_tport->reset_tx_stream(n * n_repeat);
@@ -118,17 +115,7 @@ bool vxsdr::imp::rx_loop(const vxsdr::time_point& t,
                                         const uint32_t n_repeat,
                                         const uint8_t subdev)
 {
-    if (not vxsdr::imp::get_rx_enabled(subdev)) {
-        LOG_ERROR("rx is not enabled in rx_loop()");
-        return false;
-    }
-    auto res = vxsdr::imp::get_rx_stream_state(subdev);
-    if (not res) {
-        LOG_ERROR("unable to get rx stream state in rx_loop()");
-        return false;
-    }
-    if (res.value() != STREAM_STOPPED) {
-        LOG_ERROR("rx stream state is {:s} in rx_loop()", vxsdr::imp::stream_state_to_string(res.value()));
+    if (not vxsdr::imp::stream_can_start(false, subdev, "rx_loop()")) {
         return false;
     }
     vxsdr::imp::data_tport->reset_rx_stream(n * n_repeat);
@@ -256,7 +243,7 @@ std::optional<std::array<double, 4>> vxsdr::imp::get_rx_iq_corr(const uint8_t su
 std::optional<std::array<double, 2>> vxsdr::imp::get_tx_freq_range(const uint8_t subdev) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_RF_FREQ_RANGE, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_tx_freq_range()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_freq_range()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -269,7 +256,7 @@ std::optional<std::array<double, 2>> vxsdr::imp::get_tx_freq_range(const uint8_t
 std::optional<std::array<double, 2>> vxsdr::imp::get_rx_freq_range(const uint8_t subdev) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_RF_FREQ_RANGE, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_rx_freq_range()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_freq_range()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -346,7 +333,7 @@ std::optional<double> vxsdr::imp::get_rx_if_freq(const uint8_t subdev) {
 std::optional<unsigned> vxsdr::imp::get_tx_num_freq_stages(const uint8_t subdev) {
     header_only_packet p;
     p.hdr                = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_NUM_RF_FREQ_STAGES, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_tx_num_freq_stages()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_num_freq_stages()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -358,7 +345,7 @@ std::optional<unsigned> vxsdr::imp::get_tx_num_freq_stages(const uint8_t subdev)
 std::optional<unsigned> vxsdr::imp::get_rx_num_freq_stages(const uint8_t subdev) {
     header_only_packet p;
     p.hdr                = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_NUM_RF_FREQ_STAGES, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_rx_num_freq_stages()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_num_freq_stages()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -371,7 +358,7 @@ std::optional<std::string> vxsdr::imp::get_tx_freq_stage_name(const unsigned sta
     one_uint32_packet p;
     p.hdr         = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_RF_FREQ_STAGE_NAME, 0, subdev, 0, sizeof(p), 0};
     p.value1      = stage_num;
-    auto res      = vxsdr::imp::send_command_and_return_response(p, "get_tx_freq_stage_name()");
+    auto res      = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_freq_stage_name()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<name_packet*>(&q);
@@ -384,7 +371,7 @@ std::optional<std::string> vxsdr::imp::get_rx_freq_stage_name(const unsigned sta
     one_uint32_packet p;
     p.hdr         = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_RF_FREQ_STAGE_NAME, 0, subdev, 0, sizeof(p), 0};
     p.value1      = stage_num;
-    auto res      = vxsdr::imp::send_command_and_return_response(p, "get_rx_freq_stage_name()");
+    auto res      = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_freq_stage_name()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<name_packet*>(&q);
@@ -397,7 +384,7 @@ std::optional<std::array<double, 2>> vxsdr::imp::get_tx_freq_range_stage(const u
     one_uint32_packet p;
     p.hdr                = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_RF_FREQ_RANGE_STAGE, 0, subdev, 0, sizeof(p), 0};
     p.value1             = stage_num;
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_tx_freq_range_stage()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_freq_range_stage()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -411,7 +398,7 @@ std::optional<std::array<double, 2>> vxsdr::imp::get_rx_freq_range_stage(const u
     one_uint32_packet p;
     p.hdr                = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_RF_FREQ_RANGE_STAGE, 0, subdev, 0, sizeof(p), 0};
     p.value1             = stage_num;
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_rx_freq_range_stage()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_freq_range_stage()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -468,7 +455,7 @@ std::optional<double> vxsdr::imp::get_rx_freq_stage(const unsigned stage_num, co
 std::optional<std::array<double, 2>> vxsdr::imp::get_tx_gain_range(const uint8_t subdev, const uint8_t channel) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_RF_GAIN_RANGE, 0, subdev, channel, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_tx_gain_range()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_gain_range()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -481,7 +468,7 @@ std::optional<std::array<double, 2>> vxsdr::imp::get_tx_gain_range(const uint8_t
 std::optional<std::array<double, 2>> vxsdr::imp::get_rx_gain_range(const uint8_t subdev, const uint8_t channel) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_RF_GAIN_RANGE, 0, subdev, channel, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_rx_gain_range()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_gain_range()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -532,7 +519,7 @@ std::optional<double> vxsdr::imp::get_rx_gain(const uint8_t subdev, const uint8_
 std::optional<unsigned> vxsdr::imp::get_tx_num_gain_stages(const uint8_t subdev) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_NUM_RF_GAIN_STAGES, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_tx_num_gain_stages()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_num_gain_stages()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -544,7 +531,7 @@ std::optional<unsigned> vxsdr::imp::get_tx_num_gain_stages(const uint8_t subdev)
 std::optional<unsigned> vxsdr::imp::get_rx_num_gain_stages(const uint8_t subdev) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_NUM_RF_GAIN_STAGES, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_rx_num_gain_stages()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_num_gain_stages()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -557,7 +544,7 @@ std::optional<std::string> vxsdr::imp::get_tx_gain_stage_name(const unsigned sta
     one_uint32_packet p;
     p.hdr         = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_RF_GAIN_STAGE_NAME, 0, subdev, 0, sizeof(p), 0};
     p.value1      = stage_num;
-    auto res      = vxsdr::imp::send_command_and_return_response(p, "get_tx_gain_stage_name()");
+    auto res      = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_gain_stage_name()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<name_packet*>(&q);
@@ -570,7 +557,7 @@ std::optional<std::string> vxsdr::imp::get_rx_gain_stage_name(const unsigned sta
     one_uint32_packet p;
     p.hdr         = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_RF_GAIN_STAGE_NAME, 0, subdev, 0, sizeof(p), 0};
     p.value1      = stage_num;
-    auto res      = vxsdr::imp::send_command_and_return_response(p, "get_rx_gain_stage_name()");
+    auto res      = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_gain_stage_name()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<name_packet*>(&q);
@@ -583,7 +570,7 @@ std::optional<std::array<double, 2>> vxsdr::imp::get_tx_gain_range_stage(const u
     one_uint32_packet p;
     p.hdr                = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_RF_GAIN_RANGE_STAGE, 0, subdev, 0, sizeof(p), 0};
     p.value1             = stage_num;
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_tx_gain_range_stage()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_gain_range_stage()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -597,7 +584,7 @@ std::optional<std::array<double, 2>> vxsdr::imp::get_rx_gain_range_stage(const u
     one_uint32_packet p;
     p.hdr                = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_RF_GAIN_RANGE_STAGE, 0, subdev, 0, sizeof(p), 0};
     p.value1             = stage_num;
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_rx_gain_range_stage()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_gain_range_stage()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -652,7 +639,7 @@ std::optional<double> vxsdr::imp::get_rx_gain_stage(const unsigned stage_num, co
 std::optional<std::array<double, 2>> vxsdr::imp::get_tx_rate_range(const uint8_t subdev) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_SAMPLE_RATE_RANGE, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_tx_rate_range()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_rate_range()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -665,7 +652,7 @@ std::optional<std::array<double, 2>> vxsdr::imp::get_tx_rate_range(const uint8_t
 std::optional<std::array<double, 2>> vxsdr::imp::get_rx_rate_range(const uint8_t subdev) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_SAMPLE_RATE_RANGE, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_rx_rate_range()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_rate_range()");
     if (res) {
         auto q                    = res.value();
         auto* r                   = std::bit_cast<two_double_packet*>(&q);
@@ -802,7 +789,7 @@ std::optional<std::vector<vxsdr::filter_coefficient>> vxsdr::imp::get_rx_filter_
 std::optional<unsigned> vxsdr::imp::get_tx_filter_length(const uint8_t subdev) {
     header_only_packet p;
     p.hdr    = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_FILTER_LENGTH, 0, subdev, 0, sizeof(p), 0};
-    auto res = vxsdr::imp::send_command_and_return_response(p, "get_tx_filter_length()");
+    auto res = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_filter_length()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -814,7 +801,7 @@ std::optional<unsigned> vxsdr::imp::get_tx_filter_length(const uint8_t subdev) {
 std::optional<unsigned> vxsdr::imp::get_rx_filter_length(const uint8_t subdev) {
     header_only_packet p;
     p.hdr    = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_FILTER_LENGTH, 0, subdev, 0, sizeof(p), 0};
-    auto res = vxsdr::imp::send_command_and_return_response(p, "get_rx_filter_length()");
+    auto res = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_filter_length()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -896,7 +883,7 @@ bool vxsdr::imp::get_rx_lo_locked(const uint8_t subdev) {
 std::optional<unsigned> vxsdr::imp::get_tx_num_ports(const uint8_t subdev, const uint8_t channel) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_NUM_RF_PORTS, 0, subdev, channel, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_tx_num_ports()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_num_ports()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -908,7 +895,7 @@ std::optional<unsigned> vxsdr::imp::get_tx_num_ports(const uint8_t subdev, const
 std::optional<unsigned> vxsdr::imp::get_rx_num_ports(const uint8_t subdev, const uint8_t channel) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_NUM_RF_PORTS, 0, subdev, channel, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_rx_num_ports()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_num_ports()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -920,7 +907,7 @@ std::optional<unsigned> vxsdr::imp::get_rx_num_ports(const uint8_t subdev, const
 std::optional<unsigned> vxsdr::imp::get_tx_num_channels(const uint8_t subdev) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_NUM_CHANNELS, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_tx_num_channels()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_num_channels()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -932,7 +919,7 @@ std::optional<unsigned> vxsdr::imp::get_tx_num_channels(const uint8_t subdev) {
 std::optional<unsigned> vxsdr::imp::get_rx_num_channels(const uint8_t subdev) {
     header_only_packet p = {};
     p.hdr                = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_NUM_CHANNELS, 0, subdev, 0, sizeof(p), 0};
-    auto res             = vxsdr::imp::send_command_and_return_response(p, "get_rx_num_channels()");
+    auto res             = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_num_channels()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<one_uint32_packet*>(&q);
@@ -945,7 +932,7 @@ std::optional<std::string> vxsdr::imp::get_tx_port_name(const unsigned port_num,
     one_uint32_packet p = {};
     p.hdr               = {PACKET_TYPE_TX_RADIO_CMD, RADIO_CMD_GET_RF_PORT_NAME, 0, subdev, channel, sizeof(p), 0};
     p.value1            = port_num;
-    auto res            = vxsdr::imp::send_command_and_return_response(p, "get_tx_port_name()");
+    auto res            = vxsdr::imp::send_query_and_return_cached_response(p, "get_tx_port_name()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<name_packet*>(&q);
@@ -958,7 +945,7 @@ std::optional<std::string> vxsdr::imp::get_rx_port_name(const unsigned port_num,
     one_uint32_packet p = {};
     p.hdr               = {PACKET_TYPE_RX_RADIO_CMD, RADIO_CMD_GET_RF_PORT_NAME, 0, subdev, channel, sizeof(p), 0};
     p.value1            = port_num;
-    auto res            = vxsdr::imp::send_command_and_return_response(p, "get_rx_port_name()");
+    auto res            = vxsdr::imp::send_query_and_return_cached_response(p, "get_rx_port_name()");
     if (res) {
         auto q  = res.value();
         auto* r = std::bit_cast<name_packet*>(&q);
@@ -0,0 +1,192 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+#include "sample_conversion.hpp"
+
+/*! @file sample_conversion.cpp
+    @brief Vector kernels for converting between half precision samples and @p vxsdr::wire_sample.
+*/
+
+#ifdef VXSDR_HAS_FLOAT16
+
+#if defined(__x86_64__) && (defined(VXSDR_COMPILER_GCC) || defined(VXSDR_COMPILER_CLANG))
+#define VXSDR_FLOAT16_X86_KERNELS
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define VXSDR_FLOAT16_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// the kernels below work on interleaved real and imaginary parts, so n is twice the number of samples
+using from_wire_kernel = void (*)(const int16_t* in, _Float16* out, const size_t n);
+using to_wire_kernel   = void (*)(const _Float16* in, int16_t* out, const size_t n);
+static_assert(sizeof(vxsdr::complex_float16) == 2 * sizeof(_Float16), "complex_float16 must hold exactly two _Float16 values");
+
+constexpr float from_wire_scale = 1.0F / 32'768.0F;
+constexpr float to_wire_scale   = 32'767.0F;
+
+void from_wire_scalar(const int16_t* in, _Float16* out, const size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (_Float16)(from_wire_scale * (float)in[i]);
+    }
+}
+
+// rounds half away from zero, like the float conversion, and saturates values outside [-1, 1]
+void to_wire_scalar(const _Float16* in, int16_t* out, const size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        float x = to_wire_scale * (float)in[i];
+        if (x > 0.0F) {
+            x += 0.5F;
+        } else {
+            x -= 0.5F;
+        }
+        out[i] = (int16_t)std::clamp(x, -32'768.0F, 32'767.0F);
+    }
+}
+
+#ifdef VXSDR_FLOAT16_X86_KERNELS
+
+__attribute__((target("avx2,f16c"))) void from_wire_f16c(const int16_t* in, _Float16* out, const size_t n) {
+    const __m256 scale = _mm256_set1_ps(from_wire_scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i w = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i)));
+        __m256 f  = _mm256_mul_ps(_mm256_cvtepi32_ps(w), scale);
+        _mm_storeu_si128((__m128i*)(out + i), _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    }
+    from_wire_scalar(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2,f16c"))) void to_wire_f16c(const _Float16* in, int16_t* out, const size_t n) {
+    const __m256 scale     = _mm256_set1_ps(to_wire_scale);
+    const __m256 half      = _mm256_set1_ps(0.5F);
+    const __m256 sign_mask = _mm256_set1_ps(-0.0F);
+    const __m256 max_value = _mm256_set1_ps(32'767.0F);
+    const __m256 min_value = _mm256_set1_ps(-32'768.0F);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 f  = _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(in + i))), scale);
+        __m256 r  = _mm256_add_ps(f, _mm256_or_ps(half, _mm256_and_ps(f, sign_mask)));
+        __m256i v = _mm256_cvttps_epi32(_mm256_max_ps(_mm256_min_ps(r, max_value), min_value));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+    }
+    to_wire_scalar(in + i, out + i, n - i);
+}
+
+// gcc 12 warns spuriously about the undefined pass-through operand used by many AVX-512 intrinsics
+#if defined(VXSDR_COMPILER_GCC)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// the scale is a power of two, so converting int16 directly to half and scaling gives the same result as going through float
+__attribute__((target("avx512fp16,avx512bw,avx512vl"))) void from_wire_avx512fp16(const int16_t* in, _Float16* out, const size_t n) {
+    const __m512h scale = _mm512_set1_ph((_Float16)from_wire_scale);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512h h = _mm512_mul_ph(_mm512_cvtepi16_ph(_mm512_loadu_si512((const void*)(in + i))), scale);
+        _mm512_storeu_ph((void*)(out + i), h);
+    }
+    from_wire_f16c(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx512fp16,avx512bw,avx512vl"))) void to_wire_avx512fp16(const _Float16* in, int16_t* out, const size_t n) {
+    const __m512 scale      = _mm512_set1_ps(to_wire_scale);
+    const __m512 half       = _mm512_set1_ps(0.5F);
+    const __m512i sign_mask = _mm512_set1_epi32(INT32_MIN);
+    const __m512 max_value  = _mm512_set1_ps(32'767.0F);
+    const __m512 min_value  = _mm512_set1_ps(-32'768.0F);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 f  = _mm512_mul_ps(_mm512_cvtxph_ps(_mm256_loadu_ph((const void*)(in + i))), scale);
+        __m512 r  = _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(half),
+                                                        _mm512_and_si512(_mm512_castps_si512(f), sign_mask)));
+        __m512i v = _mm512_cvttps_epi32(_mm512_max_ps(_mm512_min_ps(_mm512_add_ps(f, r), max_value), min_value));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm512_cvtsepi32_epi16(v));
+    }
+    to_wire_f16c(in + i, out + i, n - i);
+}
+
+#if defined(VXSDR_COMPILER_GCC)
+#pragma GCC diagnostic pop
+#endif
+
+#endif  // VXSDR_FLOAT16_X86_KERNELS
+
+#ifdef VXSDR_FLOAT16_NEON_KERNELS
+
+void from_wire_neon(const int16_t* in, _Float16* out, const size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t w    = vld1q_s16(in + i);
+        float32x4_t lo = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))), from_wire_scale);
+        float32x4_t hi = vmulq_n_f32(vcvtq_f32_s32(vmovl_high_s16(w)), from_wire_scale);
+        vst1q_f16((float16_t*)(out + i), vcombine_f16(vcvt_f16_f32(lo), vcvt_f16_f32(hi)));
+    }
+    from_wire_scalar(in + i, out + i, n - i);
+}
+
+// vcvtaq rounds half away from zero, matching the scalar conversion
+void to_wire_neon(const _Float16* in, int16_t* out, const size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float16x8_t h  = vld1q_f16((const float16_t*)(in + i));
+        float32x4_t lo = vmulq_n_f32(vcvt_f32_f16(vget_low_f16(h)), to_wire_scale);
+        float32x4_t hi = vmulq_n_f32(vcvt_high_f32_f16(h), to_wire_scale);
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vcvtaq_s32_f32(lo)), vqmovn_s32(vcvtaq_s32_f32(hi))));
+    }
+    to_wire_scalar(in + i, out + i, n - i);
+}
+
+#endif  // VXSDR_FLOAT16_NEON_KERNELS
+
+from_wire_kernel select_from_wire_kernel() {
+#if defined(VXSDR_FLOAT16_X86_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512fp16") and __builtin_cpu_supports("avx512bw") and __builtin_cpu_supports("avx512vl")) {
+        return from_wire_avx512fp16;
+    }
+    if (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("f16c")) {
+        return from_wire_f16c;
+    }
+#elif defined(VXSDR_FLOAT16_NEON_KERNELS)
+    return from_wire_neon;
+#endif
+    return from_wire_scalar;
+}
+
+to_wire_kernel select_to_wire_kernel() {
+#if defined(VXSDR_FLOAT16_X86_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512fp16") and __builtin_cpu_supports("avx512bw") and __builtin_cpu_supports("avx512vl")) {
+        return to_wire_avx512fp16;
+    }
+    if (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("f16c")) {
+        return to_wire_f16c;
+    }
+#elif defined(VXSDR_FLOAT16_NEON_KERNELS)
+    return to_wire_neon;
+#endif
+    return to_wire_scalar;
+}
+
+}  // namespace
+
+void convert_from_wire_float16(const vxsdr::wire_sample* in, vxsdr::complex_float16* out, const size_t n) {
+    static const from_wire_kernel kernel = select_from_wire_kernel();
+    kernel((const int16_t*)in, (_Float16*)out, 2 * n);
+}
+
+void convert_to_wire_float16(const vxsdr::complex_float16* in, vxsdr::wire_sample* out, const size_t n) {
+    static const to_wire_kernel kernel = select_to_wire_kernel();
+    kernel((const _Float16*)in, (int16_t*)out, 2 * n);
+}
+
+#endif  // VXSDR_HAS_FLOAT16
@@ -1,12 +1,61 @@
 // Copyright (c) 2023 Vesperix Corporation
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+
 #include "vxsdr_net.hpp"
+#include "socket_utils.hpp"
+
+size_t receive_polling(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes,
+                       const std::atomic<bool>& stop_flag, const busy_poll_options& options, int& error_code,
+                       uint64_t* arrival_time, size_t* segment_bytes) {
+    // the clock is only read every few tries, since a try without a packet takes well under a microsecond
+    static constexpr unsigned tries_per_clock_check = 64;
+    net::socket_base::message_flags flags = 0;
+    net_error_code::error_code err;
+    auto idle_start = std::chrono::steady_clock::now();
+    bool backing_off = false;
+    for (unsigned n_tries = 1; not stop_flag; n_tries++) {
+        size_t bytes = 0;
+        if (arrival_time != nullptr or segment_bytes != nullptr) {
+            int receive_error = 0;
+            uint64_t unused_arrival_time = 0;
+            size_t unused_segment_bytes  = 0;
+            bytes = receive_coalesced(sock, buffer, n_bytes, segment_bytes != nullptr ? *segment_bytes : unused_segment_bytes,
+                                      arrival_time != nullptr ? *arrival_time : unused_arrival_time, receive_error);
+            err.assign(receive_error, net_error_code::system_category());
+        } else {
+            bytes = sock.receive(net::buffer(buffer, n_bytes), flags, err);
+        }
+        // asio maps the platform's would-block codes (EAGAIN, EWOULDBLOCK, WSAEWOULDBLOCK) to these
+        if (err != net::error::would_block and err != net::error::try_again) {
+            error_code = err.value();
+            return bytes;
+        }
+        if (backing_off) {
+            std::this_thread::sleep_for(options.idle_backoff);
+        } else if (n_tries % tries_per_clock_check == 0) {
+            backing_off = (std::chrono::steady_clock::now() - idle_start) > options.spin_time;
+        }
+    }
+    error_code = 0;
+    return 0;
+}
 
 #ifdef VXSDR_TARGET_LINUX
+#include <ctime>
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 
 int get_socket_mtu(net::ip::udp::socket& sock) {
     int mtu = 0;
@@ -25,6 +74,86 @@ int set_socket_dontfrag(net::ip::udp::socket& sock) {
     return setsockopt(sock.native_handle(), IPPROTO_IP, IP_MTU_DISCOVER, (void *)&val, sizeof(val));
 }
 
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+int set_socket_busy_poll(net::ip::udp::socket& sock, const int busy_poll_us) {
+    int val = busy_poll_us;
+    if (setsockopt(sock.native_handle(), SOL_SOCKET, SO_BUSY_POLL, (void *)&val, sizeof(val)) != 0) {
+        return -1;
+    }
+    val = 1;
+    if (setsockopt(sock.native_handle(), SOL_SOCKET, SO_PREFER_BUSY_POLL, (void *)&val, sizeof(val)) != 0) {
+        return 1;
+    }
+    return 0;
+}
+
+int set_socket_timestamping(net::ip::udp::socket& sock) {
+    int val = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(sock.native_handle(), SOL_SOCKET, SO_TIMESTAMPING, (void *)&val, sizeof(val)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+int set_socket_gro(net::ip::udp::socket& sock) {
+    int val = 1;
+    return setsockopt(sock.native_handle(), SOL_UDP, UDP_GRO, (void *)&val, sizeof(val)) == 0 ? 0 : -1;
+}
+
+size_t receive_timestamped(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes, uint64_t& arrival_time,
+                           int& error_code) {
+    size_t segment_bytes = 0;
+    return receive_coalesced(sock, buffer, n_bytes, segment_bytes, arrival_time, error_code);
+}
+
+size_t receive_coalesced(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes, size_t& segment_bytes,
+                         uint64_t& arrival_time, int& error_code) {
+    iovec data{buffer, n_bytes};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(int))];
+    msghdr message{};
+    message.msg_iov        = &data;
+    message.msg_iovlen     = 1;
+    message.msg_control    = control;
+    message.msg_controllen = sizeof(control);
+    arrival_time = 0;
+    ssize_t bytes = recvmsg(sock.native_handle(), &message, 0);
+    if (bytes < 0) {
+        error_code = errno;
+        segment_bytes = 0;
+        return 0;
+    }
+    error_code = 0;
+    segment_bytes = (size_t)bytes;
+    for (cmsghdr* c = CMSG_FIRSTHDR(&message); c != nullptr; c = CMSG_NXTHDR(&message, c)) {
+        if (c->cmsg_level == SOL_UDP and c->cmsg_type == UDP_GRO) {
+            int gso_size = 0;
+            std::memcpy(&gso_size, CMSG_DATA(c), sizeof(gso_size));
+            if (gso_size > 0) {
+                segment_bytes = (size_t)gso_size;
+            }
+        }
+        if (c->cmsg_level == SOL_SOCKET and c->cmsg_type == SO_TIMESTAMPING) {
+            scm_timestamping stamps;
+            std::memcpy(&stamps, CMSG_DATA(c), sizeof(stamps));
+            // ts[0] is the software time-stamp, on the system's real-time clock; a hardware one (ts[2])
+            // would be on the adapter's clock, which need not match it
+            const timespec& t = stamps.ts[0];
+            arrival_time = 1'000'000'000ULL * (uint64_t)t.tv_sec + (uint64_t)t.tv_nsec;
+        }
+    }
+    return (size_t)bytes;
+}
+
 #endif  //  VXSDR_TARGET_LINUX
 
 #ifdef VXSDR_TARGET_WINDOWS
@@ -47,6 +176,38 @@ int set_socket_dontfrag(net::ip::udp::socket& sock) {
     return setsockopt(sock.native_handle(), IPPROTO_IP, IP_DONTFRAG, &val, sizeof(val));
 }
 
+int set_socket_busy_poll(net::ip::udp::socket& sock, const int busy_poll_us) {
+    // not available on Windows
+    return -1;
+}
+
+int set_socket_timestamping(net::ip::udp::socket& sock) {
+    // not available on Windows
+    return -1;
+}
+
+size_t receive_timestamped(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes, uint64_t& arrival_time,
+                           int& error_code) {
+    net::socket_base::message_flags flags = 0;
+    net_error_code::error_code err;
+    arrival_time = 0;
+    size_t bytes = sock.receive(net::buffer(buffer, n_bytes), flags, err);
+    error_code = err.value();
+    return bytes;
+}
+
+int set_socket_gro(net::ip::udp::socket& sock) {
+    // not available on Windows
+    return -1;
+}
+
+size_t receive_coalesced(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes, size_t& segment_bytes,
+                         uint64_t& arrival_time, int& error_code) {
+    size_t bytes = receive_timestamped(sock, buffer, n_bytes, arrival_time, error_code);
+    segment_bytes = bytes;
+    return bytes;
+}
+
 #endif  // VXSDR_TARGET_WINDOWS
 
 #ifdef VXSDR_TARGET_MACOS
@@ -65,4 +226,36 @@ int set_socket_dontfrag(net::ip::udp::socket& sock) {
     return setsockopt(sock.native_handle(), IPPROTO_IP, IP_DONTFRAG, &val, sizeof(val));
 }
 
+int set_socket_busy_poll(net::ip::udp::socket& sock, const int busy_poll_us) {
+    // not available on Mac OS
+    return -1;
+}
+
+int set_socket_timestamping(net::ip::udp::socket& sock) {
+    // not available on Mac OS
+    return -1;
+}
+
+size_t receive_timestamped(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes, uint64_t& arrival_time,
+                           int& error_code) {
+    net::socket_base::message_flags flags = 0;
+    net_error_code::error_code err;
+    arrival_time = 0;
+    size_t bytes = sock.receive(net::buffer(buffer, n_bytes), flags, err);
+    error_code = err.value();
+    return bytes;
+}
+
+int set_socket_gro(net::ip::udp::socket& sock) {
+    // not available on Mac OS
+    return -1;
+}
+
+size_t receive_coalesced(net::ip::udp::socket& sock, void* buffer, const size_t n_bytes, size_t& segment_bytes,
+                         uint64_t& arrival_time, int& error_code) {
+    size_t bytes = receive_timestamped(sock, buffer, n_bytes, arrival_time, error_code);
+    segment_bytes = bytes;
+    return bytes;
+}
+
 #endif  // VXSDR_TARGET_MACOS
@@ -3,6 +3,7 @@
 
 #ifdef VXSDR_ENABLE_UDP
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cstddef>
@@ -92,6 +93,39 @@ udp_command_transport::udp_command_transport(const std::map<std::string, int64_t
         throw std::runtime_error("error connecting udp command receiver socket to device address " + device_ip.to_string());
     }
 
+    // the receiver only polls if busy polling can be set on the socket; otherwise it blocks as usual
+    int busy_poll_res = -1;
+    if (config["udp_command_transport:busy_poll"] != 0) {
+        busy_poll_res = set_socket_busy_poll(receiver_socket, (int)config["udp_command_transport:busy_poll_us"]);
+        if (busy_poll_res < 0) {
+            LOG_WARN("cannot set busy polling on udp command receiver socket (needs Linux and CAP_NET_ADMIN); using blocking receives");
+        } else if (busy_poll_res > 0) {
+            LOG_WARN("cannot set preferred busy polling on udp command receiver socket (needs Linux 5.11 and CAP_NET_ADMIN)");
+        }
+    }
+
+    if (busy_poll_res >= 0) {
+        LOG_DEBUG("setting udp command receiver socket to non-blocking for busy polling");
+        receiver_socket.non_blocking(true, err);
+        if (err) {
+            LOG_ERROR("error setting udp command receiver socket to non-blocking ({:s})", err.message());
+            throw std::runtime_error("error setting udp command receiver socket to non-blocking");
+        }
+        poll_options.spin_time    = std::chrono::microseconds(config["udp_command_transport:busy_poll_spin_us"]);
+        poll_options.idle_backoff = std::chrono::microseconds(config["udp_command_transport:busy_poll_backoff_us"]);
+        busy_poll = true;
+        LOG_DEBUG("udp command receiver busy polling for {:d} us, spinning for {:d} us before backing off",
+                  config["udp_command_transport:busy_poll_us"], config["udp_command_transport:busy_poll_spin_us"]);
+    }
+
+    max_commands_in_flight = (unsigned)std::clamp<int64_t>(config["udp_command_transport:commands_in_flight"], 1, max_commands_in_flight_limit);
+    LOG_DEBUG("allowing {:d} commands in flight", max_commands_in_flight);
+
+    if (config["queue_statistics"] != 0) {
+        LOG_DEBUG("enabling queue statistics");
+        enable_queue_statistics();
+    }
+
     rx_state        = TRANSPORT_STARTING;
     receiver_thread = vxsdr_thread([this] { command_receive(); });
 
@@ -158,6 +192,9 @@ size_t udp_command_transport::packet_receive(command_queue_element& packet, int&
     net::socket_base::message_flags flags = 0;
     net_error_code::error_code err;
     packet.hdr = { 0, 0, 0, 0, 0, 0, 0 };
+    if (busy_poll) {
+        return receive_polling(receiver_socket, &packet, sizeof(packet), receiver_thread_stop_flag, poll_options, error_code);
+    }
     size_t bytes = receiver_socket.receive(net::buffer(&packet, sizeof(packet)), flags, err);
     error_code = err.value();
     return bytes;
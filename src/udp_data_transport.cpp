@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <cstddef>
 #include <compare>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <string>
@@ -110,22 +111,34 @@ udp_data_transport::udp_data_transport(const std::map<std::string, int64_t>& set
     }
 
     LOG_DEBUG("checking mtu for udp data sender socket");
-    // the size returned is an estimate, so this check is not a guarantee
+    // the size returned is an estimate for the local interface, so this check is not a guarantee;
+    // the path is probed later if mtu_probe is set
     auto mtu_est = get_socket_mtu(sender_socket);
-    // mtu_est == 0 means this isn't supported on the current platform (eg Mac OS), so skip the checks
+    // mtu_est == 0 means this isn't supported on the current platform (eg Mac OS), so only the setting is used
     if (mtu_est < 0) {
         LOG_ERROR("error getting mtu for udp data sender socket");
         throw std::runtime_error("error getting mtu for udp data sender socket");
-    } else if (mtu_est > 0) {
-        if (mtu_est < 9000) {
-            LOG_WARN("mtu is less than 9000 on udp data sender socket");
-        }
-        constexpr unsigned minimum_ip_udp_header_bytes = 28;
-        unsigned socket_max_samples = (mtu_est - sizeof(packet_header) - sizeof(stream_spec_t) - sizeof(time_spec_t) - minimum_ip_udp_header_bytes) / sizeof(vxsdr::wire_sample);
-        if (socket_max_samples < max_samples_per_packet) {
-            max_samples_per_packet = sample_granularity * (socket_max_samples / sample_granularity);
-            LOG_INFO("reducing max_samples_per_packet to {:d} on udp data sender socket (mtu = {:d})", max_samples_per_packet, mtu_est);
-        }
+    }
+    auto mtu = (int)config["udp_data_transport:mtu_bytes"];
+    if (mtu_est > 0 and mtu_est < mtu) {
+        LOG_INFO("mtu of udp data sender socket ({:d}) is less than mtu_bytes setting ({:d})", mtu_est, mtu);
+        mtu = mtu_est;
+    }
+    if (mtu < min_mtu_bytes) {
+        LOG_ERROR("mtu of {:d} is too small for udp data transport (minimum is {:d})", mtu, min_mtu_bytes);
+        throw std::invalid_argument("mtu too small for udp data transport");
+    }
+    unsigned socket_max_samples = (mtu - sizeof(packet_header) - sizeof(stream_spec_t) - sizeof(time_spec_t) - minimum_ip_udp_header_bytes) / sizeof(vxsdr::wire_sample);
+    if (socket_max_samples < max_samples_per_packet) {
+        max_samples_per_packet = sample_granularity * (socket_max_samples / sample_granularity);
+        LOG_INFO("reducing max_samples_per_packet to {:d} on udp data sender socket (mtu = {:d})", max_samples_per_packet, mtu);
+    }
+
+    if (config["udp_data_transport:mtu_probe"] != 0) {
+        mtu_probing = true;
+        probe_timeout = std::chrono::milliseconds(config["udp_data_transport:mtu_probe_timeout_ms"]);
+        unsigned standard_max_samples = (standard_mtu_bytes - sizeof(packet_header) - sizeof(stream_spec_t) - sizeof(time_spec_t) - minimum_ip_udp_header_bytes) / sizeof(vxsdr::wire_sample);
+        min_probe_samples = std::min(max_samples_per_packet, sample_granularity * (standard_max_samples / sample_granularity));
     }
 
     size_t network_send_buffer_bytes    = config["udp_data_transport:network_send_buffer_bytes"];
@@ -172,19 +185,72 @@ udp_data_transport::udp_data_transport(const std::map<std::string, int64_t>& set
         }
     }
 
+    // the receiver only polls if busy polling can be set on the socket; otherwise it blocks as usual
+    int busy_poll_res = -1;
+    if (config["udp_data_transport:busy_poll"] != 0) {
+        busy_poll_res = set_socket_busy_poll(receiver_socket, (int)config["udp_data_transport:busy_poll_us"]);
+        if (busy_poll_res < 0) {
+            LOG_WARN("cannot set busy polling on udp data receiver socket (needs Linux and CAP_NET_ADMIN); using blocking receives");
+        } else if (busy_poll_res > 0) {
+            LOG_WARN("cannot set preferred busy polling on udp data receiver socket (needs Linux 5.11 and CAP_NET_ADMIN)");
+        }
+    }
+
+    if (busy_poll_res >= 0) {
+        LOG_DEBUG("setting udp data receiver socket to non-blocking for busy polling");
+        receiver_socket.non_blocking(true, err);
+        if (err) {
+            LOG_ERROR("error setting udp data receiver socket to non-blocking ({:s})", err.message());
+            throw std::runtime_error("error setting udp data receiver socket to non-blocking");
+        }
+        poll_options.spin_time    = std::chrono::microseconds(config["udp_data_transport:busy_poll_spin_us"]);
+        poll_options.idle_backoff = std::chrono::microseconds(config["udp_data_transport:busy_poll_backoff_us"]);
+        busy_poll = true;
+        LOG_DEBUG("udp data receiver busy polling for {:d} us, spinning for {:d} us before backing off",
+                  config["udp_data_transport:busy_poll_us"], config["udp_data_transport:busy_poll_spin_us"]);
+    }
+
+    if (config["udp_data_transport:timestamping"] != 0) {
+        if (set_socket_timestamping(receiver_socket) != 0) {
+            LOG_WARN("cannot set time-stamping on udp data receiver socket; packet arrival times will not be available");
+        } else {
+            timestamping = true;
+            LOG_DEBUG("udp data receiver using software time-stamps");
+        }
+    }
+
+    if (config["udp_data_transport:gro"] != 0) {
+        if (set_socket_gro(receiver_socket) != 0) {
+            LOG_WARN("cannot set GRO on udp data receiver socket (needs Linux 5.0); receiving one packet at a time");
+        } else {
+            gro_buffer.resize(gro_buffer_bytes);
+            gro = true;
+            LOG_DEBUG("udp data receiver using GRO with a {:d} byte receive buffer", gro_buffer_bytes);
+        }
+    }
+
     LOG_DEBUG("using transmit data buffer of {:d} packets", config["udp_data_transport:tx_data_queue_packets"]);
     tx_data_queue = std::make_unique<vxsdr_queue<data_queue_element>>(config["udp_data_transport:tx_data_queue_packets"]);
 
+    const size_t rx_queue_bytes         = rx_data_queue_bytes(config["udp_data_transport:rx_data_queue_packets"]);
+    // a nonzero initial size makes the queues start small and grow as needed
+    const size_t rx_queue_initial_bytes = rx_data_queue_bytes(config["udp_data_transport:rx_data_queue_initial_packets"]);
+    const auto rx_queue_memory          = rx_data_queue_memory_options(config, "udp_data_transport");
     for (unsigned i = 0; i < num_rx_subdevs; i++) {
-        rx_data_queue.push_back(
-            std::make_unique<vxsdr_queue<data_queue_element>>(config["udp_data_transport:rx_data_queue_packets"]));
+        rx_data_queue.push_back(std::make_unique<packet_ring>(rx_queue_bytes, rx_queue_memory, rx_queue_initial_bytes));
         rx_sample_queue.push_back(
             std::make_unique<vxsdr_queue<vxsdr::wire_sample>>(MAX_DATA_LENGTH_SAMPLES));
     }
 
-    LOG_DEBUG("using {:d} receive data buffers of {:d} packets", num_rx_subdevs, config["udp_data_transport:rx_data_queue_packets"]);
+    LOG_DEBUG("using {:d} receive data buffers of {:d} packets ({:d} bytes)", num_rx_subdevs,
+              config["udp_data_transport:rx_data_queue_packets"], rx_queue_bytes);
     LOG_DEBUG("using {:d} receive sample buffers of {:d} samples", num_rx_subdevs, MAX_DATA_LENGTH_SAMPLES);
 
+    if (config["queue_statistics"] != 0) {
+        LOG_DEBUG("enabling queue statistics");
+        enable_queue_statistics();
+    }
+
     rx_state        = TRANSPORT_STARTING;
     receiver_thread = vxsdr_thread([this] { data_receive(); });
 
@@ -305,9 +371,45 @@ size_t udp_data_transport::packet_receive(data_queue_element& packet, int& error
     net::socket_base::message_flags flags = 0;
     net_error_code::error_code err;
     packet.hdr = { 0, 0, 0, 0, 0, 0, 0 };
+    if (gro) {
+        return packet_receive_coalesced(packet, error_code);
+    }
+    if (busy_poll) {
+        return receive_polling(receiver_socket, &packet, sizeof(packet), receiver_thread_stop_flag, poll_options, error_code,
+                               timestamping ? &rx_arrival_time : nullptr);
+    }
+    if (timestamping) {
+        return receive_timestamped(receiver_socket, &packet, sizeof(packet), rx_arrival_time, error_code);
+    }
     size_t bytes = receiver_socket.receive(net::buffer(&packet, sizeof(packet)), flags, err);
     error_code = err.value();
     return bytes;
 }
 
+// returns the next packet from a coalesced receive, receiving again when all have been returned; a
+// segment which is not a whole packet is returned as is, so data_receive() finds the size error
+size_t udp_data_transport::packet_receive_coalesced(data_queue_element& packet, int& error_code) {
+    if (gro_offset >= gro_bytes) {
+        gro_offset = 0;
+        if (busy_poll) {
+            gro_bytes = receive_polling(receiver_socket, gro_buffer.data(), gro_buffer.size(), receiver_thread_stop_flag,
+                                        poll_options, error_code, &gro_arrival_time, &gro_segment_bytes);
+        } else {
+            gro_bytes = receive_coalesced(receiver_socket, gro_buffer.data(), gro_buffer.size(), gro_segment_bytes,
+                                          gro_arrival_time, error_code);
+        }
+        if (gro_bytes == 0 or gro_segment_bytes == 0) {
+            gro_bytes = 0;
+            return 0;
+        }
+    }
+    const size_t bytes = std::min(gro_segment_bytes, gro_bytes - gro_offset);
+    std::memcpy((void*)&packet, &gro_buffer[gro_offset], std::min(bytes, sizeof(packet)));
+    gro_offset += bytes;
+    // the coalesced packets share the time-stamp of the first
+    rx_arrival_time = gro_arrival_time;
+    error_code = 0;
+    return bytes;
+}
+
 #endif // #ifdef VXSDR_ENABLE_UDP
\ No newline at end of file
@@ -0,0 +1,282 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifdef VXSDR_ENABLE_IO_URING
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <stdexcept>
+#include <vector>
+
+#include "logging.hpp"
+#include "vxsdr_packets.hpp"
+#include "vxsdr_queues.hpp"
+#include "vxsdr_net.hpp"
+#include "vxsdr_threads.hpp"
+#include "vxsdr_transport.hpp"
+#include "uring_socket.hpp"
+
+/*! @file uring_data_transport.cpp
+    @brief Constructor, destructor, and utility functions for the @p uring_data_transport class.
+*/
+
+uring_data_transport::uring_data_transport(const std::map<std::string, int64_t>& settings,
+                                           const unsigned granularity,
+                                           const unsigned n_subdevs,
+                                           const unsigned max_samps_per_packet)
+        : data_transport(granularity, n_subdevs, max_samps_per_packet),
+          sender_socket(context, net::ip::udp::v4()),
+          receiver_socket(context, net::ip::udp::v4()) {
+    LOG_DEBUG("io_uring data transport constructor entered");
+
+    auto config = apply_transport_settings(settings, get_default_settings());
+
+    // the addresses are the same as for the udp transports
+    for (const std::string address : {"local_address", "device_address"}) {
+        if (config.count("uring_data_transport:" + address) == 0) {
+            if (config.count("udp_data_transport:" + address) != 0) {
+                config["uring_data_transport:" + address] = config["udp_data_transport:" + address];
+            } else if (config.count("udp_transport:" + address) != 0) {
+                config["uring_data_transport:" + address] = config["udp_transport:" + address];
+            }
+        }
+    }
+
+    if (config.count("uring_data_transport:local_address") == 0 or config.count("uring_data_transport:device_address") == 0) {
+        LOG_ERROR("io_uring data transport settings must include udp_transport:local_address and udp_transport:device_address");
+        throw std::invalid_argument("io_uring data transport settings must include local address and device address");
+    }
+
+    net::ip::address_v4 local_ip  = net::ip::address_v4(config["uring_data_transport:local_address"]);
+    net::ip::address_v4 device_ip = net::ip::address_v4(config["uring_data_transport:device_address"]);
+
+    net_error_code::error_code err;
+
+    LOG_DEBUG("binding io_uring data sender socket to address {:s} port {:d}", local_ip.to_string(), udp_host_data_send_port);
+    sender_socket.bind(net::ip::udp::endpoint(local_ip, udp_host_data_send_port), err);
+    if (err) {
+        LOG_ERROR("error binding io_uring data sender socket on local address {:s}; check that network interface is up ({:s})",
+                  local_ip.to_string(), err.message());
+        throw std::runtime_error("error binding io_uring data sender socket on local address " + local_ip.to_string() +
+                                 "; check that network interface is up");
+    }
+
+    LOG_DEBUG("binding io_uring data receiver socket to address {:s} port {:d}", local_ip.to_string(), udp_host_data_receive_port);
+    receiver_socket.bind(net::ip::udp::endpoint(local_ip, udp_host_data_receive_port), err);
+    if (err) {
+        LOG_ERROR("error binding io_uring data receiver socket on local address {:s}; check that network interface is up ({:s})",
+                  local_ip.to_string(), err.message());
+        throw std::runtime_error("error binding io_uring data receiver socket on local address " + local_ip.to_string() +
+                                 "; check that network interface is up");
+    }
+
+    LOG_DEBUG("connecting io_uring data sender socket to address {:s} port {:d}", device_ip.to_string(), udp_device_data_receive_port);
+    sender_socket.connect(net::ip::udp::endpoint(device_ip, udp_device_data_receive_port), err);
+    if (err) {
+        LOG_ERROR("error connecting io_uring data sender socket to device address {:s} ({:s})", device_ip.to_string(), err.message());
+        throw std::runtime_error("error connecting io_uring data sender socket to device address " + device_ip.to_string());
+    }
+
+    if (set_socket_dontfrag(sender_socket)) {
+        LOG_ERROR("error setting do-not-fragment flag for io_uring data sender socket");
+        throw std::runtime_error("error setting do-not-fragment flag for io_uring data sender socket");
+    }
+
+    LOG_DEBUG("connecting io_uring data receiver socket to address {:s} port {:d}", device_ip.to_string(), udp_device_data_send_port);
+    receiver_socket.connect(net::ip::udp::endpoint(device_ip, udp_device_data_send_port), err);
+    if (err) {
+        LOG_ERROR("error connecting io_uring data receiver socket to device address {:s} ({:s})", device_ip.to_string(), err.message());
+        throw std::runtime_error("error connecting io_uring data receiver socket to device address " + device_ip.to_string());
+    }
+
+    // the size returned is an estimate, so this check is not a guarantee
+    auto mtu_est = get_socket_mtu(sender_socket);
+    if (mtu_est < 0) {
+        LOG_ERROR("error getting mtu for io_uring data sender socket");
+        throw std::runtime_error("error getting mtu for io_uring data sender socket");
+    } else if (mtu_est > 0) {
+        if (mtu_est < 9000) {
+            LOG_WARN("mtu is less than 9000 on io_uring data sender socket");
+        }
+        constexpr unsigned minimum_ip_udp_header_bytes = 28;
+        unsigned socket_max_samples = (mtu_est - sizeof(packet_header) - sizeof(stream_spec_t) - sizeof(time_spec_t) - minimum_ip_udp_header_bytes) / sizeof(vxsdr::wire_sample);
+        if (socket_max_samples < max_samples_per_packet) {
+            max_samples_per_packet = sample_granularity * (socket_max_samples / sample_granularity);
+            LOG_INFO("reducing max_samples_per_packet to {:d} on io_uring data sender socket (mtu = {:d})", max_samples_per_packet, mtu_est);
+        }
+    }
+
+    size_t network_send_buffer_bytes    = config["uring_data_transport:network_send_buffer_bytes"];
+    size_t network_receive_buffer_bytes = config["uring_data_transport:network_receive_buffer_bytes"];
+
+    sender_socket.set_option(net::socket_base::send_buffer_size((int)network_send_buffer_bytes), err);
+    if (err) {
+        LOG_ERROR("cannot set network send buffer size to {:d} ({:s})", network_send_buffer_bytes, err.message());
+    }
+    receiver_socket.set_option(net::socket_base::receive_buffer_size((int)network_receive_buffer_bytes), err);
+    if (err) {
+        LOG_ERROR("cannot set network receive buffer size to {:d} ({:s})", network_receive_buffer_bytes, err.message());
+    }
+
+    uring_receiver_options receiver_options;
+    receiver_options.buffer_count = (uint32_t)config["uring_data_transport:receive_buffer_count"];
+    receiver_options.buffer_bytes = (uint32_t)config["uring_data_transport:receive_buffer_bytes"];
+    // the receive buffers are placed like the rx data queues they feed
+    receiver_options.memory       = rx_data_queue_memory_options(config, "uring_data_transport");
+    receiver_ring = std::make_unique<uring_receiver>(receiver_socket.native_handle(), receiver_options);
+    sender_ring   = std::make_unique<uring_sender>(sender_socket.native_handle(),
+                                                   (uint32_t)config["uring_data_transport:send_batch_packets"]);
+
+    // packets must fit in one receive buffer
+    unsigned buffer_max_samples = (receiver_ring->max_packet_bytes() - sizeof(packet_header) - sizeof(stream_spec_t) - sizeof(time_spec_t))
+                                  / sizeof(vxsdr::wire_sample);
+    if (buffer_max_samples < max_samples_per_packet) {
+        max_samples_per_packet = sample_granularity * (buffer_max_samples / sample_granularity);
+        LOG_INFO("reducing max_samples_per_packet to {:d} to fit io_uring receive buffers of {:d} bytes", max_samples_per_packet,
+                 receiver_options.buffer_bytes);
+    }
+
+    LOG_DEBUG("using transmit data buffer of {:d} packets", config["uring_data_transport:tx_data_queue_packets"]);
+    tx_data_queue = std::make_unique<vxsdr_queue<data_queue_element>>(config["uring_data_transport:tx_data_queue_packets"]);
+
+    const size_t rx_queue_bytes         = rx_data_queue_bytes(config["uring_data_transport:rx_data_queue_packets"]);
+    // a nonzero initial size makes the queues start small and grow as needed
+    const size_t rx_queue_initial_bytes = rx_data_queue_bytes(config["uring_data_transport:rx_data_queue_initial_packets"]);
+    const auto rx_queue_memory          = rx_data_queue_memory_options(config, "uring_data_transport");
+    for (unsigned i = 0; i < num_rx_subdevs; i++) {
+        rx_data_queue.push_back(std::make_unique<packet_ring>(rx_queue_bytes, rx_queue_memory, rx_queue_initial_bytes));
+        rx_sample_queue.push_back(
+            std::make_unique<vxsdr_queue<vxsdr::wire_sample>>(MAX_DATA_LENGTH_SAMPLES));
+    }
+
+    LOG_DEBUG("using {:d} receive data buffers of {:d} packets ({:d} bytes)", num_rx_subdevs,
+              config["uring_data_transport:rx_data_queue_packets"], rx_queue_bytes);
+
+    if (config["queue_statistics"] != 0) {
+        LOG_DEBUG("enabling queue statistics");
+        enable_queue_statistics();
+    }
+
+    rx_state        = TRANSPORT_STARTING;
+    receiver_thread = vxsdr_thread([this] { data_receive(); });
+
+    if (config["uring_data_transport:thread_affinity_offset"] >= 0 and config["uring_data_transport:receiver_thread_affinity"] >= 0) {
+        auto desired_affinity =
+            config["uring_data_transport:thread_affinity_offset"] + config["uring_data_transport:receiver_thread_affinity"];
+        if (set_thread_affinity(receiver_thread, desired_affinity) != 0) {
+            LOG_ERROR("unable to set io_uring data receiver thread affinity in io_uring data transport constructor");
+            throw std::runtime_error("unable to set io_uring data receiver thread affinity in io_uring data transport constructor");
+        }
+        LOG_DEBUG("io_uring data receiver thread affinity set to cpu {:d}", desired_affinity);
+    }
+    if (config["uring_data_transport:thread_priority"] >= 0) {
+        if (set_thread_priority_realtime(receiver_thread, (int)config["uring_data_transport:thread_priority"]) != 0) {
+            LOG_ERROR("unable to set io_uring data receiver thread realtime priority in io_uring data transport constructor");
+            throw std::runtime_error("unable to set io_uring data receiver thread realtime priority in io_uring data transport constructor");
+        }
+        LOG_DEBUG("io_uring data receiver thread priority set to {:d}", config["uring_data_transport:thread_priority"]);
+    }
+
+    tx_state      = TRANSPORT_STARTING;
+    sender_thread = vxsdr_thread([this] { data_send(); });
+
+    if (config["uring_data_transport:thread_affinity_offset"] >= 0 and config["uring_data_transport:sender_thread_affinity"] >= 0) {
+        auto desired_affinity =
+            config["uring_data_transport:thread_affinity_offset"] + config["uring_data_transport:sender_thread_affinity"];
+        if (set_thread_affinity(sender_thread, desired_affinity) != 0) {
+            LOG_ERROR("unable to set io_uring data sender thread affinity in io_uring data transport constructor");
+            throw std::runtime_error("unable to set io_uring data sender thread affinity in io_uring data transport constructor");
+        }
+        LOG_DEBUG("io_uring data sender thread affinity set to cpu {:d}", desired_affinity);
+    }
+    if (config["uring_data_transport:thread_priority"] >= 0) {
+        if (set_thread_priority_realtime(sender_thread, (int)config["uring_data_transport:thread_priority"]) != 0) {
+            LOG_ERROR("unable to set io_uring data sender thread realtime priority in io_uring data transport constructor");
+            throw std::runtime_error("unable to set io_uring data sender thread realtime priority in io_uring data transport constructor");
+        }
+        LOG_DEBUG("io_uring data sender thread priority set to {:d}", config["uring_data_transport:thread_priority"]);
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    while (tx_state != TRANSPORT_READY or rx_state != TRANSPORT_READY) {
+        std::this_thread::sleep_for(uring_ready_wait);
+        if ((std::chrono::steady_clock::now() - start_time) > uring_ready_timeout) {
+            LOG_ERROR("timeout waiting for transport ready in io_uring data transport constructor");
+            throw std::runtime_error("timeout waiting for transport ready in io_uring data transport constructor");
+        }
+    }
+
+    LOG_DEBUG("io_uring data transport constructor complete");
+}
+
+uring_data_transport::~uring_data_transport() noexcept {
+    LOG_DEBUG("io_uring data transport destructor entered");
+    // tx must shut down before rx since tx sends a final ack request to update stats
+    LOG_DEBUG("joining io_uring data sender thread");
+    tx_state = TRANSPORT_SHUTDOWN;
+    sender_thread_stop_flag = true;
+    if (sender_thread.joinable()) {
+        sender_thread.join();
+    }
+    // receives time out regularly, so the receiver thread sees the stop flag
+    LOG_DEBUG("joining io_uring data receiver thread");
+    rx_state = TRANSPORT_SHUTDOWN;
+    receiver_thread_stop_flag = true;
+    if (receiver_thread.joinable()) {
+        receiver_thread.join();
+    }
+    // the rings must be closed before the sockets they use
+    receiver_ring.reset();
+    sender_ring.reset();
+    net_error_code::error_code err;
+    receiver_socket.close(err);
+    if (err) {
+        LOG_ERROR("io_uring data receiver socket close: {:s}", err.message());
+    }
+    sender_socket.close(err);
+    if (err) {
+        LOG_ERROR("io_uring data sender socket close: {:s}", err.message());
+    }
+    if (log_stats_on_exit) {
+        log_stats();
+    }
+    LOG_DEBUG("io_uring data transport destructor complete");
+}
+
+size_t uring_data_transport::packet_send(const packet& packet, int& error_code) {
+    // a full batch is flushed here; its failures are reported by the next packet_send_flush()
+    int err = 0;
+    size_t n_failed = sender_ring->queue(&packet, packet.hdr.packet_size, err);
+    if (n_failed > 0) {
+        if (earlier_send_failures == 0) {
+            earlier_send_error = err;
+        }
+        earlier_send_failures += n_failed;
+    }
+    error_code = 0;
+    return packet.hdr.packet_size;
+}
+
+size_t uring_data_transport::packet_send_flush(int& error_code) {
+    size_t n_failed = sender_ring->flush(error_code);
+    if (earlier_send_failures > 0) {
+        error_code = earlier_send_error;
+        n_failed  += earlier_send_failures;
+        earlier_send_failures = 0;
+    }
+    return n_failed;
+}
+
+size_t uring_data_transport::packet_receive(data_queue_element& packet, int& error_code) {
+    packet.hdr = { 0, 0, 0, 0, 0, 0, 0 };
+    return receiver_ring->receive(&packet, sizeof(packet), uring_receive_timeout_ms, error_code);
+}
+
+#endif // #ifdef VXSDR_ENABLE_IO_URING
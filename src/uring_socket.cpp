@@ -0,0 +1,400 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifdef VXSDR_TARGET_LINUX
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+
+#include "logging.hpp"
+#include "uring_socket.hpp"
+
+/*! @file uring_socket.cpp
+    @brief Setup, teardown, receive and send functions for the @p uring_receiver and @p uring_sender classes.
+*/
+
+namespace {
+
+// user_data values for the receiver's requests
+constexpr uint64_t receive_tag = 1;
+constexpr uint64_t cancel_tag  = 2;
+// the provided buffer group used by the receiver
+constexpr uint16_t buffer_group = 0;
+// how long the receiver's destructor waits for its receive to be cancelled
+constexpr int cancel_wait_ms = 100;
+
+template <typename T> T load_acquire(T* p) { return std::atomic_ref<T>(*p).load(std::memory_order_acquire); }
+template <typename T> void store_release(T* p, const T value) { std::atomic_ref<T>(*p).store(value, std::memory_order_release); }
+
+template <typename T> T* at_offset(void* base, const uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(base) + offset);
+}
+
+}  // namespace
+
+uring_ring::uring_ring(const uint32_t sq_entries, const uint32_t cq_entries) {
+    io_uring_params params{};
+    params.flags      = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = cq_entries;
+    ring_fd = (int)syscall(SYS_io_uring_setup, sq_entries, &params);
+    if (ring_fd < 0 and errno == EINVAL) {
+        // cooperative task running needs Linux 5.19
+        params       = {};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = cq_entries;
+        ring_fd = (int)syscall(SYS_io_uring_setup, sq_entries, &params);
+    }
+    if (ring_fd < 0) {
+        LOG_ERROR("cannot create io_uring with {:d} entries ({:s})", sq_entries, std::strerror(errno));
+        throw std::runtime_error("cannot create io_uring");
+    }
+    if ((params.features & IORING_FEAT_EXT_ARG) == 0 or (params.features & IORING_FEAT_NODROP) == 0) {
+        close_all();
+        LOG_ERROR("io_uring on this system lacks required features; Linux 6.0 or later is required");
+        throw std::runtime_error("io_uring on this system lacks required features");
+    }
+
+    sq_map_bytes = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_map_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        sq_map_bytes = cq_map_bytes = std::max(sq_map_bytes, cq_map_bytes);
+    }
+    sq_map = mmap(nullptr, sq_map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_map == MAP_FAILED) {
+        sq_map = nullptr;
+    } else if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        cq_map = sq_map;
+    } else {
+        cq_map = mmap(nullptr, cq_map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_map == MAP_FAILED) {
+            cq_map = nullptr;
+        }
+    }
+    sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        sqes = nullptr;
+    }
+    if (sq_map == nullptr or cq_map == nullptr or sqes == nullptr) {
+        LOG_ERROR("cannot map io_uring ({:s})", std::strerror(errno));
+        close_all();
+        throw std::runtime_error("cannot map io_uring");
+    }
+
+    sq_head  = at_offset<uint32_t>(sq_map, params.sq_off.head);
+    sq_tail  = at_offset<uint32_t>(sq_map, params.sq_off.tail);
+    sq_array = at_offset<uint32_t>(sq_map, params.sq_off.array);
+    sq_mask  = *at_offset<uint32_t>(sq_map, params.sq_off.ring_mask);
+    sq_size  = params.sq_entries;
+    cq_head  = at_offset<uint32_t>(cq_map, params.cq_off.head);
+    cq_tail  = at_offset<uint32_t>(cq_map, params.cq_off.tail);
+    cqes     = at_offset<io_uring_cqe>(cq_map, params.cq_off.cqes);
+    cq_mask  = *at_offset<uint32_t>(cq_map, params.cq_off.ring_mask);
+
+    sq_local_tail = *sq_tail;
+    cq_local_head = *cq_head;
+}
+
+uring_ring::~uring_ring() noexcept {
+    close_all();
+}
+
+void uring_ring::close_all() noexcept {
+    if (sqes != nullptr) {
+        munmap(sqes, sqes_bytes);
+        sqes = nullptr;
+    }
+    if (cq_map != nullptr and cq_map != sq_map) {
+        munmap(cq_map, cq_map_bytes);
+    }
+    cq_map = nullptr;
+    if (sq_map != nullptr) {
+        munmap(sq_map, sq_map_bytes);
+        sq_map = nullptr;
+    }
+    if (ring_fd >= 0) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+void* uring_ring::next_sqe() noexcept {
+    if (sq_local_tail - load_acquire(sq_head) >= sq_size) {
+        return nullptr;
+    }
+    const uint32_t index = sq_local_tail & sq_mask;
+    sq_array[index] = index;
+    auto* sqe = static_cast<io_uring_sqe*>(sqes) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_local_tail++;
+    sq_pending++;
+    return sqe;
+}
+
+int uring_ring::submit_and_wait(const uint32_t min_complete, const int timeout_ms) noexcept {
+    store_release(sq_tail, sq_local_tail);
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    void* argp      = nullptr;
+    size_t arg_size = 0;
+    if (min_complete > 0 and timeout_ms >= 0) {
+        ts.tv_sec      = timeout_ms / 1000;
+        ts.tv_nsec     = (long long)(timeout_ms % 1000) * 1'000'000;
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts         = (uint64_t)&ts;
+        argp           = &arg;
+        arg_size       = sizeof(arg);
+        flags         |= IORING_ENTER_EXT_ARG;
+    }
+    long res = syscall(SYS_io_uring_enter, ring_fd, sq_pending, min_complete, flags, argp, arg_size);
+    if (res < 0) {
+        // a timeout or signal just means fewer completions are ready than asked for
+        return (errno == ETIME or errno == EINTR) ? 0 : errno;
+    }
+    sq_pending -= std::min(sq_pending, (uint32_t)res);
+    return 0;
+}
+
+uint32_t uring_ring::withdraw_unsubmitted() noexcept {
+    // without SQPOLL the kernel reads entries only during io_uring_enter, so the entries past
+    // the kernel's head can safely be taken back here
+    const uint32_t head      = load_acquire(sq_head);
+    const uint32_t withdrawn = sq_local_tail - head;
+    sq_local_tail            = head;
+    store_release(sq_tail, sq_local_tail);
+    sq_pending = 0;
+    return withdrawn;
+}
+
+const void* uring_ring::peek_cqe() const noexcept {
+    if (cq_local_head == load_acquire(cq_tail)) {
+        return nullptr;
+    }
+    return static_cast<const io_uring_cqe*>(cqes) + (cq_local_head & cq_mask);
+}
+
+void uring_ring::consume_cqe() noexcept {
+    cq_local_head++;
+    store_release(cq_head, cq_local_head);
+}
+
+uring_receiver::uring_receiver(const int socket_fd, const uring_receiver_options& options)
+        : uring_ring(8, 2 * options.buffer_count),
+          fd(socket_fd),
+          buffer_count(options.buffer_count),
+          buffer_bytes(options.buffer_bytes) {
+    if (not std::has_single_bit(buffer_count) or buffer_count > 32'768 or buffer_bytes == 0) {
+        LOG_ERROR("io_uring receive buffer count ({:d}) must be a power of 2 no larger than 32768", buffer_count);
+        throw std::invalid_argument("io_uring receive buffer count must be a power of 2 no larger than 32768");
+    }
+    buffers = std::make_unique<queue_memory>((size_t)buffer_count * buffer_bytes, options.memory);
+
+    buffer_ring_bytes = buffer_count * sizeof(io_uring_buf);
+    buffer_ring = mmap(nullptr, buffer_ring_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (buffer_ring == MAP_FAILED) {
+        buffer_ring = nullptr;
+        LOG_ERROR("cannot allocate io_uring buffer ring ({:s})", std::strerror(errno));
+        throw std::runtime_error("cannot allocate io_uring buffer ring");
+    }
+    io_uring_buf_reg reg{};
+    reg.ring_addr    = (uint64_t)buffer_ring;
+    reg.ring_entries = buffer_count;
+    reg.bgid         = buffer_group;
+    if (syscall(SYS_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        LOG_ERROR("cannot register io_uring buffer ring ({:s}); Linux 6.0 or later is required", std::strerror(errno));
+        munmap(buffer_ring, buffer_ring_bytes);
+        buffer_ring = nullptr;
+        throw std::runtime_error("cannot register io_uring buffer ring");
+    }
+    for (uint32_t i = 0; i < buffer_count; i++) {
+        release_buffer((uint16_t)i);
+    }
+
+    // start receiving at once, so packets arriving before the first receive() are not lost
+    arm();
+    int err = submit_and_wait(0);
+    if (err != 0) {
+        LOG_ERROR("cannot start io_uring receive ({:s})", std::strerror(err));
+        munmap(buffer_ring, buffer_ring_bytes);
+        buffer_ring = nullptr;
+        throw std::runtime_error("cannot start io_uring receive");
+    }
+}
+
+uring_receiver::~uring_receiver() noexcept {
+    // the kernel may write to the buffers until the receive is cancelled
+    if (armed and ring_fd >= 0) {
+        auto* sqe = static_cast<io_uring_sqe*>(next_sqe());
+        if (sqe != nullptr) {
+            sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+            sqe->addr      = receive_tag;
+            sqe->user_data = cancel_tag;
+        }
+        for (int i = 0; armed and i < 2; i++) {
+            submit_and_wait(1, cancel_wait_ms);
+            while (const auto* cqe = static_cast<const io_uring_cqe*>(peek_cqe())) {
+                if (cqe->user_data == receive_tag and (cqe->flags & IORING_CQE_F_MORE) == 0) {
+                    armed = false;
+                }
+                consume_cqe();
+            }
+        }
+    }
+    if (buffer_ring != nullptr) {
+        io_uring_buf_reg reg{};
+        reg.bgid = buffer_group;
+        syscall(SYS_io_uring_register, ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        munmap(buffer_ring, buffer_ring_bytes);
+        buffer_ring = nullptr;
+    }
+}
+
+void uring_receiver::arm() noexcept {
+    auto* sqe = static_cast<io_uring_sqe*>(next_sqe());
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = fd;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffer_group;
+    sqe->user_data = receive_tag;
+    armed = true;
+}
+
+void uring_receiver::release_buffer(const uint16_t id) noexcept {
+    auto* ring = static_cast<io_uring_buf*>(buffer_ring);
+    io_uring_buf& entry = ring[buffer_ring_tail & (buffer_count - 1)];
+    entry.addr = (uint64_t)(buffers->data() + (size_t)id * buffer_bytes);
+    entry.len  = buffer_bytes;
+    entry.bid  = id;
+    buffer_ring_tail++;
+    // the ring tail overlays the last field of the first entry
+    store_release(&ring[0].resv, buffer_ring_tail);
+}
+
+size_t uring_receiver::receive(void* dest, const size_t max_bytes, const int timeout_ms, int& error_code) {
+    error_code = 0;
+    while (true) {
+        const auto* cqe = static_cast<const io_uring_cqe*>(peek_cqe());
+        if (cqe == nullptr) {
+            // the multishot receive stops if it runs out of buffers or fails; restart it here, so
+            // the stop costs no extra system call
+            if (not armed) {
+                arm();
+            }
+            int err = submit_and_wait(1, timeout_ms);
+            if (err != 0) {
+                error_code = err;
+                return 0;
+            }
+            cqe = static_cast<const io_uring_cqe*>(peek_cqe());
+            if (cqe == nullptr) {
+                return 0;
+            }
+        }
+        const int32_t res    = cqe->res;
+        const uint32_t flags = cqe->flags;
+        const uint64_t tag   = cqe->user_data;
+        consume_cqe();
+        if (tag != receive_tag) {
+            continue;
+        }
+        if ((flags & IORING_CQE_F_MORE) == 0) {
+            armed = false;
+        }
+        if ((flags & IORING_CQE_F_BUFFER) != 0) {
+            const auto id = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+            size_t n = 0;
+            if (res > 0) {
+                n = std::min((size_t)res, max_bytes);
+                std::memcpy(dest, buffers->data() + (size_t)id * buffer_bytes, n);
+            }
+            release_buffer(id);
+            return n;
+        }
+        // running out of buffers is not an error: the packets wait in the socket buffer until the
+        // receive is restarted
+        if (res < 0 and res != -ENOBUFS) {
+            error_code = -res;
+            return 0;
+        }
+    }
+}
+
+uring_sender::uring_sender(const int socket_fd, const uint32_t batch)
+        : uring_ring(batch, 2 * batch), fd(socket_fd), batch_size(batch) {}
+
+size_t uring_sender::queue(const void* data, const size_t n_bytes, int& error_code) {
+    error_code      = 0;
+    size_t failures = 0;
+    if (sq_pending >= batch_size) {
+        failures = flush(error_code);
+    }
+    auto* sqe = static_cast<io_uring_sqe*>(next_sqe());
+    if (sqe == nullptr) {
+        int err = 0;
+        failures += flush(err);
+        error_code = error_code != 0 ? error_code : err;
+        sqe = static_cast<io_uring_sqe*>(next_sqe());
+        if (sqe == nullptr) {
+            error_code = error_code != 0 ? error_code : ENOBUFS;
+            return failures + 1;
+        }
+    }
+    sqe->opcode    = IORING_OP_SEND;
+    sqe->fd        = fd;
+    sqe->addr      = (uint64_t)data;
+    sqe->len       = (uint32_t)n_bytes;
+    sqe->user_data = n_bytes;
+    return failures;
+}
+
+size_t uring_sender::flush(int& error_code) {
+    error_code         = 0;
+    size_t failures    = 0;
+    uint32_t in_flight = sq_pending;
+    while (in_flight > 0) {
+        int err = submit_and_wait(in_flight);
+        if (err != 0) {
+            // the caller reuses the packet memory as soon as this returns, so sends the kernel has
+            // not taken are withdrawn and counted as failed; those it has taken are waited for
+            const uint32_t withdrawn = withdraw_unsubmitted();
+            if (withdrawn > 0 and failures == 0) {
+                error_code = err;
+            }
+            failures  += withdrawn;
+            in_flight -= std::min(in_flight, withdrawn);
+        }
+        while (const auto* cqe = static_cast<const io_uring_cqe*>(peek_cqe())) {
+            if (cqe->res < 0 or (uint64_t)cqe->res != cqe->user_data) {
+                if (failures++ == 0) {
+                    error_code = cqe->res < 0 ? -cqe->res : EMSGSIZE;
+                }
+            }
+            consume_cqe();
+            in_flight -= (in_flight > 0 ? 1 : 0);
+        }
+    }
+    return failures;
+}
+
+#endif  // VXSDR_TARGET_LINUX
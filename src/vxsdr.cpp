@@ -28,22 +28,33 @@ std::vector<std::string> vxsdr::get_library_details() {
 
 size_t vxsdr::get_rx_data(std::vector<std::complex<int16_t>>& data, const size_t n_requested, const uint8_t subdev,
     const double timeout_s) {
-    return p_imp->get_rx_data<int16_t>(data, n_requested, subdev, timeout_s);
+    return p_imp->get_rx_data(data, n_requested, subdev, timeout_s);
 }
 
 size_t vxsdr::get_rx_data(std::vector<std::complex<float>>& data, const size_t n_requested, const uint8_t subdev,
     const double timeout_s) {
-    return p_imp->get_rx_data<float>(data, n_requested, subdev, timeout_s);
+    return p_imp->get_rx_data(data, n_requested, subdev, timeout_s);
 }
 
 size_t vxsdr::put_tx_data(const std::vector<std::complex<int16_t>> &data, const size_t n_requested, const uint8_t subdev, const double timeout_s) {
-    return p_imp->put_tx_data<int16_t>(data, n_requested, subdev, timeout_s);
+    return p_imp->put_tx_data(data, n_requested, subdev, timeout_s);
 }
 
 size_t vxsdr::put_tx_data(const std::vector<std::complex<float>> &data, const size_t n_requested, const uint8_t subdev, const double timeout_s) {
-    return p_imp->put_tx_data<float>(data, n_requested, subdev, timeout_s);
+    return p_imp->put_tx_data(data, n_requested, subdev, timeout_s);
 }
 
+#ifdef VXSDR_HAS_FLOAT16
+size_t vxsdr::get_rx_data(std::vector<vxsdr::complex_float16>& data, const size_t n_requested, const uint8_t subdev,
+    const double timeout_s) {
+    return p_imp->get_rx_data(data, n_requested, subdev, timeout_s);
+}
+
+size_t vxsdr::put_tx_data(const std::vector<vxsdr::complex_float16> &data, const size_t n_requested, const uint8_t subdev, const double timeout_s) {
+    return p_imp->put_tx_data(data, n_requested, subdev, timeout_s);
+}
+#endif
+
 bool vxsdr::set_host_command_timeout(const double timeout_s) {
     return p_imp->set_host_command_timeout(timeout_s);
 }
@@ -100,6 +111,30 @@ double vxsdr::get_host_command_timeout() const {
     return p_imp->get_host_command_timeout();
 }
 
+bool vxsdr::begin_transaction() {
+    return p_imp->begin_transaction();
+}
+
+std::vector<bool> vxsdr::end_transaction() {
+    return p_imp->end_transaction();
+}
+
+void vxsdr::clear_property_cache() {
+    p_imp->clear_property_cache();
+}
+
+bool vxsdr::refresh_property_cache() {
+    return p_imp->refresh_property_cache();
+}
+
+std::map<std::string, int64_t> vxsdr::get_queue_statistics() const {
+    return p_imp->get_queue_statistics();
+}
+
+std::optional<std::pair<vxsdr::time_point, double>> vxsdr::get_rx_packet_timing(const uint8_t subdev) const {
+    return p_imp->get_rx_packet_timing(subdev);
+}
+
 std::vector<std::string> vxsdr::discover_ipv4_addresses(const std::string& local_addr,
                                                                const std::string& broadcast_addr,
                                                                const double timeout_s) {
@@ -3,6 +3,8 @@
 
 #include <cmath>
 #include <compare>
+#include <functional>
+#include <mutex>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
@@ -18,6 +20,7 @@
 #include "vxsdr_packets.hpp"
 #include "vxsdr_transport.hpp"
 #include "vxsdr_threads.hpp"
+#include "sample_conversion.hpp"
 #include "vxsdr_imp.hpp"
 
 
@@ -122,6 +125,16 @@ vxsdr::imp::imp(const std::map<std::string, int64_t>& input_config) {
     } else if (pcie_transport_enabled and config["data_transport"] == vxsdr::TRANSPORT_TYPE_PCIE) {
         LOG_DEBUG("making pcie data transport with {:d} receive subdevices", num_rx_subdevs);
         data_tport = std::make_unique<pcie_data_transport>(config, pcie_iface, sample_granularity, num_rx_subdevs, max_samps_per_packet);
+#ifdef VXSDR_ENABLE_XDP
+    } else if (config["data_transport"] == vxsdr::TRANSPORT_TYPE_XDP) {
+        LOG_DEBUG("making xdp data transport with {:d} receive subdevices", num_rx_subdevs);
+        data_tport = std::make_unique<xdp_data_transport>(config, sample_granularity, num_rx_subdevs, max_samps_per_packet);
+#endif
+#ifdef VXSDR_ENABLE_IO_URING
+    } else if (config["data_transport"] == vxsdr::TRANSPORT_TYPE_IO_URING) {
+        LOG_DEBUG("making io_uring data transport with {:d} receive subdevices", num_rx_subdevs);
+        data_tport = std::make_unique<uring_data_transport>(config, sample_granularity, num_rx_subdevs, max_samps_per_packet);
+#endif
     } else {
         LOG_ERROR("the data transport specified is not enabled");
         throw std::runtime_error("the data transport specified is not enabled in vxsdr constructor");
@@ -137,6 +150,29 @@ vxsdr::imp::imp(const std::map<std::string, int64_t>& input_config) {
         }
     }
 
+    // Make the conversion pool if requested
+    if (config["conversion_pool:threads"] > 0) {
+        LOG_DEBUG("making conversion pool with {:d} threads", config["conversion_pool:threads"]);
+        conv_pool = std::make_unique<conversion_pool>((unsigned)config["conversion_pool:threads"],
+                                                      config["conversion_pool:thread_affinity_offset"]);
+        conversion_min_packets = (size_t)std::max<int64_t>(config["conversion_pool:min_packets"], 1);
+    }
+
+    // probe the path to the device for the largest packet it carries, if the transport does so, then discard
+    // the probe packets from the device's buffer, and clear the out-of-sequence count the dropped probes leave
+    unsigned probed_samples_per_packet = data_tport->probe_max_samples_per_packet();
+    if (probed_samples_per_packet > 0) {
+        data_tport->set_max_samples_per_packet(probed_samples_per_packet);
+        if (not vxsdr::imp::clear_data_buffer()) {
+            LOG_ERROR("error clearing data buffer after mtu probing");
+            throw std::runtime_error("error clearing data buffer after mtu probing in vxsdr constructor");
+        }
+        if (not vxsdr::imp::clear_status()) {
+            LOG_ERROR("error clearing status after mtu probing");
+            throw std::runtime_error("error clearing status after mtu probing in vxsdr constructor");
+        }
+    }
+
     // check whether the data transport has reduced the number of samples per packet (e.g. because of mtu) and tell the device
     if (data_tport->get_max_samples_per_packet() < max_samps_per_packet) {
         if (not vxsdr::imp::set_max_payload_bytes(data_tport->get_max_samples_per_packet() * sizeof(vxsdr::wire_sample))) {
@@ -177,6 +213,15 @@ vxsdr::imp::imp(const std::map<std::string, int64_t>& input_config) {
 
 vxsdr::imp::~imp() noexcept {
     LOG_DEBUG("vxsdr destructor entered");
+    {
+        // the shutdown commands below must be sent, not collected
+        std::lock_guard<std::mutex> lock(transaction_mutex);
+        if (transaction_open) {
+            LOG_WARN("discarding {:d} commands of unfinished transaction in vxsdr destructor", transaction_commands.size());
+            transaction_open = false;
+            transaction_commands.clear();
+        }
+    }
     vxsdr::imp::tx_stop();
     vxsdr::imp::rx_stop();
     vxsdr::imp::set_tx_enabled(false);
@@ -193,6 +238,8 @@ vxsdr::imp::~imp() noexcept {
     command_tport.reset();
     LOG_DEBUG("resetting data transport");
     data_tport.reset();
+    LOG_DEBUG("resetting conversion pool");
+    conv_pool.reset();
     LOG_DEBUG("vxsdr destructor complete");
     LOG_SHUTDOWN();
 }
@@ -215,7 +262,56 @@ std::vector<std::string> vxsdr::imp::get_library_details() {
     return ret;
 }
 
-template <typename T> size_t vxsdr::imp::get_rx_data(std::vector<std::complex<T>>& data, size_t n_requested, const uint8_t subdev, const double timeout_s) {
+// Converts the packet in q, then pops and converts further packets until the request is complete;
+// returns RX_LOOP_LAYOUT_CHANGED with the new packet in q if a packet with a different layout is popped
+template <unsigned LayoutFlags, typename S> vxsdr::imp::rx_loop_status vxsdr::imp::receive_packets(data_queue_element& q,
+                                                                                              S* data,
+                                                                                              size_t& n_received,
+                                                                                              const size_t n_requested,
+                                                                                              const uint8_t subdev,
+                                                                                              const vxsdr::duration& timeout) {
+    using view = data_packet_view<LayoutFlags>;
+    const vxsdr::duration data_rx_wait = 100us;
+
+    while (true) {
+        if (q.hdr.packet_size == 0) {
+            LOG_ERROR("zero size packet popped from rx_data_queue (type = 0x{:02x} cmd = 0x{:02x})",
+                        (unsigned)q.hdr.packet_type, (unsigned)q.hdr.command);
+        }
+        auto packet_data = view::template samples<vxsdr::wire_sample>(q);
+        const size_t n_remaining = n_requested - n_received;
+        const size_t n_to_copy = std::min(n_remaining, packet_data.size());
+        convert_from_wire(packet_data.data(), data + n_received, n_to_copy);
+        n_received += n_to_copy;
+
+        // if there are leftover samples, push them to the sample queue
+        if (packet_data.size() > n_remaining) {
+            size_t n_leftover = packet_data.size() - n_remaining;
+            size_t n_pushed = data_tport->rx_sample_queue[subdev]->push(&packet_data[n_remaining], n_leftover);
+            if (n_pushed != n_leftover) {
+                LOG_ERROR("error pushing data to rx sample queue for subdevice {:d} ({:d} of {:d} samples)", subdev, n_pushed, n_leftover);
+                return RX_LOOP_ERROR;
+            }
+        }
+        if (n_received >= n_requested) {
+            return RX_LOOP_DONE;
+        }
+
+        auto start_time = std::chrono::steady_clock::now();
+        while (not data_tport->rx_data_queue[subdev]->pop(q)) {
+            std::this_thread::sleep_for(data_rx_wait);
+            if ((std::chrono::steady_clock::now() - start_time) > timeout) {
+                LOG_ERROR("timeout popping from rx data queue for subdevice {:d} ({:d} of {:d} samples)", subdev, n_received, n_requested);
+                return RX_LOOP_TIMEOUT;
+            }
+        }
+        if ((q.hdr.flags & DATA_PACKET_LAYOUT_MASK) != LayoutFlags) {
+            return RX_LOOP_LAYOUT_CHANGED;
+        }
+    }
+}
+
+template <typename S> size_t vxsdr::imp::get_rx_data(std::vector<S>& data, size_t n_requested, const uint8_t subdev, const double timeout_s) {
     LOG_DEBUG("get_rx_data from subdevice {:d} entered", subdev);
 
     if(subdev >= data_tport->rx_data_queue.size()) {
@@ -267,23 +363,69 @@ template <typename T> size_t vxsdr::imp::get_rx_data(std::vector<std::complex<T>
         size_t n_to_copy = std::min(n_requested, saved_samples);
         std::vector<vxsdr::wire_sample> saved_data(n_to_copy);
         int64_t n_saved = data_tport->rx_sample_queue[subdev]->pop(saved_data.data(), n_to_copy);
-        if constexpr(std::is_same<T, int16_t>()) {
-            for(int64_t i = 0; i < n_saved; i++) {
-                data[n_received + i] = saved_data[i];
-            }
-        } else if constexpr(std::is_floating_point<T>()) {
-            constexpr T scale = 1.0 / 32'768.0;
-            for(int64_t i = 0; i < n_saved; i++) {
-                data[n_received + i] = std::complex<T>(scale * (T)saved_data[i].real(), scale * (T)saved_data[i].imag());
-            }
-        }
+        convert_from_wire(saved_data.data(), &data[n_received], n_saved);
         n_received += n_saved;
     }
 
     // now get samples from new packets
+    const size_t n_packet_max = data_tport->get_max_samples_per_packet();
     while (n_received < n_requested) {
         int64_t n_remaining = (int64_t)n_requested - (int64_t)n_received;
 
+        // large requests are popped in batches and each packet is converted in parallel into its own output range
+        const size_t n_packets_needed = ((size_t)n_remaining + n_packet_max - 1) / n_packet_max;
+        if (conv_pool and n_packets_needed >= conversion_min_packets) {
+            thread_local std::vector<data_queue_element> batch;
+            const size_t n_batch = std::min(n_packets_needed, conversion_batch_packets);
+            if (batch.size() < n_batch) {
+                batch.resize(n_batch);
+            }
+            size_t n_popped = 0;
+            auto start_time = std::chrono::steady_clock::now();
+            while ((n_popped = data_tport->rx_data_queue[subdev]->pop(batch.data(), n_batch)) == 0) {
+                std::this_thread::sleep_for(data_rx_wait);
+                if ((std::chrono::steady_clock::now() - start_time) > data_rx_timeout) {
+                    LOG_ERROR("timeout popping from rx data queue for subdevice {:d} ({:d} of {:d} samples)", subdev, n_received, n_requested);
+                    return n_received;
+                }
+            }
+
+            std::array<std::span<vxsdr::wire_sample>, conversion_batch_packets> packet_data;
+            std::array<size_t, conversion_batch_packets> output_offset{};
+            std::array<size_t, conversion_batch_packets> n_to_copy{};
+            size_t n_batch_samples = 0;
+            for (size_t k = 0; k < n_popped; k++) {
+                if (batch[k].hdr.packet_size == 0) {
+                    LOG_ERROR("zero size packet popped from rx_data_queue (type = 0x{:02x} cmd = 0x{:02x})",
+                                (unsigned)batch[k].hdr.packet_type, (unsigned)batch[k].hdr.command);
+                }
+                packet_data[k]   = vxsdr::imp::get_packet_data_span<vxsdr::wire_sample>(batch[k]);
+                output_offset[k] = n_received + n_batch_samples;
+                n_to_copy[k]     = std::min((size_t)n_remaining - n_batch_samples, packet_data[k].size());
+                n_batch_samples += n_to_copy[k];
+            }
+
+            conv_pool->run(n_popped, [&](size_t k) {
+                convert_from_wire(packet_data[k].data(), &data[output_offset[k]], n_to_copy[k]);
+            });
+            n_received += n_batch_samples;
+
+            // if there are leftover samples, push them to the sample queue in order
+            for (size_t k = 0; k < n_popped; k++) {
+                if (packet_data[k].size() > n_to_copy[k]) {
+                    size_t n_leftover = packet_data[k].size() - n_to_copy[k];
+                    size_t n_pushed = data_tport->rx_sample_queue[subdev]->push(&packet_data[k][n_to_copy[k]], n_leftover);
+                    if (n_pushed != n_leftover) {
+                        LOG_ERROR("error pushing data to rx sample queue for subdevice {:d} ({:d} of {:d} samples)", subdev, n_pushed, n_leftover);
+                        return n_received;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // smaller requests pop one packet, then receive with a loop specialized for its layout until
+        // the request is complete; the layout is constant within a stream, so re-dispatching is rare
         data_queue_element q;
         auto start_time = std::chrono::steady_clock::now();
         while (not data_tport->rx_data_queue[subdev]->pop(q)) {
@@ -294,34 +436,25 @@ template <typename T> size_t vxsdr::imp::get_rx_data(std::vector<std::complex<T>
             }
         }
 
-        if (q.hdr.packet_size == 0) {
-            LOG_ERROR("zero size packet popped from rx_data_queue (type = 0x{:02x} cmd = 0x{:02x})",
-                        (unsigned)q.hdr.packet_type, (unsigned)q.hdr.command);
-        }
-        auto packet_data = vxsdr::imp::get_packet_data_span<vxsdr::wire_sample>(q);
-        int64_t data_samples = packet_data.size();
-
-        if (data_samples > 0) {
-            int64_t n_to_copy = std::min(n_remaining, data_samples);
-            if constexpr(std::is_same<T, int16_t>()) {
-                for(int64_t i = 0; i < n_to_copy; i++) {
-                    data[n_received + i] = packet_data[i];
-                }
-            } else if constexpr(std::is_floating_point<T>()) {
-                constexpr T scale = 1.0 / 32'768.0;
-                for(int64_t i = 0; i < n_to_copy; i++) {
-                    data[n_received + i] = std::complex<T>(scale * (T)packet_data[i].real(), scale * (T)packet_data[i].imag());
-                }
+        auto status = RX_LOOP_LAYOUT_CHANGED;
+        while (status == RX_LOOP_LAYOUT_CHANGED) {
+            switch (q.hdr.flags & DATA_PACKET_LAYOUT_MASK) {
+                case 0:
+                    status = receive_packets<0>(q, data.data(), n_received, n_requested, subdev, data_rx_timeout);
+                    break;
+                case FLAGS_TIME_PRESENT:
+                    status = receive_packets<FLAGS_TIME_PRESENT>(q, data.data(), n_received, n_requested, subdev, data_rx_timeout);
+                    break;
+                case FLAGS_STREAM_ID_PRESENT:
+                    status = receive_packets<FLAGS_STREAM_ID_PRESENT>(q, data.data(), n_received, n_requested, subdev, data_rx_timeout);
+                    break;
+                default:
+                    status = receive_packets<DATA_PACKET_LAYOUT_MASK>(q, data.data(), n_received, n_requested, subdev, data_rx_timeout);
+                    break;
             }
-            n_received += n_to_copy;
         }
-        // if there are leftover samples, push them to the sample queue
-        if (data_samples > n_remaining) {
-            int64_t n_pushed = data_tport->rx_sample_queue[subdev]->push(&packet_data[n_remaining], data_samples - n_remaining);
-            if (n_pushed != data_samples - n_remaining) {
-                LOG_ERROR("error pushing data to rx sample queue for subdevice {:d} ({:d} of {:d} samples)", subdev, n_pushed, data_samples - n_remaining);
-                return n_received;
-            }
+        if (status != RX_LOOP_DONE) {
+            return n_received;
         }
     }
     LOG_DEBUG("get_rx_data complete from subdevice {:d} ({:d} samples)", subdev, n_received);
@@ -331,8 +464,11 @@ template <typename T> size_t vxsdr::imp::get_rx_data(std::vector<std::complex<T>
 // Need to explicitly instantiate template classes for all allowed types so compiler will include code in library
 template size_t vxsdr::imp::get_rx_data(std::vector<std::complex<int16_t>>& data, size_t n_requested, const uint8_t subdev, const double timeout_s);
 template size_t vxsdr::imp::get_rx_data(std::vector<std::complex<float>>& data, size_t n_requested, const uint8_t subdev, const double timeout_s);
+#ifdef VXSDR_HAS_FLOAT16
+template size_t vxsdr::imp::get_rx_data(std::vector<vxsdr::complex_float16>& data, size_t n_requested, const uint8_t subdev, const double timeout_s);
+#endif
 
-template <typename T> size_t vxsdr::imp::put_tx_data(const std::vector<std::complex<T>>& data, size_t n_requested, const uint8_t subdev, const double timeout_s) {
+template <typename S> size_t vxsdr::imp::put_tx_data(const std::vector<S>& data, size_t n_requested, const uint8_t subdev, const double timeout_s) {
     LOG_DEBUG("put_tx_data started");
 
     if (timeout_s <= 0.0) {
@@ -371,52 +507,64 @@ template <typename T> size_t vxsdr::imp::put_tx_data(const std::vector<std::comp
     // puts plain data_packets (no time, no stream)
     size_t n_put = 0;
     size_t n_packet_max = data_tport->get_max_samples_per_packet();
-    for (size_t i = 0; i < n_requested; i += n_packet_max) {
-        data_queue_element q;
+
+    // builds the packet holding samples [i, i + n_packet_max) and returns the number of samples in it
+    auto make_packet = [&](packet& q, const size_t i) {
         auto* p               = std::bit_cast<data_packet*>(&q);
         auto n_samples        = (unsigned)std::min(n_packet_max, n_requested - i);
         unsigned n_data_bytes = n_samples * sizeof(vxsdr::wire_sample);
         auto packet_size      = (uint16_t)(sizeof(packet_header) + n_data_bytes);
         p->hdr                = {PACKET_TYPE_TX_SIGNAL_DATA, 0, 0, subdev, 0, packet_size, 0};
-        if constexpr(std::is_same<T, int16_t>()) {
-            // data is in native format -- just copy
-            std::copy_n(data.begin() + (int64_t)i, (int64_t)n_samples, std::begin(p->data));
-        } else if constexpr(std::is_floating_point<T>()) {
-            // must convert data from float and scale it
-            constexpr T scale = 32'767.0;
-            for(size_t j = 0; j < n_samples; j++) {
-#ifndef VXSDR_LIB_TRUNCATE_FLOAT_CONVERSION
-#if defined(VXSDR_COMPILER_CLANG) || defined(VXSDR_COMPILER_APPLECLANG) || defined(VXSDR_COMPILER_GCC)
-                // for float32 data (the only floating-point data currently supported),
-                // the implementation below is nearly as fast as truncating with clang++ or g++ with -fno-trapping-math,
-                // (which should be set by CMake when gcc is used)
-                // It rounds properly and quickly; however, it is untested with other compilers
-                T re = scale * data[i + j].real();
-                if (re > (T)0.0) {
-                    re += (T)0.5;
-                } else {
-                    re -= (T)0.5;
-                }
-                T im = scale * data[i + j].imag();
-                if (im > (T)0.0) {
-                    im += (T)0.5;
-                } else {
-                    im -= (T)0.5;
+        convert_to_wire(&data[i], p->data, n_samples);
+        return n_samples;
+    };
+
+    // transports which can take packets in the memory they send from get the samples converted straight
+    // into it, without passing through the tx data queue
+    if (data_tport->use_in_place_send()) {
+        for (size_t i = 0; i < n_requested;) {
+            unsigned n_samples = 0;
+            if (not data_tport->send_packet_in_place([&](packet& q) { n_samples = make_packet(q, i); })) {
+                LOG_ERROR("error sending in-place packet in put_tx_data()");
+                return n_put;
+            }
+            n_put += n_samples;
+            i     += n_samples;
+        }
+        LOG_DEBUG("put_tx_data complete ({:d} samples)", n_put);
+        return n_put;
+    }
+
+    for (size_t i = 0; i < n_requested;) {
+        // large requests are converted in parallel in batches of packets, then pushed in order
+        const size_t n_packets_left = (n_requested - i + n_packet_max - 1) / n_packet_max;
+        if (conv_pool and n_packets_left >= conversion_min_packets) {
+            thread_local std::vector<data_queue_element> batch;
+            const size_t n_batch = std::min(n_packets_left, conversion_batch_packets);
+            if (batch.size() < n_batch) {
+                batch.resize(n_batch);
+            }
+            conv_pool->run(n_batch, [&](size_t k) { make_packet(batch[k], i + k * n_packet_max); });
+
+            for (size_t k = 0; k < n_batch; k++) {
+                auto start_time = std::chrono::steady_clock::now();
+                while (not data_tport->tx_data_queue->push(batch[k])) {
+                    std::this_thread::sleep_for(data_tx_wait);
+                    if ((std::chrono::steady_clock::now() - start_time) > data_tx_timeout) {
+                        LOG_ERROR("timeout pushing to tx data queue");
+                        return n_put;
+                    }
                 }
-                p->data[j] = std::complex<int16_t>((int16_t)(re), (int16_t)(im));
-#else // #if defined(VXSDR_COMPILER_CLANG) or defined(VXSDR_COMPILER_GCC)
-                // the implementation below rounds properly using a library routine; it can be several times slower
-                p->data[j] = std::complex<int16_t>((int16_t)std::lroundf(scale * data[i + j].real()),
-                                                (int16_t)std::lroundf(scale * data[i + j].imag()));
-#endif // #if defined(VXSDR_COMPILER_CLANG) or defined(VXSDR_COMPILER_GCC)
-#else // #ifndef VXSDR_LIB_TRUNCATE_FLOAT_CONVERSION
-                // truncate is fast but costs 6 dB in output noise floor
-                p->data[j] = std::complex<int16_t>((int16_t)(scale * data[i + j].real()),
-                                                (int16_t)(scale * data[i + j].imag()));
-#endif // #ifndef VXSDR_LIB_TRUNCATE_FLOAT_CONVERSION
+                auto n_samples = (batch[k].hdr.packet_size - sizeof(packet_header)) / sizeof(vxsdr::wire_sample);
+                n_put += n_samples;
+                i     += n_samples;
             }
+            continue;
         }
 
+        data_queue_element q;
+        auto n_samples = make_packet(q, i);
+
         auto start_time = std::chrono::steady_clock::now();
 
         while (not data_tport->tx_data_queue->push(q)) {
@@ -427,6 +575,7 @@ template <typename T> size_t vxsdr::imp::put_tx_data(const std::vector<std::comp
             }
         }
         n_put += n_samples;
+        i     += n_samples;
     }
     LOG_DEBUG("put_tx_data complete ({:d} samples)", n_put);
     return n_put;
@@ -435,6 +584,9 @@ template <typename T> size_t vxsdr::imp::put_tx_data(const std::vector<std::comp
 // Need to explicitly instantiate template classes for all allowed types so compiler will include code in library!
 template size_t vxsdr::imp::put_tx_data(const std::vector<std::complex<int16_t>>& data, size_t n_requested, const uint8_t subdev, const double timeout_s);
 template size_t vxsdr::imp::put_tx_data(const std::vector<std::complex<float>>& data, size_t n_requested, const uint8_t subdev, const double timeout_s);
+#ifdef VXSDR_HAS_FLOAT16
+template size_t vxsdr::imp::put_tx_data(const std::vector<vxsdr::complex_float16>& data, size_t n_requested, const uint8_t subdev, const double timeout_s);
+#endif
 
 bool vxsdr::imp::set_host_command_timeout(const double timeout_s) {
     if (timeout_s > 3600 or timeout_s < 1e-3) {
@@ -448,62 +600,240 @@ double vxsdr::imp::get_host_command_timeout() const {
     return std::chrono::duration<double>(command_response_timeout).count();
 }
 
-// private functions
-
-[[nodiscard]] bool vxsdr::imp::send_command_and_check_response(packet& p, const std::string& cmd_name) {
-    if (not command_tport->tx_rx_usable()) {
-        LOG_ERROR("send_command_and_check_response failed sending {:s}: command tx and/or rx not usable", cmd_name);
+bool vxsdr::imp::begin_transaction() {
+    std::lock_guard<std::mutex> lock(transaction_mutex);
+    if (transaction_open) {
+        LOG_ERROR("begin_transaction() called with a transaction already open");
         return false;
     }
-    if (not vxsdr::imp::cmd_queue_push_check(p)) {
-        LOG_ERROR("send_command_and_check_response failed sending {:s}: cmd queue push failed", cmd_name);
-        return false;
+    transaction_open  = true;
+    transaction_owner = std::this_thread::get_id();
+    transaction_commands.clear();
+    return true;
+}
+
+std::vector<bool> vxsdr::imp::end_transaction() {
+    std::vector<transaction_command> commands;
+    {
+        std::lock_guard<std::mutex> lock(transaction_mutex);
+        if (not transaction_open) {
+            LOG_ERROR("end_transaction() called with no transaction open");
+            return {};
+        }
+        if (transaction_owner != std::this_thread::get_id()) {
+            LOG_ERROR("end_transaction() called from a thread other than the one which began the transaction");
+            return {};
+        }
+        transaction_open = false;
+        commands.swap(transaction_commands);
+    }
+    std::vector<command_queue_element> packets;
+    std::vector<std::string> names;
+    packets.reserve(commands.size());
+    names.reserve(commands.size());
+    for (const auto& c : commands) {
+        packets.push_back(c.packet);
+        names.push_back(c.name);
     }
+    auto responses = vxsdr::imp::send_commands_and_return_responses(packets, names);
 
-    command_queue_element q;
-    auto start_time = std::chrono::steady_clock::now();
-    while (not command_tport->response_queue.pop(q)) {
-        std::this_thread::sleep_for(command_response_wait);
-        if ((std::chrono::steady_clock::now() - start_time) > command_response_timeout) {
-            LOG_ERROR("timeout waiting for response in {:s}", cmd_name);
-            return false;
+    std::vector<bool> results(commands.size());
+    for (size_t i = 0; i < commands.size(); i++) {
+        results[i] = responses[i].has_value() and (not commands[i].on_success or commands[i].on_success());
+    }
+    LOG_DEBUG("end_transaction() sent {:d} commands ({:d} succeeded)", commands.size(), std::count(results.begin(), results.end(), true));
+    return results;
+}
+
+void vxsdr::imp::clear_property_cache() {
+    std::lock_guard<std::mutex> lock(property_cache_mutex);
+    property_cache.clear();
+}
+
+bool vxsdr::imp::refresh_property_cache() {
+    // the properties already read are read again, with the queries in flight together
+    std::vector<cached_property> entries;
+    {
+        std::lock_guard<std::mutex> lock(property_cache_mutex);
+        entries.reserve(property_cache.size());
+        for (const auto& [key, entry] : property_cache) {
+            entries.push_back(entry);
         }
+        property_cache.clear();
     }
-    if (((p.hdr.packet_type == PACKET_TYPE_DEVICE_CMD and q.hdr.packet_type == PACKET_TYPE_DEVICE_CMD_RSP) or
-            (p.hdr.packet_type == PACKET_TYPE_TX_RADIO_CMD and q.hdr.packet_type == PACKET_TYPE_TX_RADIO_CMD_RSP) or
-            (p.hdr.packet_type == PACKET_TYPE_RX_RADIO_CMD and q.hdr.packet_type == PACKET_TYPE_RX_RADIO_CMD_RSP)) and
-        q.hdr.command == p.hdr.command) {
+    if (entries.empty()) {
         return true;
     }
-    if (((p.hdr.packet_type == PACKET_TYPE_DEVICE_CMD and q.hdr.packet_type == PACKET_TYPE_DEVICE_CMD_ERR) or
-            (p.hdr.packet_type == PACKET_TYPE_TX_RADIO_CMD and q.hdr.packet_type == PACKET_TYPE_TX_RADIO_CMD_ERR) or
-            (p.hdr.packet_type == PACKET_TYPE_RX_RADIO_CMD and q.hdr.packet_type == PACKET_TYPE_RX_RADIO_CMD_ERR)) and
-        q.hdr.command == p.hdr.command) {
-        LOG_ERROR("command error in {:s}: {:s}", cmd_name, error_to_string(std::bit_cast<error_packet*>(&q)->value1));
+    std::vector<command_queue_element> packets;
+    std::vector<std::string> names;
+    packets.reserve(entries.size());
+    names.reserve(entries.size());
+    for (const auto& e : entries) {
+        packets.push_back(e.command);
+        names.push_back(e.name);
+    }
+    auto responses = vxsdr::imp::send_commands_and_return_responses(packets, names);
+
+    size_t n_read = 0;
+    std::lock_guard<std::mutex> lock(property_cache_mutex);
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (responses[i]) {
+            entries[i].response = responses[i].value();
+            property_cache.insert_or_assign(vxsdr::imp::property_cache_key(entries[i].command), std::move(entries[i]));
+            n_read++;
+        }
+    }
+    LOG_DEBUG("refresh_property_cache() read {:d} of {:d} properties", n_read, entries.size());
+    return n_read == entries.size();
+}
+
+std::map<std::string, int64_t> vxsdr::imp::get_queue_statistics() const {
+    std::map<std::string, int64_t> stats;
+    if (command_tport) {
+        stats.merge(command_tport->get_queue_statistics());
+    }
+    if (data_tport) {
+        stats.merge(data_tport->get_queue_statistics());
+    }
+    return stats;
+}
+
+std::optional<std::pair<vxsdr::time_point, double>> vxsdr::imp::get_rx_packet_timing(const uint8_t subdev) const {
+    if (not data_tport or subdev >= data_tport->rx_data_queue.size()) {
+        LOG_ERROR("incorrect subdevice {:d} in get_rx_packet_timing()", subdev);
+        return std::nullopt;
+    }
+    const auto [arrival_time, pop_time] = data_tport->rx_data_queue[subdev]->last_popped_timing();
+    if (arrival_time == 0) {
+        return std::nullopt;
+    }
+    const double latency = (pop_time > arrival_time) ? 1e-9 * (double)(pop_time - arrival_time) : 0.0;
+    return std::make_pair(vxsdr::time_point(vxsdr::duration(arrival_time)), latency);
+}
+
+// private functions
+
+[[nodiscard]] bool vxsdr::imp::send_command_and_check_response(packet& p, const std::string& cmd_name,
+                                                               std::function<bool()> on_success) {
+    {
+        std::lock_guard<std::mutex> lock(transaction_mutex);
+        if (transaction_open and transaction_owner == std::this_thread::get_id()) {
+            transaction_command c{{}, cmd_name, std::move(on_success)};
+            std::memcpy((void *)&c.packet, &p, std::min((size_t)p.hdr.packet_size, sizeof(c.packet)));
+            transaction_commands.push_back(std::move(c));
+            return true;
+        }
+    }
+    if (not vxsdr::imp::send_command_and_return_response(p, cmd_name)) {
         return false;
     }
-    LOG_ERROR("invalid response received in {:s}", cmd_name);
-    return false;
+    return not on_success or on_success();
 }
 
 [[nodiscard]] std::optional<command_queue_element> vxsdr::imp::send_command_and_return_response(packet& p, const std::string& cmd_name) {
+    if (vxsdr::imp::in_transaction()) {
+        LOG_ERROR("send_command_and_return_response failed sending {:s}: cannot be used in a transaction", cmd_name);
+        return std::nullopt;
+    }
     if (not command_tport->tx_rx_usable()) {
         LOG_ERROR("send_command_and_return_response failed sending {:s}: command tx and/or rx not usable", cmd_name);
         return std::nullopt;
     }
-    if (not vxsdr::imp::cmd_queue_push_check(p)) {
+    auto id = vxsdr::imp::submit_command(p, cmd_name);
+    if (not id) {
         LOG_ERROR("send_command_and_return_response failed sending {:s}: cmd queue push failed", cmd_name);
         return std::nullopt;
     }
-    command_queue_element q;
-    auto start_time = std::chrono::steady_clock::now();
-    while (not command_tport->response_queue.pop(q)) {
-        std::this_thread::sleep_for(command_response_wait);
-        if ((std::chrono::steady_clock::now() - start_time) > command_response_timeout) {
-            LOG_ERROR("timeout waiting for response in {:s}", cmd_name);
-            return std::nullopt;
+    return vxsdr::imp::wait_for_response(p, id.value(), cmd_name);
+}
+
+[[nodiscard]] std::vector<std::optional<command_queue_element>> vxsdr::imp::send_commands_and_return_responses(
+            std::span<command_queue_element> commands, std::span<const std::string> cmd_names) {
+    std::vector<std::optional<command_queue_element>> responses(commands.size());
+    if (not command_tport->tx_rx_usable()) {
+        LOG_ERROR("send_commands_and_return_responses failed sending {:d} commands: command tx and/or rx not usable", commands.size());
+        return responses;
+    }
+    std::vector<command_transport::command_response_status> statuses(commands.size());
+    std::vector<command_queue_element> received(commands.size());
+    size_t n_sent = command_tport->send_commands(commands, statuses, received, command_response_timeout);
+    if (n_sent < commands.size()) {
+        LOG_ERROR("send_commands_and_return_responses failed sending {:s}: cmd queue push failed", cmd_names[n_sent]);
+    }
+    for (size_t k = 0; k < n_sent; k++) {
+        responses[k] = vxsdr::imp::check_response(commands[k], statuses[k], received[k], cmd_names[k]);
+    }
+    return responses;
+}
+
+bool vxsdr::imp::in_transaction() {
+    std::lock_guard<std::mutex> lock(transaction_mutex);
+    return transaction_open and transaction_owner == std::this_thread::get_id();
+}
+
+[[nodiscard]] std::optional<command_queue_element> vxsdr::imp::send_query_and_return_cached_response(packet& p,
+                                                                                                   const std::string& cmd_name) {
+    auto key = vxsdr::imp::property_cache_key(p);
+    {
+        std::lock_guard<std::mutex> lock(property_cache_mutex);
+        auto it = property_cache.find(key);
+        if (it != property_cache.end()) {
+            return it->second.response;
         }
     }
+    auto res = vxsdr::imp::send_command_and_return_response(p, cmd_name);
+    if (res) {
+        cached_property entry{{}, res.value(), cmd_name};
+        std::memcpy((void *)&entry.command, &p, std::min((size_t)p.hdr.packet_size, sizeof(entry.command)));
+        std::lock_guard<std::mutex> lock(property_cache_mutex);
+        property_cache.insert_or_assign(std::move(key), std::move(entry));
+    }
+    return res;
+}
+
+std::string vxsdr::imp::property_cache_key(const packet& p) const {
+    // the query's header and arguments, leaving out the sequence counter
+    packet_header h    = p.hdr;
+    h.sequence_counter = 0;
+    std::string key(std::bit_cast<const char*>(&h), sizeof(h));
+    const size_t n_bytes = std::min((size_t)p.hdr.packet_size, sizeof(command_queue_element));
+    if (n_bytes > sizeof(h)) {
+        key.append(std::bit_cast<const char*>(&p) + sizeof(h), n_bytes - sizeof(h));
+    }
+    return key;
+}
+
+[[nodiscard]] std::optional<uint64_t> vxsdr::imp::submit_command(const packet& p, const std::string& cmd_name) {
+    // a command may have to wait for an earlier one to be answered
+    auto id = command_tport->submit_command(p, command_response_timeout);
+    if (not id) {
+        LOG_ERROR("error pushing to command queue in {:s}", cmd_name);
+    }
+    return id;
+}
+
+[[nodiscard]] std::optional<command_queue_element> vxsdr::imp::wait_for_response(const packet& p, const uint64_t id,
+                                                                                  const std::string& cmd_name) {
+    command_queue_element q;
+    auto status = command_tport->wait_for_response(id, q, command_response_timeout);
+    if (status == command_transport::COMMAND_RESPONSE_PENDING) {
+        command_tport->abandon_command(id);
+    }
+    return vxsdr::imp::check_response(p, status, q, cmd_name);
+}
+
+[[nodiscard]] std::optional<command_queue_element> vxsdr::imp::check_response(const packet& p,
+                                                                               const command_transport::command_response_status status,
+                                                                               const command_queue_element& q,
+                                                                               const std::string& cmd_name) {
+    if (status == command_transport::COMMAND_RESPONSE_PENDING) {
+        LOG_ERROR("timeout waiting for response in {:s}", cmd_name);
+        return std::nullopt;
+    }
+    if (status == command_transport::COMMAND_RESPONSE_MISSING) {
+        LOG_ERROR("no response received in {:s}", cmd_name);
+        return std::nullopt;
+    }
     if (((p.hdr.packet_type == PACKET_TYPE_DEVICE_CMD and q.hdr.packet_type == PACKET_TYPE_DEVICE_CMD_RSP) or
             (p.hdr.packet_type == PACKET_TYPE_TX_RADIO_CMD and q.hdr.packet_type == PACKET_TYPE_TX_RADIO_CMD_RSP) or
             (p.hdr.packet_type == PACKET_TYPE_RX_RADIO_CMD and q.hdr.packet_type == PACKET_TYPE_RX_RADIO_CMD_RSP)) and
@@ -521,16 +851,6 @@ double vxsdr::imp::get_host_command_timeout() const {
     return std::nullopt;
 }
 
-[[nodiscard]] bool vxsdr::imp::cmd_queue_push_check(packet& p, const std::string& cmd_name) {
-    command_queue_element q;
-    std::memcpy((void *)&q, &p, std::min((size_t)p.hdr.packet_size, sizeof(q)));
-    if (not command_tport->command_queue.push(q)) {
-        LOG_ERROR("error pushing to command queue in {:s}", cmd_name);
-        return false;
-    }
-    return true;
-}
-
 void vxsdr::imp::async_handler(const vxsdr::async_message_handler output_type) {
     LOG_DEBUG("async_handler started");
     while (not async_handler_stop_flag and command_tport->rx_state != packet_transport::TRANSPORT_SHUTDOWN) {
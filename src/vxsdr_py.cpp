@@ -85,6 +85,8 @@ PYBIND11_MODULE(vxsdr_py, m) {
     py::enum_<vxsdr_py::transport_type>(m, "transport_type", py::arithmetic())
         .value("UDP", vxsdr_py::transport_type::TRANSPORT_TYPE_UDP)
         .value("PCIE", vxsdr_py::transport_type::TRANSPORT_TYPE_PCIE)
+        .value("XDP", vxsdr_py::transport_type::TRANSPORT_TYPE_XDP)
+        .value("IO_URING", vxsdr_py::transport_type::TRANSPORT_TYPE_IO_URING)
     .export_values();
 
     // bindings to vxsdr class
@@ -339,6 +341,19 @@ PYBIND11_MODULE(vxsdr_py, m) {
                 py::arg("timeout"))
         PYBIND_DEF_SIMPLE(get_host_command_timeout,
                 "Get the timeout used by the host for commands sent to the device.")
+        PYBIND_DEF_SIMPLE(begin_transaction,
+                "Start collecting commands to send together.")
+        PYBIND_DEF_SIMPLE(end_transaction,
+                "Send the collected commands together and report the success of each.")
+        PYBIND_DEF_SIMPLE(clear_property_cache,
+                "Clear the host's copy of the device's static properties.")
+        PYBIND_DEF_SIMPLE(refresh_property_cache,
+                "Read the static properties already requested from the device again.")
+        PYBIND_DEF_SIMPLE(get_queue_statistics,
+                "Get statistics for the host library's internal queues.")
+        PYBIND_DEF_ARGS(get_rx_packet_timing,
+                "Get the arrival time and latency of the last data packet taken from a receive queue.",
+                py::arg("subdev") = 0)
         ;
 
 }
@@ -0,0 +1,228 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifdef VXSDR_ENABLE_XDP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <stdexcept>
+#include <vector>
+
+#include "logging.hpp"
+#include "vxsdr_packets.hpp"
+#include "vxsdr_queues.hpp"
+#include "vxsdr_net.hpp"
+#include "vxsdr_threads.hpp"
+#include "vxsdr_transport.hpp"
+#include "xdp_socket.hpp"
+
+/*! @file xdp_data_transport.cpp
+    @brief Constructor, destructor, and utility functions for the @p xdp_data_transport class.
+*/
+
+xdp_data_transport::xdp_data_transport(const std::map<std::string, int64_t>& settings,
+                                       const unsigned granularity,
+                                       const unsigned n_subdevs,
+                                       const unsigned max_samps_per_packet)
+        : data_transport(granularity, n_subdevs, max_samps_per_packet),
+          sender_socket(context, net::ip::udp::v4()) {
+    LOG_DEBUG("xdp data transport constructor entered");
+
+    auto config = apply_transport_settings(settings, get_default_settings());
+
+    // the addresses are the same as for the udp transports
+    for (const std::string address : {"local_address", "device_address"}) {
+        if (config.count("xdp_data_transport:" + address) == 0) {
+            if (config.count("udp_data_transport:" + address) != 0) {
+                config["xdp_data_transport:" + address] = config["udp_data_transport:" + address];
+            } else if (config.count("udp_transport:" + address) != 0) {
+                config["xdp_data_transport:" + address] = config["udp_transport:" + address];
+            }
+        }
+    }
+
+    if (config.count("xdp_data_transport:local_address") == 0 or config.count("xdp_data_transport:device_address") == 0) {
+        LOG_ERROR("xdp data transport settings must include udp_transport:local_address and udp_transport:device_address");
+        throw std::invalid_argument("xdp data transport settings must include local address and device address");
+    }
+
+    net::ip::address_v4 local_ip  = net::ip::address_v4(config["xdp_data_transport:local_address"]);
+    net::ip::address_v4 device_ip = net::ip::address_v4(config["xdp_data_transport:device_address"]);
+
+    net_error_code::error_code err;
+
+    LOG_DEBUG("binding xdp data sender socket to address {:s} port {:d}", local_ip.to_string(), udp_host_data_send_port);
+    sender_socket.bind(net::ip::udp::endpoint(local_ip, udp_host_data_send_port), err);
+    if (err) {
+        LOG_ERROR("error binding xdp data sender socket on local address {:s}; check that network interface is up ({:s})",
+                  local_ip.to_string(), err.message());
+        throw std::runtime_error("error binding xdp data sender socket on local address " + local_ip.to_string() +
+                                 "; check that network interface is up");
+    }
+
+    LOG_DEBUG("connecting xdp data sender socket to address {:s} port {:d}", device_ip.to_string(), udp_device_data_receive_port);
+    sender_socket.connect(net::ip::udp::endpoint(device_ip, udp_device_data_receive_port), err);
+    if (err) {
+        LOG_ERROR("error connecting xdp data sender socket to device address {:s} ({:s})", device_ip.to_string(), err.message());
+        throw std::runtime_error("error connecting xdp data sender socket to device address " + device_ip.to_string());
+    }
+
+    if (set_socket_dontfrag(sender_socket)) {
+        LOG_ERROR("error setting do-not-fragment flag for xdp data sender socket");
+        throw std::runtime_error("error setting do-not-fragment flag for xdp data sender socket");
+    }
+
+    size_t network_send_buffer_bytes = config["xdp_data_transport:network_send_buffer_bytes"];
+    sender_socket.set_option(net::socket_base::send_buffer_size((int)network_send_buffer_bytes), err);
+    if (err) {
+        LOG_ERROR("cannot set network send buffer size to {:d} ({:s})", network_send_buffer_bytes, err.message());
+    }
+
+    unsigned ifindex = (unsigned)config["xdp_data_transport:interface_index"];
+    if (ifindex == 0) {
+        ifindex = xdp_socket::interface_index(local_ip.to_uint());
+        if (ifindex == 0) {
+            LOG_ERROR("cannot find the network interface with local address {:s}", local_ip.to_string());
+            throw std::runtime_error("cannot find the network interface with local address " + local_ip.to_string());
+        }
+    }
+
+    xdp_socket_options xsk_options;
+    xsk_options.frame_count = (uint32_t)config["xdp_data_transport:frame_count"];
+    xsk_options.frame_bytes = (uint32_t)config["xdp_data_transport:frame_bytes"];
+    xsk_options.zero_copy   = config["xdp_data_transport:zero_copy"] != 0;
+    // the umem is placed like the rx data queues it feeds
+    xsk_options.memory      = rx_data_queue_memory_options(config, "xdp_data_transport");
+    receiver_xsk = std::make_unique<xdp_socket>(ifindex, (uint32_t)config["xdp_data_transport:queue_id"],
+                                                udp_host_data_receive_port, xsk_options);
+
+    // packets must fit in one frame
+    unsigned socket_max_samples = (receiver_xsk->max_payload_bytes() - sizeof(packet_header) - sizeof(stream_spec_t) - sizeof(time_spec_t))
+                                  / sizeof(vxsdr::wire_sample);
+    if (socket_max_samples < max_samples_per_packet) {
+        max_samples_per_packet = sample_granularity * (socket_max_samples / sample_granularity);
+        LOG_INFO("reducing max_samples_per_packet to {:d} to fit xdp frames of {:d} bytes", max_samples_per_packet, xsk_options.frame_bytes);
+    }
+
+    LOG_DEBUG("using transmit data buffer of {:d} packets", config["xdp_data_transport:tx_data_queue_packets"]);
+    tx_data_queue = std::make_unique<vxsdr_queue<data_queue_element>>(config["xdp_data_transport:tx_data_queue_packets"]);
+
+    const size_t rx_queue_bytes         = rx_data_queue_bytes(config["xdp_data_transport:rx_data_queue_packets"]);
+    // a nonzero initial size makes the queues start small and grow as needed
+    const size_t rx_queue_initial_bytes = rx_data_queue_bytes(config["xdp_data_transport:rx_data_queue_initial_packets"]);
+    const auto rx_queue_memory          = rx_data_queue_memory_options(config, "xdp_data_transport");
+    for (unsigned i = 0; i < num_rx_subdevs; i++) {
+        rx_data_queue.push_back(std::make_unique<packet_ring>(rx_queue_bytes, rx_queue_memory, rx_queue_initial_bytes));
+        rx_sample_queue.push_back(
+            std::make_unique<vxsdr_queue<vxsdr::wire_sample>>(MAX_DATA_LENGTH_SAMPLES));
+    }
+
+    LOG_DEBUG("using {:d} receive data buffers of {:d} packets ({:d} bytes)", num_rx_subdevs,
+              config["xdp_data_transport:rx_data_queue_packets"], rx_queue_bytes);
+
+    if (config["queue_statistics"] != 0) {
+        LOG_DEBUG("enabling queue statistics");
+        enable_queue_statistics();
+    }
+
+    rx_state        = TRANSPORT_STARTING;
+    receiver_thread = vxsdr_thread([this] { data_receive(); });
+
+    if (config["xdp_data_transport:thread_affinity_offset"] >= 0 and config["xdp_data_transport:receiver_thread_affinity"] >= 0) {
+        auto desired_affinity =
+            config["xdp_data_transport:thread_affinity_offset"] + config["xdp_data_transport:receiver_thread_affinity"];
+        if (set_thread_affinity(receiver_thread, desired_affinity) != 0) {
+            LOG_ERROR("unable to set xdp data receiver thread affinity in xdp data transport constructor");
+            throw std::runtime_error("unable to set xdp data receiver thread affinity in xdp data transport constructor");
+        }
+        LOG_DEBUG("xdp data receiver thread affinity set to cpu {:d}", desired_affinity);
+    }
+    if (config["xdp_data_transport:thread_priority"] >= 0) {
+        if (set_thread_priority_realtime(receiver_thread, (int)config["xdp_data_transport:thread_priority"]) != 0) {
+            LOG_ERROR("unable to set xdp data receiver thread realtime priority in xdp data transport constructor");
+            throw std::runtime_error("unable to set xdp data receiver thread realtime priority in xdp data transport constructor");
+        }
+        LOG_DEBUG("xdp data receiver thread priority set to {:d}", config["xdp_data_transport:thread_priority"]);
+    }
+
+    tx_state      = TRANSPORT_STARTING;
+    sender_thread = vxsdr_thread([this] { data_send(); });
+
+    if (config["xdp_data_transport:thread_affinity_offset"] >= 0 and config["xdp_data_transport:sender_thread_affinity"] >= 0) {
+        auto desired_affinity =
+            config["xdp_data_transport:thread_affinity_offset"] + config["xdp_data_transport:sender_thread_affinity"];
+        if (set_thread_affinity(sender_thread, desired_affinity) != 0) {
+            LOG_ERROR("unable to set xdp data sender thread affinity in xdp data transport constructor");
+            throw std::runtime_error("unable to set xdp data sender thread affinity in xdp data transport constructor");
+        }
+        LOG_DEBUG("xdp data sender thread affinity set to cpu {:d}", desired_affinity);
+    }
+    if (config["xdp_data_transport:thread_priority"] >= 0) {
+        if (set_thread_priority_realtime(sender_thread, (int)config["xdp_data_transport:thread_priority"]) != 0) {
+            LOG_ERROR("unable to set xdp data sender thread realtime priority in xdp data transport constructor");
+            throw std::runtime_error("unable to set xdp data sender thread realtime priority in xdp data transport constructor");
+        }
+        LOG_DEBUG("xdp data sender thread priority set to {:d}", config["xdp_data_transport:thread_priority"]);
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    while (tx_state != TRANSPORT_READY or rx_state != TRANSPORT_READY) {
+        std::this_thread::sleep_for(xdp_ready_wait);
+        if ((std::chrono::steady_clock::now() - start_time) > xdp_ready_timeout) {
+            LOG_ERROR("timeout waiting for transport ready in xdp data transport constructor");
+            throw std::runtime_error("timeout waiting for transport ready in xdp data transport constructor");
+        }
+    }
+
+    LOG_DEBUG("xdp data transport constructor complete");
+}
+
+xdp_data_transport::~xdp_data_transport() noexcept {
+    LOG_DEBUG("xdp data transport destructor entered");
+    // tx must shut down before rx since tx sends a final ack request to update stats
+    LOG_DEBUG("joining xdp data sender thread");
+    tx_state = TRANSPORT_SHUTDOWN;
+    sender_thread_stop_flag = true;
+    if (sender_thread.joinable()) {
+        sender_thread.join();
+    }
+    // receives time out regularly, so the receiver thread sees the stop flag
+    LOG_DEBUG("joining xdp data receiver thread");
+    rx_state = TRANSPORT_SHUTDOWN;
+    receiver_thread_stop_flag = true;
+    if (receiver_thread.joinable()) {
+        receiver_thread.join();
+    }
+    receiver_xsk.reset();
+    net_error_code::error_code err;
+    sender_socket.close(err);
+    if (err) {
+        LOG_ERROR("xdp data sender socket close: {:s}", err.message());
+    }
+    if (log_stats_on_exit) {
+        log_stats();
+    }
+    LOG_DEBUG("xdp data transport destructor complete");
+}
+
+size_t xdp_data_transport::packet_send(const packet& packet, int& error_code) {
+    net::socket_base::message_flags flags = 0;
+    net_error_code::error_code err;
+    size_t bytes = sender_socket.send(net::buffer(&packet, packet.hdr.packet_size), flags, err);
+    error_code = err.value();
+    return bytes;
+}
+
+size_t xdp_data_transport::packet_receive(data_queue_element& packet, int& error_code) {
+    packet.hdr = { 0, 0, 0, 0, 0, 0, 0 };
+    return receiver_xsk->receive(&packet, sizeof(packet), xdp_receive_timeout_ms, error_code);
+}
+
+#endif // #ifdef VXSDR_ENABLE_XDP
@@ -0,0 +1,395 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifdef VXSDR_TARGET_LINUX
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/if_xdp.h>
+
+#include "logging.hpp"
+#include "xdp_socket.hpp"
+
+/*! @file xdp_socket.cpp
+    @brief Setup, teardown and receive functions for the @p xdp_socket class.
+*/
+
+#ifndef AF_XDP
+#define AF_XDP (44)
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP (283)
+#endif
+
+namespace {
+
+// Ethernet, IPv4 without options, and UDP headers
+constexpr size_t eth_bytes          = 14;
+constexpr size_t ipv4_bytes         = 20;
+constexpr size_t udp_bytes          = 8;
+constexpr size_t udp_payload_offset = eth_bytes + ipv4_bytes + udp_bytes;
+
+// the completion ring is only used for transmit, which this socket does not do, but the
+// kernel requires one
+constexpr uint32_t completion_ring_size = 64;
+
+long bpf(const int cmd, bpf_attr& attr) { return syscall(SYS_bpf, cmd, &attr, sizeof(attr)); }
+
+constexpr bpf_insn insn(const uint8_t code, const uint8_t dst, const uint8_t src, const int16_t off, const int32_t imm) {
+    bpf_insn i{};
+    i.code    = code;
+    i.dst_reg = dst;
+    i.src_reg = src;
+    i.off     = off;
+    i.imm     = imm;
+    return i;
+}
+
+// the kernel's smallest umem chunk size (XDP_UMEM_MIN_CHUNK_SIZE, which is not in the uapi headers)
+constexpr uint32_t min_frame_bytes = 2048;
+
+uint32_t load_acquire(uint32_t* p) { return std::atomic_ref<uint32_t>(*p).load(std::memory_order_acquire); }
+void store_release(uint32_t* p, const uint32_t value) { std::atomic_ref<uint32_t>(*p).store(value, std::memory_order_release); }
+
+// the value of a 16-bit field in network byte order when loaded by the BPF program
+int32_t network_u16(const uint16_t value) { return htons(value); }
+
+}  // namespace
+
+xdp_socket::xdp_socket(const unsigned ifindex, const uint32_t queue_id, const uint16_t udp_port, const xdp_socket_options& options)
+        : frame_count(options.frame_count), frame_bytes(options.frame_bytes) {
+    if (not std::has_single_bit(frame_count) or not std::has_single_bit(frame_bytes) or frame_bytes < min_frame_bytes) {
+        LOG_ERROR("xdp socket frame count ({:d}) and frame size ({:d}) must be powers of 2, and frame size at least {:d}",
+                  frame_count, frame_bytes, min_frame_bytes);
+        throw std::invalid_argument("xdp socket frame count and frame size must be powers of 2");
+    }
+    try {
+        umem = std::make_unique<queue_memory>((size_t)frame_count * frame_bytes, options.memory);
+
+        xsk_fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+        if (xsk_fd < 0) {
+            LOG_ERROR("cannot create AF_XDP socket ({:s})", std::strerror(errno));
+            throw std::runtime_error("cannot create AF_XDP socket");
+        }
+
+        xdp_umem_reg reg{};
+        reg.addr       = (uint64_t)umem->data();
+        reg.len        = (uint64_t)frame_count * frame_bytes;
+        reg.chunk_size = frame_bytes;
+        reg.headroom   = 0;
+        if (setsockopt(xsk_fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) != 0) {
+            LOG_ERROR("cannot register xdp umem of {:d} bytes ({:s})", reg.len, std::strerror(errno));
+            throw std::runtime_error("cannot register xdp umem");
+        }
+
+        // every frame fits in the fill ring, so returning frames to it never fails
+        const uint32_t cq_size = completion_ring_size;
+        if (setsockopt(xsk_fd, SOL_XDP, XDP_UMEM_FILL_RING, &frame_count, sizeof(frame_count)) != 0
+                or setsockopt(xsk_fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &cq_size, sizeof(cq_size)) != 0
+                or setsockopt(xsk_fd, SOL_XDP, XDP_RX_RING, &frame_count, sizeof(frame_count)) != 0) {
+            LOG_ERROR("cannot set xdp ring sizes ({:s})", std::strerror(errno));
+            throw std::runtime_error("cannot set xdp ring sizes");
+        }
+
+        xdp_mmap_offsets offsets{};
+        socklen_t offsets_len = sizeof(offsets);
+        if (getsockopt(xsk_fd, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &offsets_len) != 0) {
+            LOG_ERROR("cannot get xdp ring offsets ({:s})", std::strerror(errno));
+            throw std::runtime_error("cannot get xdp ring offsets");
+        }
+        map_ring(rx, frame_count, XDP_PGOFF_RX_RING, &offsets.rx, sizeof(xdp_desc));
+        map_ring(fill, frame_count, XDP_UMEM_PGOFF_FILL_RING, &offsets.fr, sizeof(uint64_t));
+        map_ring(completion, completion_ring_size, XDP_UMEM_PGOFF_COMPLETION_RING, &offsets.cr, sizeof(uint64_t));
+
+        // give the driver every frame before binding, so it can start receiving at once
+        auto* addresses = static_cast<uint64_t*>(fill.descriptors);
+        for (uint32_t i = 0; i < frame_count; i++) {
+            addresses[i] = (uint64_t)i * frame_bytes;
+        }
+        fill_producer = frame_count;
+        store_release(fill.producer, fill_producer);
+
+        sockaddr_xdp address{};
+        address.sxdp_family   = AF_XDP;
+        address.sxdp_ifindex  = ifindex;
+        address.sxdp_queue_id = queue_id;
+        address.sxdp_flags    = XDP_USE_NEED_WAKEUP | (options.zero_copy ? XDP_ZEROCOPY : XDP_COPY);
+        int res = bind(xsk_fd, (sockaddr*)&address, sizeof(address));
+        if (res != 0 and options.zero_copy) {
+            LOG_WARN("xdp zero-copy mode unavailable on interface {:d} queue {:d} ({:s}); using copy mode",
+                     ifindex, queue_id, std::strerror(errno));
+            address.sxdp_flags = XDP_USE_NEED_WAKEUP | XDP_COPY;
+            res = bind(xsk_fd, (sockaddr*)&address, sizeof(address));
+        }
+        if (res != 0) {
+            LOG_ERROR("cannot bind xdp socket to interface {:d} queue {:d} ({:s})", ifindex, queue_id, std::strerror(errno));
+            throw std::runtime_error("cannot bind xdp socket");
+        }
+        xdp_options xsk_options{};
+        socklen_t xsk_options_len = sizeof(xsk_options);
+        if (getsockopt(xsk_fd, SOL_XDP, XDP_OPTIONS, &xsk_options, &xsk_options_len) == 0) {
+            zero_copy = (xsk_options.flags & XDP_OPTIONS_ZEROCOPY) != 0;
+        }
+
+        load_program(udp_port);
+        if (map_fd < 0) {
+            throw std::runtime_error("cannot load xdp program");
+        }
+
+        // the program finds this socket through the map entry for its queue
+        uint32_t key   = queue_id;
+        uint32_t value = (uint32_t)xsk_fd;
+        bpf_attr attr{};
+        attr.map_fd = (uint32_t)map_fd;
+        attr.key    = (uint64_t)&key;
+        attr.value  = (uint64_t)&value;
+        attr.flags  = BPF_ANY;
+        if (bpf(BPF_MAP_UPDATE_ELEM, attr) != 0) {
+            LOG_ERROR("cannot add xdp socket to map ({:s})", std::strerror(errno));
+            throw std::runtime_error("cannot add xdp socket to map");
+        }
+
+        attr                          = {};
+        attr.link_create.prog_fd      = (uint32_t)prog_fd;
+        attr.link_create.target_ifindex = ifindex;
+        attr.link_create.attach_type  = BPF_XDP;
+        link_fd = (int)bpf(BPF_LINK_CREATE, attr);
+        if (link_fd < 0) {
+            LOG_ERROR("cannot attach xdp program to interface {:d} ({:s}); check that no other xdp program is attached",
+                      ifindex, std::strerror(errno));
+            throw std::runtime_error("cannot attach xdp program");
+        }
+    } catch (...) {
+        close_all();
+        throw;
+    }
+    LOG_DEBUG("xdp socket on interface {:d} queue {:d} receiving udp port {:d} in {:s} mode", ifindex, queue_id, udp_port,
+              zero_copy ? "zero-copy" : "copy");
+}
+
+xdp_socket::~xdp_socket() noexcept {
+    close_all();
+}
+
+void xdp_socket::map_ring(ring& r, const uint32_t size, const uint64_t offset, const void* ring_offsets, const size_t descriptor_bytes) {
+    const auto* off = static_cast<const xdp_ring_offset*>(ring_offsets);
+    r.map_bytes     = off->desc + size * descriptor_bytes;
+    r.map = mmap(nullptr, r.map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, xsk_fd, (off_t)offset);
+    if (r.map == MAP_FAILED) {
+        r.map = nullptr;
+        LOG_ERROR("cannot map xdp ring ({:s})", std::strerror(errno));
+        throw std::runtime_error("cannot map xdp ring");
+    }
+    auto* base    = static_cast<uint8_t*>(r.map);
+    r.producer    = reinterpret_cast<uint32_t*>(base + off->producer);
+    r.consumer    = reinterpret_cast<uint32_t*>(base + off->consumer);
+    r.flags       = reinterpret_cast<uint32_t*>(base + off->flags);
+    r.descriptors = base + off->desc;
+    r.mask        = size - 1;
+}
+
+void xdp_socket::unmap_ring(ring& r) noexcept {
+    if (r.map != nullptr) {
+        munmap(r.map, r.map_bytes);
+        r = {};
+    }
+}
+
+// Builds and loads the program
+//
+//     if (packet is IPv4 without options, not a fragment, UDP, and for udp_port)
+//         return bpf_redirect_map(&xsk_map, ctx->rx_queue_index, XDP_PASS);
+//     return XDP_PASS;
+//
+// where the XDP_PASS flag passes the packet to the kernel stack if no socket is bound to the queue.
+void xdp_socket::load_program(const uint16_t udp_port) {
+    bpf_attr attr{};
+    attr.map_type    = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size    = sizeof(uint32_t);
+    attr.value_size  = sizeof(uint32_t);
+    attr.max_entries = 256;
+    map_fd = (int)bpf(BPF_MAP_CREATE, attr);
+    if (map_fd < 0) {
+        LOG_ERROR("cannot create xdp socket map ({:s}); check for CAP_BPF and CAP_NET_ADMIN", std::strerror(errno));
+        return;
+    }
+
+    constexpr uint8_t r0 = 0, r1 = 1, r2 = 2, r3 = 3, r4 = 4, r5 = 5, r6 = 6;
+    std::vector<bpf_insn> program;
+    std::vector<size_t> jumps_to_pass;
+    auto load = [&](const uint8_t size, const uint8_t dst, const uint8_t src, const size_t offset) {
+        program.push_back(insn(BPF_LDX | BPF_MEM | size, dst, src, (int16_t)offset, 0));
+    };
+    auto pass_unless_equal = [&](const uint8_t reg, const int32_t value) {
+        jumps_to_pass.push_back(program.size());
+        program.push_back(insn(BPF_JMP | BPF_JNE | BPF_K, reg, 0, 0, value));
+    };
+
+    program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_X, r6, r1, 0, 0));
+    load(BPF_W, r2, r6, offsetof(xdp_md, data));
+    load(BPF_W, r3, r6, offsetof(xdp_md, data_end));
+    program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_X, r4, r2, 0, 0));
+    program.push_back(insn(BPF_ALU64 | BPF_ADD | BPF_K, r4, 0, 0, (int32_t)udp_payload_offset));
+    jumps_to_pass.push_back(program.size());
+    program.push_back(insn(BPF_JMP | BPF_JGT | BPF_X, r4, r3, 0, 0));
+    load(BPF_H, r5, r2, 12);  // ethertype
+    pass_unless_equal(r5, network_u16(ETH_P_IP));
+    load(BPF_B, r5, r2, eth_bytes);  // version and header length
+    pass_unless_equal(r5, 0x45);
+    load(BPF_B, r5, r2, eth_bytes + 9);  // protocol
+    pass_unless_equal(r5, IPPROTO_UDP);
+    load(BPF_H, r5, r2, eth_bytes + 6);  // more fragments flag and fragment offset
+    program.push_back(insn(BPF_ALU64 | BPF_AND | BPF_K, r5, 0, 0, network_u16(0x3FFF)));
+    pass_unless_equal(r5, 0);
+    load(BPF_H, r5, r2, eth_bytes + ipv4_bytes + 2);  // destination port
+    pass_unless_equal(r5, network_u16(udp_port));
+    load(BPF_W, r2, r6, offsetof(xdp_md, rx_queue_index));
+    program.push_back(insn(BPF_LD | BPF_DW | BPF_IMM, r1, BPF_PSEUDO_MAP_FD, 0, map_fd));
+    program.push_back(insn(0, 0, 0, 0, 0));
+    program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_K, r3, 0, 0, XDP_PASS));
+    program.push_back(insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+    program.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+    const size_t pass = program.size();
+    program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_K, r0, 0, 0, XDP_PASS));
+    program.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+    for (auto j : jumps_to_pass) {
+        program[j].off = (int16_t)(pass - j - 1);
+    }
+
+    static constexpr char license[] = "GPL";
+    attr           = {};
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insn_cnt  = (uint32_t)program.size();
+    attr.insns     = (uint64_t)program.data();
+    attr.license   = (uint64_t)license;
+    prog_fd = (int)bpf(BPF_PROG_LOAD, attr);
+    if (prog_fd < 0) {
+        const int load_errno = errno;
+        // load again with the verifier log, to report why
+        std::vector<char> log(65'536, 0);
+        attr.log_level = 1;
+        attr.log_buf   = (uint64_t)log.data();
+        attr.log_size  = (uint32_t)log.size();
+        bpf(BPF_PROG_LOAD, attr);
+        LOG_ERROR("cannot load xdp program ({:s}): {:s}", std::strerror(load_errno), log.data());
+        close(map_fd);
+        map_fd = -1;
+    }
+}
+
+void xdp_socket::close_all() noexcept {
+    // closing the link detaches the program from the interface
+    for (int* fd : {&link_fd, &prog_fd, &map_fd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    unmap_ring(rx);
+    unmap_ring(fill);
+    unmap_ring(completion);
+    if (xsk_fd >= 0) {
+        close(xsk_fd);
+        xsk_fd = -1;
+    }
+    umem.reset();
+}
+
+size_t xdp_socket::receive(void* dest, const size_t max_bytes, const int timeout_ms, int& error_code) {
+    error_code = 0;
+    if (rx_consumer == rx_cached_producer) {
+        release_frames();
+        rx_cached_producer = load_acquire(rx.producer);
+        if (rx_consumer == rx_cached_producer) {
+            pollfd pfd{xsk_fd, POLLIN, 0};
+            if (poll(&pfd, 1, timeout_ms) < 0 and errno != EINTR) {
+                error_code = errno;
+                return 0;
+            }
+            rx_cached_producer = load_acquire(rx.producer);
+            if (rx_consumer == rx_cached_producer) {
+                return 0;
+            }
+        }
+    }
+
+    const xdp_desc& desc = static_cast<const xdp_desc*>(rx.descriptors)[rx_consumer & rx.mask];
+    rx_consumer++;
+    // the program only redirects packets with these headers, so the payload offset is fixed
+    size_t n = 0;
+    if (desc.len > udp_payload_offset) {
+        const uint8_t* frame = umem->data() + desc.addr;
+        uint16_t udp_length  = 0;
+        std::memcpy(&udp_length, frame + eth_bytes + ipv4_bytes + 4, sizeof(udp_length));
+        n = std::min<size_t>({ntohs(udp_length) - udp_bytes, desc.len - udp_payload_offset, max_bytes});
+        std::memcpy(dest, frame + udp_payload_offset, n);
+    }
+    if (rx_consumer - rx_released >= release_batch) {
+        release_frames();
+    }
+    return n;
+}
+
+void xdp_socket::release_frames() {
+    const uint32_t n = rx_consumer - rx_released;
+    if (n == 0) {
+        return;
+    }
+    const auto* descriptors = static_cast<const xdp_desc*>(rx.descriptors);
+    auto* addresses         = static_cast<uint64_t*>(fill.descriptors);
+    for (uint32_t i = 0; i < n; i++) {
+        addresses[(fill_producer + i) & fill.mask] = descriptors[(rx_released + i) & rx.mask].addr & ~(uint64_t)(frame_bytes - 1);
+    }
+    fill_producer += n;
+    rx_released = rx_consumer;
+    store_release(fill.producer, fill_producer);
+    store_release(rx.consumer, rx_consumer);
+    if ((load_acquire(fill.flags) & XDP_RING_NEED_WAKEUP) != 0) {
+        recvfrom(xsk_fd, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+    }
+}
+
+size_t xdp_socket::max_payload_bytes() const noexcept {
+    return frame_bytes - XDP_PACKET_HEADROOM - udp_payload_offset;
+}
+
+unsigned xdp_socket::interface_index(const uint32_t ipv4_address) {
+    ifaddrs* interfaces = nullptr;
+    if (getifaddrs(&interfaces) != 0) {
+        return 0;
+    }
+    unsigned index = 0;
+    for (ifaddrs* i = interfaces; i != nullptr; i = i->ifa_next) {
+        if (i->ifa_addr != nullptr and i->ifa_addr->sa_family == AF_INET
+                and reinterpret_cast<sockaddr_in*>(i->ifa_addr)->sin_addr.s_addr == htonl(ipv4_address)) {
+            index = if_nametoindex(i->ifa_name);
+            break;
+        }
+    }
+    freeifaddrs(interfaces);
+    return index;
+}
+
+#endif  // VXSDR_TARGET_LINUX
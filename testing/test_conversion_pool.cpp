@@ -0,0 +1,67 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Calls conversion_pool::run() from two threads at once, as get_rx_data and put_tx_data do, and checks
+// that every task of every call runs exactly once. Usage:
+//
+//     ./test_conversion_pool <number of pool threads> <number of calls per thread>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "conversion_pool.hpp"
+
+static constexpr size_t n_tasks = 64;
+
+// each call counts the runs of each of its tasks, and checks the counts when run() returns
+static uint64_t run_calls(conversion_pool& pool, const uint64_t n_calls, const unsigned offset) {
+    uint64_t n_errors = 0;
+    std::vector<std::atomic<unsigned>> counts(n_tasks);
+    for (uint64_t n = 0; n < n_calls; n++) {
+        for (auto& c : counts) {
+            c = 0;
+        }
+        pool.run(n_tasks, [&counts, offset](size_t i) {
+            counts[i] += 1 + offset;
+            // give the other caller a chance to start a run while this one is in progress
+            std::this_thread::yield();
+        });
+        for (auto& c : counts) {
+            if (c != 1 + offset) {
+                n_errors++;
+            }
+        }
+    }
+    return n_errors;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: test_conversion_pool <number of pool threads> <number of calls per thread>" << std::endl;
+        return -1;
+    }
+    const auto n_threads = (unsigned)std::strtoul(argv[1], nullptr, 10);
+    const uint64_t n_calls = std::strtoull(argv[2], nullptr, 10);
+
+    conversion_pool pool(n_threads, -1);
+
+    uint64_t errors_a = 0;
+    uint64_t errors_b = 0;
+    std::thread a([&] { errors_a = run_calls(pool, n_calls, 0); });
+    std::thread b([&] { errors_b = run_calls(pool, n_calls, 1); });
+    a.join();
+    b.join();
+
+    std::cout << "thread a: " << errors_a << " errors in " << n_calls << " calls" << std::endl;
+    std::cout << "thread b: " << errors_b << " errors in " << n_calls << " calls" << std::endl;
+
+    bool pass = errors_a == 0 and errors_b == 0;
+
+    std::cout << (pass ? "passed" : "failed") << std::endl;
+
+    return (pass ? 0 : 1);
+}
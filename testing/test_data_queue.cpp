@@ -1,17 +1,25 @@
 // Copyright (c) 2023 Vesperix Corporation
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <complex>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <type_traits>
 #include <vector>
-#include <array>
+
+// benchmark the boost backend too whenever boost is installed
+#if __has_include(<boost/lockfree/spsc_queue.hpp>) && !defined(VXSDR_ENABLE_BOOST_QUEUE)
+#define VXSDR_ENABLE_BOOST_QUEUE
+#endif
 
 #include "vxsdr_queues.hpp"
+#include "packet_ring.hpp"
 #include "vxsdr_packets.hpp"
 #include "vxsdr_threads.hpp"
 
@@ -26,31 +34,49 @@ static constexpr unsigned pop_queue_interval_us  = 0;
 
 // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
 
-auto queue = std::make_unique<vxsdr_queue<data_queue_element>>(queue_length);
-
 std::mutex console_mutex;
 
-void producer(const size_t n_items, double& push_rate) {
+// the producer and consumer either move one packet per queue operation, or
+// up to batch_size packets per operation using the bulk push and pop
+
+static constexpr size_t batch_size = 256;
+
+template <typename Queue, bool Bulk> void producer(Queue* queue, const size_t n_items, double& push_rate) {
+    static std::array<data_queue_element, batch_size> p;
+    for (auto& e : p) {
+        e.hdr = {PACKET_TYPE_TX_SIGNAL_DATA, 0, 0, 0, 0, MAX_DATA_PACKET_BYTES, 0};
+        std::memset((void *)&e.data, 0xFF, MAX_DATA_PAYLOAD_BYTES);
+    }
+
     auto t0 = std::chrono::steady_clock::now();
 
-    for (size_t i = 0; i < n_items; i++) {
-        data_queue_element p;
-        p.hdr = {PACKET_TYPE_TX_SIGNAL_DATA, 0, 0, 0, 0, MAX_DATA_PACKET_BYTES, 0};
-        p.hdr.sequence_counter = i % (UINT16_MAX + 1);
+    size_t i = 0;
 
-        std::memset((void *)&p.data, 0xFF, MAX_DATA_PAYLOAD_BYTES);
+    while (i < n_items) {
+        size_t n_to_push = Bulk ? std::min(batch_size, n_items - i) : 1;
+        for (size_t j = 0; j < n_to_push; j++) {
+            p[j].hdr.sequence_counter = (i + j) % (UINT16_MAX + 1);
+        }
 
+        size_t n_pushed = 0;
         unsigned n_try = 0;
 
-        while (not queue->push(p) and n_try < n_tries) {
-            std::this_thread::sleep_for(std::chrono::microseconds(push_queue_wait_us));
-            n_try++;
+        while (n_pushed < n_to_push and n_try < n_tries) {
+            size_t n = Bulk ? queue->push(&p[n_pushed], n_to_push - n_pushed) : (size_t)queue->push(p[0]);
+            if (n == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(push_queue_wait_us));
+                n_try++;
+            } else {
+                n_pushed += n;
+                n_try = 0;
+            }
         }
         if (n_try >= n_tries) {
             std::lock_guard<std::mutex> guard(console_mutex);
             std::cout << "producer: timeout waiting for push" << std::endl;
             exit(-1);
         }
+        i += n_pushed;
 
         if constexpr (push_queue_interval_us > 0) {
             std::this_thread::sleep_for(std::chrono::microseconds(push_queue_interval_us));
@@ -65,20 +91,19 @@ void producer(const size_t n_items, double& push_rate) {
               << std::endl;
 }
 
-void consumer(const size_t n_items, double& pop_rate) {
-    constexpr size_t buffer_size = 512;
+template <typename Queue, bool Bulk> void consumer(Queue* queue, const size_t n_items, double& pop_rate) {
+    static std::array<data_queue_element, batch_size> p;
+
     auto t0 = std::chrono::steady_clock::now();
 
     size_t i = 0;
 
     while (i < n_items) {
-        static std::array<data_queue_element, buffer_size> p;
-
         unsigned n_try = 0;
         size_t n_popped = 0;
 
         while (n_popped == 0 and n_try < n_tries) {
-            n_popped = queue->pop(p.data(), buffer_size);
+            n_popped = Bulk ? queue->pop(p.data(), batch_size) : (size_t)queue->pop(p[0]);
             if (n_popped == 0) {
                 std::this_thread::sleep_for(std::chrono::microseconds(pop_queue_wait_us));
                 n_try++;
@@ -114,9 +139,92 @@ void consumer(const size_t n_items, double& pop_rate) {
     std::cout << "consumer: " << n_items << " packets popped in " << d.count() << " sec: " << pop_rate << " samples/s" << std::endl;
 }
 
+// an elastic packet ring starts using 1/16 of its memory and grows as it fills
+class elastic_packet_ring : public packet_ring {
+  public:
+    explicit elastic_packet_ring(const size_t size_bytes) : packet_ring(size_bytes, {}, size_bytes / 16) {}
+};
+
+// queues with statistics enabled, to measure the cost of collecting them
+class measured_queue : public vxsdr_queue<data_queue_element> {
+  public:
+    explicit measured_queue(const size_t size) : vxsdr_queue<data_queue_element>(size) { enable_statistics(true); }
+};
+
+class measured_packet_ring : public packet_ring {
+  public:
+    explicit measured_packet_ring(const size_t size_bytes) : packet_ring(size_bytes) { enable_statistics(); }
+};
+
+// packet rings are sized in bytes, so give them room for queue_length packets of the maximum size
+template <typename Queue> std::unique_ptr<Queue> make_test_queue() {
+    if constexpr (std::is_base_of<packet_ring, Queue>()) {
+        return std::make_unique<Queue>(queue_length * packet_ring::record_bytes(MAX_DATA_PACKET_BYTES));
+    } else {
+        return std::make_unique<Queue>(queue_length);
+    }
+}
+
+template <typename Queue, bool Bulk> double run_test(const char* name, const size_t n_items) {
+    std::cout << name << " queue, " << (Bulk ? "bulk" : "single") << " push and pop:" << std::endl;
+
+    auto queue = make_test_queue<Queue>();
+
+    double pop_rate = 0;
+    double push_rate = 0;
+
+    auto consumer_thread = vxsdr_thread(&consumer<Queue, Bulk>, queue.get(), n_items, std::ref(pop_rate));
+    auto producer_thread = vxsdr_thread(&producer<Queue, Bulk>, queue.get(), n_items, std::ref(push_rate));
+
+    producer_thread.join();
+    consumer_thread.join();
+
+    // every packet must be counted once on each side
+    if constexpr (std::is_same<Queue, measured_queue>() or std::is_same<Queue, measured_packet_ring>()) {
+        auto stats = queue->statistics()->get("queue");
+        std::cout << name << " queue: high water mark " << stats["queue:high_water_mark"] << " of "
+                  << stats["queue:capacity"] << ", mean residency " << stats["queue:residency_mean_ns"] << " ns" << std::endl;
+        if (stats["queue:pushes"] != (int64_t)n_items or stats["queue:pops"] != (int64_t)n_items
+                or stats["queue:residency_count"] != (int64_t)n_items) {
+            std::cout << name << " queue: statistics do not match the number of packets" << std::endl;
+            return 0;
+        }
+    }
+
+    return std::min(pop_rate, push_rate);
+}
+
+// the sample queue holds leftover samples from partially-used packets; it is pushed and popped by the same
+// thread, so this measures only the cost of the queue operations themselves
+template <template <typename> class Queue, bool Bulk> double sample_queue_rate(const char* name, const size_t n_samples) {
+    Queue<std::complex<int16_t>> sample_queue{MAX_DATA_LENGTH_SAMPLES};
+    std::vector<std::complex<int16_t>> x(MAX_DATA_LENGTH_SAMPLES - 1, std::complex<int16_t>(1, -1));
+    std::vector<std::complex<int16_t>> y(MAX_DATA_LENGTH_SAMPLES - 1);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n_samples; i += x.size()) {
+        if constexpr (Bulk) {
+            sample_queue.push(x.data(), x.size());
+            sample_queue.pop(y.data(), y.size());
+        } else {
+            for (auto& e : x) {
+                sample_queue.push(e);
+            }
+            for (auto& e : y) {
+                sample_queue.pop(e);
+            }
+        }
+    }
+    auto t1                         = std::chrono::steady_clock::now();
+    std::chrono::duration<double> d = t1 - t0;
+    double rate = (double)n_samples / d.count();
+    std::cout << name << " sample queue, " << (Bulk ? "bulk" : "single") << " push and pop: " << rate << " samples/s" << std::endl;
+    return rate;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cerr << "usage: test_spsc_queue <number of seconds of data> <minimum sample rate>" << std::endl;
+        std::cerr << "usage: test_data_queue <number of seconds of data> <minimum sample rate>" << std::endl;
         return -1;
     }
 
@@ -127,18 +235,46 @@ int main(int argc, char* argv[]) {
 
     size_t n_items = std::ceil(n_seconds * minimum_rate / MAX_DATA_LENGTH_SAMPLES);
 
-    queue->reset();
-
-    double pop_rate = 0;
-    double push_rate = 0;
-
-    auto consumer_thread = vxsdr_thread(&consumer, n_items, std::ref(pop_rate));
-    auto producer_thread = vxsdr_thread(&producer, n_items, std::ref(push_rate));
+    // the selected backend must meet the minimum rate; the others are run for comparison
+    bool pass = true;
+    auto compare = [&]<template <typename> class Queue>(const char* name) {
+        double single_rate = run_test<Queue<data_queue_element>, false>(name, n_items);
+        double bulk_rate   = run_test<Queue<data_queue_element>, true>(name, n_items);
+        std::cout << name << " queue bulk/single rate ratio: " << bulk_rate / single_rate << std::endl;
 
-    producer_thread.join();
-    consumer_thread.join();
+        double sample_single_rate = sample_queue_rate<Queue, false>(name, (size_t)minimum_rate);
+        double sample_bulk_rate   = sample_queue_rate<Queue, true>(name, (size_t)minimum_rate);
+        std::cout << name << " sample queue bulk/single rate ratio: " << sample_bulk_rate / sample_single_rate << std::endl;
 
-    bool pass = (pop_rate > minimum_rate) and (push_rate > minimum_rate);
+        if constexpr (std::is_same<Queue<data_queue_element>, vxsdr_queue_backend<data_queue_element>>()) {
+            pass = (single_rate > minimum_rate) and (bulk_rate > minimum_rate);
+        }
+    };
+
+    compare.template operator()<vxsdr_folly_queue>("folly");
+    compare.template operator()<vxsdr_cached_queue>("cached");
+#ifdef VXSDR_ENABLE_BOOST_QUEUE
+    compare.template operator()<vxsdr_boost_queue>("boost");
+#endif
+
+    // the packet ring is used for the rx data queues, so it must also meet the minimum rate
+    double ring_single_rate = run_test<packet_ring, false>("packet ring", n_items);
+    double ring_bulk_rate   = run_test<packet_ring, true>("packet ring", n_items);
+    std::cout << "packet ring bulk/single rate ratio: " << ring_bulk_rate / ring_single_rate << std::endl;
+    pass = pass and (ring_single_rate > minimum_rate) and (ring_bulk_rate > minimum_rate);
+
+    double elastic_rate = run_test<elastic_packet_ring, true>("elastic packet ring", n_items);
+    std::cout << "elastic/fixed packet ring rate ratio: " << elastic_rate / ring_bulk_rate << std::endl;
+    pass = pass and (elastic_rate > minimum_rate);
+
+    double unmeasured_rate = run_test<vxsdr_queue<data_queue_element>, true>("unmeasured", n_items);
+    double measured_rate   = run_test<measured_queue, true>("measured", n_items);
+    std::cout << "measured/unmeasured queue rate ratio: " << measured_rate / unmeasured_rate << std::endl;
+    pass = pass and (measured_rate > minimum_rate);
+
+    double measured_ring_rate = run_test<measured_packet_ring, true>("measured packet ring", n_items);
+    std::cout << "measured/unmeasured packet ring rate ratio: " << measured_ring_rate / ring_bulk_rate << std::endl;
+    pass = pass and (measured_ring_rate > minimum_rate);
 
     std::cout << (pass ? "passed" : "failed") << std::endl;
 
@@ -8,6 +8,8 @@
 #include <random>
 #include <vector>
 
+#include "sample_conversion.hpp"
+
 void init_int(std::vector<std::complex<int16_t>>& x) {
     for (unsigned i = 0; i < x.size(); i++) {
         x[i] = std::complex<int16_t>((int16_t)(i % 65519) - 32768, (int16_t)(i % 65521) - 32768);
@@ -170,6 +172,35 @@ int main(int argc, char* argv[]) {
 
     bool pass = (rate_i_f > minimum_rate) and (rate_f_i_default > minimum_rate) and (err_f_i_default < 1e-3);
 
+#ifdef VXSDR_HAS_FLOAT16
+    std::vector<vxsdr::complex_float16> x_half(n);
+    init_int(x_int);
+
+    t0 = std::chrono::steady_clock::now();
+    convert_from_wire(x_int.data(), x_half.data(), n);
+    t1                    = std::chrono::steady_clock::now();
+    d1                    = t1 - t0;
+    double rate_i_h       = (double)n / d1.count();
+    std::cout << "complex<int16_t> to complex_float16:               " << rate_i_h << " samples/s"
+              << (rate_i_h > minimum_rate ? "" : " (SLOW)") << std::endl;
+
+    t0 = std::chrono::steady_clock::now();
+    convert_to_wire(x_half.data(), y_int.data(), n);
+    t1                    = std::chrono::steady_clock::now();
+    d1                    = t1 - t0;
+    double rate_h_i       = (double)n / d1.count();
+    // half precision keeps 11 significant bits, so the round trip is accurate to 1 part in 2048
+    double err_h_i        = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        err_h_i = std::max(err_h_i, (double)std::abs(x_int[i].real() - y_int[i].real()) / std::max(1, std::abs((int)x_int[i].real())));
+        err_h_i = std::max(err_h_i, (double)std::abs(x_int[i].imag() - y_int[i].imag()) / std::max(1, std::abs((int)x_int[i].imag())));
+    }
+    std::cout << "complex_float16 to complex<int16_t>:               " << rate_h_i << " samples/s"
+              << (rate_h_i > minimum_rate ? "" : " (SLOW)") << " max rel err = " << err_h_i << std::endl;
+
+    pass = pass and (rate_i_h > minimum_rate) and (rate_h_i > minimum_rate) and (err_h_i <= 1.0 / 1024.0);
+#endif
+
     std::cout << (pass ? "passed" : "failed") << std::endl;
 
     return (pass ? 0 : 1);
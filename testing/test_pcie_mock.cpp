@@ -0,0 +1,306 @@
+// Copyright (c) 2024 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Runs the PCIe transports over the software model of the vxsdr_dma device: the device sends rx data
+// packets, which are checked as they come out of the rx data queue, then tx data packets are sent from the
+// tx data queue and in place, and checked as the device receives them. Commands are then sent over a
+// pcie_command_transport, one at a time and with several in flight, and their responses checked; a batch
+// is sent with send_commands(), and a command the device never answers is abandoned, after which later
+// commands of the same type must still get their own responses. Reports the rates and the driver calls
+// per packet. Usage:
+//
+//     ./test_pcie_mock <number of packets> [single | poll]
+//
+// where "single" makes the model reject the batched buffer ioctls, as drivers before 2.04 do, and "poll" has
+// the receiver poll the rx ring indices, which the model checks never show a full ring.
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pcie_dma_mock.hpp"
+#include "vxsdr_packets.hpp"
+#include "vxsdr_pcie.hpp"
+#include "vxsdr_transport.hpp"
+
+static constexpr unsigned payload_samples = 2048;
+static constexpr uint16_t packet_bytes    = sizeof(packet_header) + payload_samples * sizeof(std::complex<int16_t>);
+static constexpr auto progress_timeout    = std::chrono::seconds(2);
+static constexpr uint64_t max_commands    = 10'000;
+
+// fills a data packet, marking it with its index in the first sample
+static void make_data_packet(packet& p, const uint8_t packet_type, const uint64_t index) {
+    auto* d = std::bit_cast<data_packet*>(&p);
+    d->hdr  = {packet_type, 0, 0, 0, 0, packet_bytes, 0};
+    for (unsigned i = 0; i < payload_samples; i++) {
+        d->data[i] = {(int16_t)(index + i), (int16_t)i};
+    }
+}
+
+static bool check_data_packet(const packet& p, const uint64_t index) {
+    const auto* d = std::bit_cast<const data_packet*>(&p);
+    return p.hdr.packet_size == packet_bytes and d->data[0].real() == (int16_t)index
+           and d->data[payload_samples - 1].imag() == (int16_t)(payload_samples - 1);
+}
+
+static void report(const std::string& what, const uint64_t n, const uint64_t n_expected,
+                   const std::chrono::duration<double> d, const uint64_t n_ioctls) {
+    std::cout << what << ": " << n << " of " << n_expected << " packets in " << d.count() << " s ("
+              << (double)n / d.count() << " packets/s, " << (double)n_ioctls / (double)std::max<uint64_t>(n, 1)
+              << " ioctls/packet)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: test_pcie_mock <number of packets> [single | poll]" << std::endl;
+        return -1;
+    }
+    const uint64_t n_packets = std::strtoull(argv[1], nullptr, 10);
+
+    pcie_dma_mock_options options;
+    const std::string mode = (argc > 2) ? argv[2] : "";
+    options.batch_ioctls   = (mode != "single");
+
+    std::atomic<uint64_t> n_tx_received = 0;
+    std::atomic<bool> tx_ok             = true;
+    auto mock = std::make_shared<pcie_dma_mock>(options);
+    mock->set_tx_data_handler([&](const packet& p) {
+        // skip the empty packets sent to request acks
+        if (p.hdr.packet_size > sizeof(header_only_packet)) {
+            if (not check_data_packet(p, n_tx_received)) {
+                tx_ok = false;
+            }
+            n_tx_received++;
+        }
+    });
+
+    // run the transport threads at normal priority on any cpu, so no privileges are needed
+    std::map<std::string, int64_t> settings = {{"pcie_data_transport:thread_priority",        -1},
+                                               {"pcie_data_transport:thread_affinity_offset", -1}};
+    if (mode == "poll") {
+        settings["pcie_data_transport:busy_poll"] = 1;
+    }
+    auto iface = std::make_shared<pcie_dma_interface>(mock);
+    auto tport = std::make_unique<pcie_data_transport>(settings, iface, 1, 1, payload_samples);
+
+    // rx: the device sends packets as fast as the rx ring allows
+    uint64_t ioctls_start = mock->ioctl_count();
+    auto t0               = std::chrono::steady_clock::now();
+    auto device_thread    = std::thread([&] {
+        data_queue_element p;
+        for (uint64_t i = 0; i < n_packets; i++) {
+            make_data_packet(p, PACKET_TYPE_RX_SIGNAL_DATA, i);
+            auto start = std::chrono::steady_clock::now();
+            while (not mock->device_put_rx(p)) {
+                if (std::chrono::steady_clock::now() - start > progress_timeout) {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint64_t n_rx_received = 0;
+    bool rx_ok             = true;
+    auto last_progress     = std::chrono::steady_clock::now();
+    data_queue_element e;
+    while (n_rx_received < n_packets and rx_ok) {
+        if (tport->rx_data_queue[0]->pop(e)) {
+            if (not check_data_packet(e, n_rx_received)) {
+                std::cout << "rx packet " << n_rx_received << " is incorrect" << std::endl;
+                rx_ok = false;
+            }
+            n_rx_received++;
+            last_progress = std::chrono::steady_clock::now();
+        } else if (std::chrono::steady_clock::now() - last_progress > progress_timeout) {
+            std::cout << "rx timeout after " << n_rx_received << " packets" << std::endl;
+            rx_ok = false;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    device_thread.join();
+    report("rx", n_rx_received, n_packets, std::chrono::steady_clock::now() - t0, mock->ioctl_count() - ioctls_start);
+
+    // tx: packets queued for the sender thread, then (if the transport supports it) packets built in place
+    auto wait_for_tx = [&](const uint64_t n_expected) {
+        uint64_t n_last = n_tx_received;
+        last_progress   = std::chrono::steady_clock::now();
+        while (n_tx_received < n_expected and tx_ok) {
+            if (n_tx_received != n_last) {
+                n_last        = n_tx_received;
+                last_progress = std::chrono::steady_clock::now();
+            } else if (std::chrono::steady_clock::now() - last_progress > progress_timeout) {
+                std::cout << "tx timeout after " << n_tx_received << " packets" << std::endl;
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return tx_ok.load();
+    };
+
+    ioctls_start = mock->ioctl_count();
+    t0           = std::chrono::steady_clock::now();
+    bool tx_queued_ok = true;
+    for (uint64_t i = 0; i < n_packets and tx_queued_ok; i++) {
+        make_data_packet(e, PACKET_TYPE_TX_SIGNAL_DATA, i);
+        last_progress = std::chrono::steady_clock::now();
+        while (not tport->tx_data_queue->push(e)) {
+            if (std::chrono::steady_clock::now() - last_progress > progress_timeout) {
+                std::cout << "tx queue push timeout after " << i << " packets" << std::endl;
+                tx_queued_ok = false;
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+    tx_queued_ok = tx_queued_ok and wait_for_tx(n_packets);
+    report("tx queued", n_tx_received, n_packets, std::chrono::steady_clock::now() - t0, mock->ioctl_count() - ioctls_start);
+
+    bool tx_in_place_ok = true;
+    if (tx_queued_ok and tport->use_in_place_send()) {
+        ioctls_start = mock->ioctl_count();
+        t0           = std::chrono::steady_clock::now();
+        for (uint64_t i = n_packets; i < 2 * n_packets and tx_in_place_ok; i++) {
+            tx_in_place_ok = tport->send_packet_in_place([&](packet& p) { make_data_packet(p, PACKET_TYPE_TX_SIGNAL_DATA, i); });
+        }
+        tx_in_place_ok = tx_in_place_ok and wait_for_tx(2 * n_packets);
+        report("tx in place", n_tx_received - n_packets, n_packets, std::chrono::steady_clock::now() - t0,
+               mock->ioctl_count() - ioctls_start);
+    }
+    if (not tx_ok) {
+        std::cout << "tx packet " << n_tx_received << " is incorrect" << std::endl;
+    }
+
+    tport.reset();
+
+    // commands: the model answers each command with a copy of it, so each response must carry its command's
+    // number; the command codes vary, so that responses are matched by more than their order
+    auto ctport = std::make_unique<pcie_command_transport>(settings, iface);
+    const uint64_t n_commands = std::min(n_packets, max_commands);
+    auto send_commands = [&](const size_t max_in_flight) {
+        std::deque<std::pair<uint64_t, uint64_t>> in_flight;
+        uint64_t n_submitted = 0;
+        uint64_t n_answered  = 0;
+        auto start           = std::chrono::steady_clock::now();
+        while (n_answered < n_commands) {
+            while (n_submitted < n_commands and in_flight.size() < max_in_flight) {
+                four_uint32_packet c{};
+                c.hdr    = {PACKET_TYPE_DEVICE_CMD, (uint8_t)(1 + n_submitted % 8), 0, 0, 0, sizeof(c), 0};
+                c.value1 = (uint32_t)n_submitted;
+                auto id  = ctport->submit_command(c);
+                if (not id) {
+                    break;
+                }
+                in_flight.emplace_back(n_submitted++, id.value());
+            }
+            if (in_flight.empty()) {
+                std::cout << "command submit failed after " << n_answered << " responses" << std::endl;
+                return false;
+            }
+            command_queue_element r;
+            auto status = ctport->wait_for_response(in_flight.front().second, r, progress_timeout);
+            if (status == command_transport::COMMAND_RESPONSE_PENDING) {
+                std::cout << "command timeout after " << n_answered << " responses" << std::endl;
+                return false;
+            }
+            if (status == command_transport::COMMAND_RESPONSE_MISSING) {
+                std::cout << "no response to command " << in_flight.front().first << std::endl;
+                return false;
+            }
+            const auto* v = std::bit_cast<const four_uint32_packet*>(&r);
+            if (r.hdr.packet_type != PACKET_TYPE_DEVICE_CMD_RSP or r.hdr.command != 1 + in_flight.front().first % 8
+                or v->value1 != (uint32_t)in_flight.front().first) {
+                std::cout << "response to command " << in_flight.front().first << " is incorrect" << std::endl;
+                return false;
+            }
+            in_flight.pop_front();
+            n_answered++;
+        }
+        std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+        std::cout << "commands (" << max_in_flight << " in flight): " << n_answered << " in " << d.count() << " s ("
+                  << (double)n_answered / d.count() << " commands/s, " << 1e6 * d.count() / (double)n_answered
+                  << " us per command)" << std::endl;
+        return true;
+    };
+    bool commands_ok = send_commands(1) and send_commands(ctport->get_max_commands_in_flight());
+
+    // a batch of commands with send_commands(), which keeps as many in flight as the transport allows
+    auto make_command = [](const uint64_t n) {
+        command_queue_element c{};
+        auto* v = std::bit_cast<four_uint32_packet*>(&c);
+        v->hdr    = {PACKET_TYPE_DEVICE_CMD, (uint8_t)(1 + n % 8), 0, 0, 0, sizeof(four_uint32_packet), 0};
+        v->value1 = (uint32_t)n;
+        return c;
+    };
+    auto check_response = [](const command_queue_element& r, const uint64_t n) {
+        const auto* v = std::bit_cast<const four_uint32_packet*>(&r);
+        return r.hdr.packet_type == PACKET_TYPE_DEVICE_CMD_RSP and r.hdr.command == 1 + n % 8 and v->value1 == (uint32_t)n;
+    };
+    bool batch_ok = true;
+    if (commands_ok) {
+        std::vector<command_queue_element> batch(4 * ctport->get_max_commands_in_flight() + 3);
+        for (size_t n = 0; n < batch.size(); n++) {
+            batch[n] = make_command(n);
+        }
+        std::vector<command_transport::command_response_status> statuses(batch.size());
+        std::vector<command_queue_element> responses(batch.size());
+        size_t n_sent = ctport->send_commands(batch, statuses, responses, progress_timeout);
+        for (size_t n = 0; n < batch.size() and batch_ok; n++) {
+            if (n >= n_sent or statuses[n] != command_transport::COMMAND_RESPONSE_RECEIVED or not check_response(responses[n], n)) {
+                std::cout << "response to batch command " << n << " is incorrect" << std::endl;
+                batch_ok = false;
+            }
+        }
+        std::cout << "command batch: " << n_sent << " of " << batch.size() << " commands sent" << std::endl;
+    }
+
+    // a command the device never answers is abandoned when its wait times out; once it has expired, the next
+    // command with the same code must get its own response rather than have it taken by the abandoned one
+    bool abandon_ok = true;
+    if (commands_ok) {
+        constexpr uint32_t dropped = 0xDEAD;
+        mock->set_command_handler([](const packet& command, packet& response) {
+            if (std::bit_cast<const four_uint32_packet*>(&command)->value1 == dropped) {
+                response.hdr.packet_size = 0;
+            }
+        });
+        command_queue_element r;
+        auto id = ctport->submit_command(make_command(dropped));
+        if (not id or ctport->wait_for_response(id.value(), r, std::chrono::milliseconds(20)) != command_transport::COMMAND_RESPONSE_PENDING) {
+            std::cout << "dropped command was not left pending" << std::endl;
+            abandon_ok = false;
+        } else {
+            ctport->abandon_command(id.value());
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            for (uint64_t n = 0; n < 8 and abandon_ok; n++) {
+                // the same command code as the dropped command
+                const uint64_t k = dropped + 8 * (n + 1);
+                auto next = ctport->submit_command(make_command(k));
+                if (not next or ctport->wait_for_response(next.value(), r, progress_timeout) != command_transport::COMMAND_RESPONSE_RECEIVED
+                    or not check_response(r, k)) {
+                    std::cout << "command " << n << " after an abandoned command got no response" << std::endl;
+                    abandon_ok = false;
+                }
+            }
+        }
+        mock->set_command_handler({});
+        std::cout << "abandoned command: " << (abandon_ok ? "expired" : "took later responses") << std::endl;
+    }
+    ctport.reset();
+
+    bool pass = rx_ok and n_rx_received == n_packets and tx_ok and tx_queued_ok and tx_in_place_ok and commands_ok and batch_ok
+                and abandon_ok;
+    std::cout << (pass ? "passed" : "failed") << std::endl;
+    return (pass ? 0 : 1);
+}
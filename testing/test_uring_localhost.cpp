@@ -0,0 +1,115 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Sends data packets over localhost with a uring_sender and receives them with a uring_receiver,
+// checking that every packet arrives in order, and reports the rate. Usage:
+//
+//     ./test_uring_localhost <number of packets>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "vxsdr_net.hpp"
+#include "vxsdr_packets.hpp"
+#include "uring_socket.hpp"
+
+static constexpr unsigned receive_port = 1031;
+static constexpr unsigned send_port    = 55124;
+
+static constexpr size_t payload_bytes      = 8192;
+static constexpr uint32_t batch_packets    = 64;
+// keep the receive socket buffer from overflowing, since localhost drops packets when it does
+static constexpr uint64_t max_in_flight    = 256;
+static constexpr int receive_timeout_ms    = 1000;
+static constexpr unsigned network_buffer_size = 8'388'608;
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: test_uring_localhost <number of packets>" << std::endl;
+        return -1;
+    }
+    const uint64_t n_packets = std::strtoull(argv[1], nullptr, 10);
+
+    net::io_context context;
+    net::ip::udp::socket sender_socket(context, net::ip::udp::v4());
+    net::ip::udp::socket receiver_socket(context, net::ip::udp::v4());
+    const auto localhost = net::ip::address_v4::loopback();
+    net_error_code::error_code err;
+    sender_socket.bind(net::ip::udp::endpoint(localhost, send_port), err);
+    if (not err) {
+        receiver_socket.bind(net::ip::udp::endpoint(localhost, receive_port), err);
+    }
+    if (not err) {
+        sender_socket.connect(net::ip::udp::endpoint(localhost, receive_port), err);
+    }
+    if (not err) {
+        receiver_socket.connect(net::ip::udp::endpoint(localhost, send_port), err);
+    }
+    if (not err) {
+        receiver_socket.set_option(net::socket_base::receive_buffer_size((int)network_buffer_size), err);
+    }
+    if (err) {
+        std::cerr << "cannot set up localhost sockets: " << err.message() << std::endl;
+        return -1;
+    }
+
+    uring_receiver receiver(receiver_socket.native_handle());
+    uring_sender sender(sender_socket.native_handle(), batch_packets);
+
+    std::atomic<uint64_t> n_received = 0;
+    std::atomic<bool> receive_ok     = true;
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto sender_thread = std::thread([&] {
+        std::vector<data_queue_element> batch(batch_packets);
+        uint64_t n_sent = 0;
+        size_t n_failed = 0;
+        int error_code  = 0;
+        while (n_sent < n_packets and receive_ok and n_failed == 0) {
+            while (n_sent - n_received > max_in_flight and receive_ok) {
+                std::this_thread::yield();
+            }
+            uint32_t n = (uint32_t)std::min<uint64_t>(batch_packets, n_packets - n_sent);
+            for (uint32_t i = 0; i < n; i++) {
+                batch[i].hdr = {PACKET_TYPE_RX_SIGNAL_DATA, 0, 0, 0, 0, (uint16_t)payload_bytes, (uint16_t)(n_sent + i)};
+                n_failed += sender.queue(&batch[i], payload_bytes, error_code);
+            }
+            n_failed += sender.flush(error_code);
+            n_sent   += n;
+        }
+        if (n_failed > 0) {
+            std::cout << n_failed << " sends failed: " << std::strerror(error_code) << std::endl;
+            receive_ok = false;
+        }
+    });
+
+    data_queue_element p;
+    while (n_received < n_packets and receive_ok) {
+        int error_code = 0;
+        size_t n = receiver.receive(&p, sizeof(p), receive_timeout_ms, error_code);
+        if (n == 0) {
+            std::cout << "receive timeout or error after " << n_received << " packets: " << std::strerror(error_code) << std::endl;
+            receive_ok = false;
+        } else if (n != payload_bytes or p.hdr.packet_size != payload_bytes or p.hdr.sequence_counter != (uint16_t)n_received) {
+            std::cout << "packet " << n_received << " has size " << n << " and sequence number " << p.hdr.sequence_counter << std::endl;
+            receive_ok = false;
+        } else {
+            n_received++;
+        }
+    }
+    sender_thread.join();
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - t0;
+
+    bool pass = receive_ok and n_received == n_packets;
+    std::cout << n_received << " of " << n_packets << " packets received in " << d.count() << " s ("
+              << (double)n_received / d.count() << " packets/s)" << std::endl;
+    std::cout << (pass ? "passed" : "failed") << std::endl;
+    return (pass ? 0 : 1);
+}
@@ -0,0 +1,179 @@
+// Copyright (c) 2023 Vesperix Corporation
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Tests the AF_XDP receive path on a veth pair, without a device. Data packets and packets for
+// another port are written as raw Ethernet frames to one end of the pair, and the xdp_socket on
+// the other end must receive exactly the data packets, in order. Needs root (or CAP_NET_ADMIN,
+// CAP_NET_RAW and CAP_BPF), and a veth pair, which can be made with:
+//
+//     sudo ip link add vxsdr_veth0 type veth peer name vxsdr_veth1
+//     sudo ip link set vxsdr_veth0 up
+//     sudo ip link set vxsdr_veth1 up
+//     sudo ./test_xdp_veth vxsdr_veth0 vxsdr_veth1 1000000
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "vxsdr_packets.hpp"
+#include "xdp_socket.hpp"
+
+static constexpr uint16_t data_port  = 1031;
+static constexpr uint16_t other_port = 1032;
+// every other_port_interval-th frame is for other_port, and must not reach the xdp socket
+static constexpr uint64_t other_port_interval = 7;
+// fits the default veth MTU of 1500
+static constexpr size_t payload_bytes = 1024;
+static constexpr int receive_timeout_ms = 1000;
+
+static bool get_mac_address(const char* interface, std::array<uint8_t, ETH_ALEN>& mac) {
+    ifreq request{};
+    std::strncpy(request.ifr_name, interface, IFNAMSIZ - 1);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    bool ok = fd >= 0 and ioctl(fd, SIOCGIFHWADDR, &request) == 0;
+    if (fd >= 0) {
+        close(fd);
+    }
+    std::memcpy(mac.data(), request.ifr_hwaddr.sa_data, ETH_ALEN);
+    return ok;
+}
+
+static uint16_t ipv4_checksum(const uint8_t* header) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < 20; i += 2) {
+        sum += (header[i] << 8) | header[i + 1];
+    }
+    while (sum > 0xFFFF) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+// builds an Ethernet/IPv4/UDP frame carrying a data packet with the given sequence number
+static size_t build_frame(std::vector<uint8_t>& frame, const std::array<uint8_t, ETH_ALEN>& dst, const std::array<uint8_t, ETH_ALEN>& src,
+                          const uint16_t port, const uint16_t sequence) {
+    const size_t frame_bytes = 14 + 20 + 8 + payload_bytes;
+    frame.assign(frame_bytes, 0);
+    uint8_t* p = frame.data();
+    std::memcpy(p, dst.data(), ETH_ALEN);
+    std::memcpy(p + 6, src.data(), ETH_ALEN);
+    p[12] = 0x08;
+    p[13] = 0x00;
+    uint8_t* ip = p + 14;
+    ip[0] = 0x45;
+    ip[2] = (uint8_t)((20 + 8 + payload_bytes) >> 8);
+    ip[3] = (uint8_t)((20 + 8 + payload_bytes) & 0xFF);
+    ip[6] = 0x40;  // don't fragment
+    ip[8] = 64;
+    ip[9] = 17;
+    const uint8_t src_ip[] = {10, 99, 0, 1};
+    const uint8_t dst_ip[] = {10, 99, 0, 2};
+    std::memcpy(ip + 12, src_ip, 4);
+    std::memcpy(ip + 16, dst_ip, 4);
+    const uint16_t checksum = ipv4_checksum(ip);
+    ip[10] = (uint8_t)(checksum >> 8);
+    ip[11] = (uint8_t)(checksum & 0xFF);
+    uint8_t* udp = ip + 20;
+    udp[0] = (uint8_t)(data_port >> 8);
+    udp[1] = (uint8_t)(data_port & 0xFF);
+    udp[2] = (uint8_t)(port >> 8);
+    udp[3] = (uint8_t)(port & 0xFF);
+    udp[4] = (uint8_t)((8 + payload_bytes) >> 8);
+    udp[5] = (uint8_t)((8 + payload_bytes) & 0xFF);
+    packet_header hdr{PACKET_TYPE_RX_SIGNAL_DATA, 0, 0, 0, 0, (uint16_t)payload_bytes, sequence};
+    std::memcpy(udp + 8, &hdr, sizeof(hdr));
+    return frame_bytes;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "usage: test_xdp_veth <sending veth> <receiving veth> <number of packets>" << std::endl;
+        return -1;
+    }
+    const unsigned tx_ifindex = if_nametoindex(argv[1]);
+    const unsigned rx_ifindex = if_nametoindex(argv[2]);
+    const uint64_t n_packets  = std::strtoull(argv[3], nullptr, 10);
+    std::array<uint8_t, ETH_ALEN> tx_mac{};
+    std::array<uint8_t, ETH_ALEN> rx_mac{};
+    if (tx_ifindex == 0 or rx_ifindex == 0 or not get_mac_address(argv[1], tx_mac) or not get_mac_address(argv[2], rx_mac)) {
+        std::cerr << "cannot find interfaces " << argv[1] << " and " << argv[2] << std::endl;
+        return -1;
+    }
+
+    // veth does not support zero-copy mode
+    xdp_socket_options options;
+    options.zero_copy = false;
+    xdp_socket xsk(rx_ifindex, 0, data_port, options);
+
+    int tx_fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (tx_fd < 0) {
+        std::cerr << "cannot open packet socket: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    sockaddr_ll tx_address{};
+    tx_address.sll_family  = AF_PACKET;
+    tx_address.sll_ifindex = (int)tx_ifindex;
+    tx_address.sll_halen   = ETH_ALEN;
+    std::memcpy(tx_address.sll_addr, rx_mac.data(), ETH_ALEN);
+
+    std::atomic<uint64_t> n_received = 0;
+    std::atomic<bool> receive_ok = true;
+    auto receiver = std::thread([&] {
+        data_queue_element p;
+        while (n_received < n_packets) {
+            int error_code = 0;
+            size_t n = xsk.receive(&p, sizeof(p), receive_timeout_ms, error_code);
+            if (n == 0) {
+                std::cout << "receive timeout or error after " << n_received << " packets: " << std::strerror(error_code) << std::endl;
+                receive_ok = false;
+                return;
+            }
+            if (n != payload_bytes or p.hdr.packet_size != payload_bytes or p.hdr.sequence_counter != (uint16_t)n_received) {
+                std::cout << "packet " << n_received << " has size " << n << " and sequence number " << p.hdr.sequence_counter << std::endl;
+                receive_ok = false;
+                return;
+            }
+            n_received++;
+        }
+    });
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<uint8_t> frame;
+    uint64_t n_sent = 0;
+    for (uint64_t i = 0; n_sent < n_packets and receive_ok; i++) {
+        const bool data = (i % other_port_interval) != 0;
+        // veth delivers frames synchronously, so keep the rx ring from overflowing
+        while (data and n_sent - n_received >= options.frame_count / 2 and receive_ok) {
+            std::this_thread::yield();
+        }
+        size_t n = build_frame(frame, rx_mac, tx_mac, data ? data_port : other_port, (uint16_t)n_sent);
+        if (sendto(tx_fd, frame.data(), n, 0, (sockaddr*)&tx_address, sizeof(tx_address)) != (ssize_t)n) {
+            std::cerr << "send error: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        n_sent += data ? 1 : 0;
+    }
+    receiver.join();
+    close(tx_fd);
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - t0;
+
+    bool pass = receive_ok and n_received == n_packets;
+    std::cout << n_received << " of " << n_packets << " packets received in " << d.count() << " s ("
+              << (double)n_received / d.count() << " packets/s, " << (xsk.is_zero_copy() ? "zero-copy" : "copy") << " mode)" << std::endl;
+    std::cout << (pass ? "passed" : "failed") << std::endl;
+    return (pass ? 0 : 1);
+}